@@ -0,0 +1,77 @@
+#include "activity.hpp"
+#include "trace.hpp"
+#include <bit>
+
+namespace Activity {
+
+    std::optional<Feature> featureFromName(const std::string& name) {
+        for (std::size_t f = 0; f < kNumFeatures; ++f) {
+            if (name == kFeatureNames[f])
+                return static_cast<Feature>(f);
+        }
+        return std::nullopt;
+    }
+
+    ActivityView ActivityView::slice(std::size_t begin, std::size_t count) const {
+        Columns columns;
+        for (std::size_t f = 0; f < kNumFeatures; ++f)
+            columns[f] = columns_[f].subspan(begin, count);
+        return ActivityView(columns, present_, count);
+    }
+
+    std::unordered_map<std::string, double> ActivityView::row(std::size_t i) const {
+        std::unordered_map<std::string, double> stats;
+        for (std::size_t f = 0; f < kNumFeatures; ++f) {
+            if (present_[f])
+                stats[kFeatureNames[f]] = columns_[f][i];
+        }
+        return stats;
+    }
+
+    ActivityColumns::ActivityColumns(std::size_t numUsers)
+        : size_(numUsers), zeros_(numUsers, 0.0) {
+        DEX_TRACE_ADD(AllocatedBytes, numUsers * sizeof(double));
+    }
+
+    std::span<double> ActivityColumns::column(Feature feature) {
+        std::vector<double>& column = columns_[index(feature)];
+        if (column.empty()) {
+            column.assign(size_, 0.0);
+            DEX_TRACE_ADD(AllocatedBytes, size_ * sizeof(double));
+        }
+        return column;
+    }
+
+    ActivityView ActivityColumns::view() const {
+        ActivityView::Columns columns;
+        std::array<bool, kNumFeatures> present{};
+        for (std::size_t f = 0; f < kNumFeatures; ++f) {
+            present[f] = !columns_[f].empty();
+            columns[f] = present[f] ? std::span<const double>(columns_[f]) : std::span<const double>(zeros_);
+        }
+        return ActivityView(columns, present, size_);
+    }
+
+    void ActivityColumns::publish(std::span<const Accumulator> accumulators, std::size_t begin, std::size_t end) {
+        auto volume = column<Feature::TradingVolume>();
+        auto tradeVolume = column<Feature::TradeVolume>();
+        auto trailingVolume = column<Feature::TrailingVolume>();
+        auto activeDays = column<Feature::ActiveDays>();
+        auto uniqueMarkets = column<Feature::UniqueMarkets>();
+        auto wins = column<Feature::Wins>();
+        auto losses = column<Feature::Losses>();
+        auto consecutiveDays = column<Feature::ConsecutiveDays>();
+        for (std::size_t i = begin; i < end; ++i) {
+            const Accumulator& a = accumulators[i];
+            volume[i] = a.volume;
+            tradeVolume[i] = a.volume;
+            trailingVolume[i] = a.trailingVolume;
+            activeDays[i] = a.activeSteps;
+            uniqueMarkets[i] = std::popcount(a.markets);
+            wins[i] = a.wins;
+            losses[i] = a.losses;
+            consecutiveDays[i] = a.longestStreak;
+        }
+    }
+
+} // namespace Activity
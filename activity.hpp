@@ -0,0 +1,127 @@
+#ifndef ACTIVITY_HPP
+#define ACTIVITY_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Activity {
+
+    // Fixed activity schema. Feature ids are resolved at compile time; the names are the keys the
+    // string-map API of PreTGERewardsPolicy has always used.
+    enum class Feature : std::uint8_t {
+        TradingVolume,
+        MakerVolume,
+        TakerVolume,
+        QScore,
+        ReferralPoints,
+        SwapVolume,
+        TradeVolume,
+        TrailingVolume,
+        ActiveDays,
+        UniqueMarkets,
+        Wins,
+        Losses,
+        ConsecutiveDays,
+        Count
+    };
+
+    inline constexpr std::size_t kNumFeatures = static_cast<std::size_t>(Feature::Count);
+
+    inline constexpr std::array<const char*, kNumFeatures> kFeatureNames = {
+        "trading_volume", "maker_volume", "taker_volume", "qscore", "referral_points", "swap_volume",
+        "trade_volume", "trailing_volume", "active_days", "unique_markets", "wins", "losses", "consecutive_days"
+    };
+
+    constexpr std::size_t index(Feature feature) { return static_cast<std::size_t>(feature); }
+    inline const char* featureName(Feature feature) { return kFeatureNames[index(feature)]; }
+    std::optional<Feature> featureFromName(const std::string& name);
+
+    // Non-owning view of a range of users. Every feature has a full-length column; features that were
+    // never recorded read as zeros, matching the "missing key counts as 0" rule of the map API.
+    class ActivityView {
+    public:
+        using Columns = std::array<std::span<const double>, kNumFeatures>;
+        ActivityView(const Columns& columns, const std::array<bool, kNumFeatures>& present, std::size_t size)
+            : columns_(columns), present_(present), size_(size) {}
+
+        std::size_t size() const { return size_; }
+        template<Feature F> std::span<const double> get() const { return columns_[index(F)]; }
+        std::span<const double> get(Feature feature) const { return columns_[index(feature)]; }
+        bool has(Feature feature) const { return present_[index(feature)]; }
+
+        ActivityView slice(std::size_t begin, std::size_t count) const;
+        // Recorded features of one user as the legacy string-keyed map.
+        std::unordered_map<std::string, double> row(std::size_t i) const;
+    private:
+        Columns columns_;
+        std::array<bool, kNumFeatures> present_;
+        std::size_t size_;
+    };
+
+    // Online per-user summary of the PreTGE trading activity. Every step folds into it in O(1) and no
+    // per-step history is kept, so a campaign of thousands of steps costs the same per step as a short one.
+    struct Accumulator {
+        static constexpr std::size_t kNumMarkets = 32;
+        double volume = 0.0;
+        double trailingVolume = 0.0; // exponentially decayed sum, see kTrailingWindow
+        std::uint32_t activeSteps = 0;
+        std::uint32_t wins = 0;
+        std::uint32_t losses = 0;
+        std::uint32_t streak = 0; // consecutive active steps up to the last one
+        std::uint32_t longestStreak = 0;
+        std::uint32_t markets = 0; // bitset of the markets traded so far
+
+        // One step: a trade of `stepVolume` over the `stepMarkets` bitset, or nothing if !traded.
+        void record(bool traded, double stepVolume, bool won, std::uint32_t stepMarkets, double decay) {
+            const double v = traded ? stepVolume : 0.0;
+            volume += v;
+            trailingVolume = trailingVolume * decay + v;
+            activeSteps += traded;
+            wins += traded && won;
+            losses += traded && !won;
+            streak = traded ? streak + 1 : 0;
+            longestStreak = std::max(longestStreak, streak);
+            markets |= traded ? stepMarkets : 0u;
+        }
+    };
+
+    // Trailing volume decays by exp(-1 / kTrailingWindow) per step: a ring-free stand-in for the sum over
+    // the last kTrailingWindow steps.
+    inline constexpr double kTrailingWindow = 30.0;
+
+    // Features derived from an Accumulator; "trade_volume" and "trading_volume" are the same running sum
+    // under the names different policies use, and "consecutive_days" is the longest streak.
+    inline constexpr std::array<Feature, 8> kAccumulatedFeatures = {
+        Feature::TradingVolume, Feature::TradeVolume, Feature::TrailingVolume, Feature::ActiveDays,
+        Feature::UniqueMarkets, Feature::Wins, Feature::Losses, Feature::ConsecutiveDays
+    };
+
+    // Owning column store, one vector per recorded feature, indexed like the user pool.
+    class ActivityColumns {
+    public:
+        explicit ActivityColumns(std::size_t numUsers = 0);
+        std::size_t size() const { return size_; }
+        // Allocates (zero-filled) on first access.
+        std::span<double> column(Feature feature);
+        template<Feature F> std::span<double> column() { return column(F); }
+        bool has(Feature feature) const { return !columns_[index(feature)].empty(); }
+        ActivityView view() const;
+        // Writes kAccumulatedFeatures of users [begin, end) from their accumulators. Those columns must
+        // already be allocated when ranges are published concurrently.
+        void publish(std::span<const Accumulator> accumulators, std::size_t begin, std::size_t end);
+    private:
+        std::size_t size_;
+        std::array<std::vector<double>, kNumFeatures> columns_;
+        std::vector<double> zeros_;
+    };
+
+} // namespace Activity
+
+#endif // ACTIVITY_HPP
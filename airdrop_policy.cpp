@@ -1 +1,107 @@
-#include"airdrop_policy.hpp"
\ No newline at end of file
+#include "airdrop_policy.hpp"
+#include "simd_math.hpp"
+
+namespace Airdrop {
+
+    void AirdropPolicy::calculateTokens(std::span<const double> airdropPoints, std::span<const int> users, std::span<double> tokens) const {
+        for (std::size_t i = 0; i < airdropPoints.size(); ++i)
+            tokens[i] = calculateTokens(airdropPoints[i], users[i]);
+    }
+
+    void LinearAirdropPolicy::calculateTokens(std::span<const double> airdropPoints, std::span<const int> /*users*/, std::span<double> tokens) const {
+        for (std::size_t i = 0; i < airdropPoints.size(); ++i)
+            tokens[i] = factor_ * airdropPoints[i];
+    }
+
+    void ExponentialAirdropPolicy::calculateTokens(std::span<const double> airdropPoints, std::span<const int> users, std::span<double> tokens) const {
+        std::size_t i = SimdMath::clampedExpm1(airdropPoints, tokens, 1.0, factor_, scaling_);
+        for (; i < airdropPoints.size(); ++i)
+            tokens[i] = ExponentialAirdropPolicy::calculateTokens(airdropPoints[i], users[i]);
+    }
+
+    void TieredConstantAirdropPolicy::compileTiers(const std::vector<Tier>& tiers) {
+        thresholds_.clear();
+        amounts_.clear();
+        for (const auto& [threshold, tokenAmt] : tiers) {
+            thresholds_.push_back(threshold);
+            amounts_.push_back(tokenAmt);
+        }
+        amounts_.push_back(tiers.back().second);
+        table_ = Tiers::TierTable(thresholds_, Tiers::Bound::Below);
+    }
+
+    void TieredConstantAirdropPolicy::calculateTokens(std::span<const double> airdropPoints, std::span<const int> /*users*/, std::span<double> tokens) const {
+        std::size_t i = 0;
+        if (table_.size() <= Tiers::TierTable::kMaxUnrolled) {
+            SimdMath::TierArrays arrays{ thresholds_.data(), nullptr, nullptr, amounts_.data(), nullptr, thresholds_.size(), amounts_.back() };
+            i = SimdMath::tierStep(airdropPoints, tokens, arrays);
+        }
+        auto rest = tokens.subspan(i);
+        table_.forEachTier(airdropPoints.subspan(i), [&](std::size_t j, std::uint32_t k) { rest[j] = amounts_[k]; });
+    }
+
+    // Lower-tier contributions are accumulated in the same order as a tier-by-tier scan, so prefix_[k]
+    // is bit-identical to the running total that scan reaches at tier k.
+    void TieredLinearAirdropPolicy::compileTiers(const std::vector<Tier>& tiers) {
+        thresholds_.clear();
+        prev_.clear();
+        prefix_.clear();
+        factors_.clear();
+        double tokens = 0.0;
+        double prevThreshold = 0.0;
+        for (const auto& [threshold, factor] : tiers) {
+            thresholds_.push_back(threshold);
+            prev_.push_back(prevThreshold);
+            prefix_.push_back(tokens);
+            factors_.push_back(factor);
+            tokens += (threshold - prevThreshold) * factor;
+            prevThreshold = threshold;
+        }
+        tail_ = tokens;
+        table_ = Tiers::TierTable(thresholds_, Tiers::Bound::AtMost);
+    }
+
+    void TieredLinearAirdropPolicy::calculateTokens(std::span<const double> airdropPoints, std::span<const int> /*users*/, std::span<double> tokens) const {
+        std::size_t i = 0;
+        if (table_.size() <= Tiers::TierTable::kMaxUnrolled) {
+            SimdMath::TierArrays arrays{ thresholds_.data(), prev_.data(), prefix_.data(), factors_.data(), nullptr, thresholds_.size(), tail_ };
+            i = SimdMath::tierLinear(airdropPoints, tokens, arrays);
+        }
+        auto points = airdropPoints.subspan(i);
+        auto rest = tokens.subspan(i);
+        table_.forEachTier(points, [&](std::size_t j, std::uint32_t k) { rest[j] = tokensInTier(points[j], k); });
+    }
+
+    void TieredExponentialAirdropPolicy::compileTiers(const std::vector<Tier>& tiers) {
+        thresholds_.clear();
+        prev_.clear();
+        prefix_.clear();
+        factors_.clear();
+        scalings_.clear();
+        double tokens = 0.0;
+        double prevThreshold = 0.0;
+        for (const auto& [threshold, params] : tiers) {
+            thresholds_.push_back(threshold);
+            prev_.push_back(prevThreshold);
+            prefix_.push_back(tokens);
+            factors_.push_back(params.factor);
+            scalings_.push_back(params.scaling);
+            tokens += params.factor * (std::exp((threshold - prevThreshold) / params.scaling) - 1.0);
+            prevThreshold = threshold;
+        }
+        tail_ = tokens;
+        table_ = Tiers::TierTable(thresholds_, Tiers::Bound::AtMost);
+    }
+
+    void TieredExponentialAirdropPolicy::calculateTokens(std::span<const double> airdropPoints, std::span<const int> /*users*/, std::span<double> tokens) const {
+        std::size_t i = 0;
+        if (table_.size() <= Tiers::TierTable::kMaxUnrolled) {
+            SimdMath::TierArrays arrays{ thresholds_.data(), prev_.data(), prefix_.data(), factors_.data(), scalings_.data(), thresholds_.size(), tail_ };
+            i = SimdMath::tierExp(airdropPoints, tokens, arrays);
+        }
+        auto points = airdropPoints.subspan(i);
+        auto rest = tokens.subspan(i);
+        table_.forEachTier(points, [&](std::size_t j, std::uint32_t k) { rest[j] = tokensInTier(points[j], k); });
+    }
+
+} // namespace Airdrop
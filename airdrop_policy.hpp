@@ -5,6 +5,8 @@
 #include <limits>
 #include <vector>
 #include <algorithm>
+#include <span>
+#include "tier_table.hpp"
 
 namespace Airdrop {
 
@@ -14,6 +16,9 @@ namespace Airdrop {
         virtual double calculateTokens(double airdropPoints, int /*user*/) const {
             return airdropPoints;
         }
+        // Batch entry point: one virtual call for a whole points column. The default forwards to the
+        // per-user overload; the built-in policies override it with vectorized kernels.
+        virtual void calculateTokens(std::span<const double> airdropPoints, std::span<const int> users, std::span<double> tokens) const;
     protected:
         alignas(64) char padding[64]; // padding to reduce false sharing
     };
@@ -24,6 +29,7 @@ namespace Airdrop {
         double calculateTokens(double airdropPoints, int /*user*/) const override {
             return factor_ * airdropPoints;
         }
+        void calculateTokens(std::span<const double> airdropPoints, std::span<const int> users, std::span<double> tokens) const override;
     private:
         double factor_;
         alignas(64) char padding[64];
@@ -37,31 +43,34 @@ namespace Airdrop {
             double points = std::min(airdropPoints, 1.0);
             return factor_ * (std::exp(points / scaling_) - 1.0);
         }
+        void calculateTokens(std::span<const double> airdropPoints, std::span<const int> users, std::span<double> tokens) const override;
     private:
         double factor_;
         double scaling_;
         alignas(64) char padding[64];
     };
 
+    // The tiered policies compile their tiers into a Tiers::TierTable plus per-tier arrays indexed by
+    // its result, so one user costs a branch-free O(log tiers) search instead of a scan. Small tables
+    // (up to TierTable::kMaxUnrolled tiers) keep the SIMD blend kernels for the batch form.
     class TieredConstantAirdropPolicy : public AirdropPolicy {
     public:
         using Tier = std::pair<double, double>;
         explicit TieredConstantAirdropPolicy(const std::vector<Tier>& tiers = {}) {
-            if (tiers.empty()) {
-                tiers_ = { {0.2, 0.1}, {0.6, 0.4}, {std::numeric_limits<double>::infinity(), 1.0} };
-            } else {
-                tiers_ = tiers;
-            }
+            if (tiers.empty())
+                compileTiers({ {0.2, 0.1}, {0.6, 0.4}, {std::numeric_limits<double>::infinity(), 1.0} });
+            else
+                compileTiers(tiers);
         }
         double calculateTokens(double airdropPoints, int /*user*/) const override {
-            for (const auto& [threshold, tokenAmt] : tiers_) {
-                if (airdropPoints < threshold)
-                    return tokenAmt;
-            }
-            return tiers_.back().second;
+            return amounts_[table_.find(airdropPoints)];
         }
+        void calculateTokens(std::span<const double> airdropPoints, std::span<const int> users, std::span<double> tokens) const override;
     private:
-        std::vector<Tier> tiers_;
+        Tiers::TierTable table_;
+        std::vector<double> thresholds_;
+        std::vector<double> amounts_; // one per tier, then the last tier's amount for values past every tier
+        void compileTiers(const std::vector<Tier>& tiers);
         alignas(64) char padding[64];
     };
 
@@ -69,28 +78,26 @@ namespace Airdrop {
     public:
         using Tier = std::pair<double, double>;
         explicit TieredLinearAirdropPolicy(const std::vector<Tier>& tiers = {}) {
-            if (tiers.empty()) {
-                tiers_ = { {0.2, 1.0}, {0.6, 1.5}, {std::numeric_limits<double>::infinity(), 2.0} };
-            } else {
-                tiers_ = tiers;
-            }
+            if (tiers.empty())
+                compileTiers({ {0.2, 1.0}, {0.6, 1.5}, {std::numeric_limits<double>::infinity(), 2.0} });
+            else
+                compileTiers(tiers);
         }
         double calculateTokens(double airdropPoints, int /*user*/) const override {
-            double tokens = 0.0;
-            double prevThreshold = 0.0;
-            for (const auto& [threshold, factor] : tiers_) {
-                if (airdropPoints <= threshold) {
-                    tokens += (airdropPoints - prevThreshold) * factor;
-                    return tokens;
-                } else {
-                    tokens += (threshold - prevThreshold) * factor;
-                    prevThreshold = threshold;
-                }
-            }
-            return tokens;
+            return tokensInTier(airdropPoints, table_.find(airdropPoints));
         }
+        void calculateTokens(std::span<const double> airdropPoints, std::span<const int> users, std::span<double> tokens) const override;
     private:
-        std::vector<Tier> tiers_;
+        Tiers::TierTable table_;
+        std::vector<double> thresholds_;
+        std::vector<double> prev_;
+        std::vector<double> prefix_;
+        std::vector<double> factors_;
+        double tail_;
+        double tokensInTier(double airdropPoints, std::size_t k) const {
+            return k < prefix_.size() ? prefix_[k] + (airdropPoints - prev_[k]) * factors_[k] : tail_;
+        }
+        void compileTiers(const std::vector<Tier>& tiers);
         alignas(64) char padding[64];
     };
 
@@ -100,31 +107,31 @@ namespace Airdrop {
         using Tier = std::pair<double, TierParams>;
         explicit TieredExponentialAirdropPolicy(const std::vector<Tier>& tiers = {}) {
             if (tiers.empty()) {
-                tiers_ = {
+                compileTiers({
                     {0.2, {1.0, 0.2}},
                     {0.6, {1.5, 0.4}},
                     {std::numeric_limits<double>::infinity(), {2.0, 0.4}}
-                };
+                });
             } else {
-                tiers_ = tiers;
+                compileTiers(tiers);
             }
         }
         double calculateTokens(double airdropPoints, int /*user*/) const override {
-            double tokens = 0.0;
-            double prevThreshold = 0.0;
-            for (const auto& [threshold, params] : tiers_) {
-                if (airdropPoints <= threshold) {
-                    tokens += params.factor * (std::exp((airdropPoints - prevThreshold) / params.scaling) - 1.0);
-                    return tokens;
-                } else {
-                    tokens += params.factor * (std::exp((threshold - prevThreshold) / params.scaling) - 1.0);
-                    prevThreshold = threshold;
-                }
-            }
-            return tokens;
+            return tokensInTier(airdropPoints, table_.find(airdropPoints));
         }
+        void calculateTokens(std::span<const double> airdropPoints, std::span<const int> users, std::span<double> tokens) const override;
     private:
-        std::vector<Tier> tiers_;
+        Tiers::TierTable table_;
+        std::vector<double> thresholds_;
+        std::vector<double> prev_;
+        std::vector<double> prefix_;
+        std::vector<double> factors_;
+        std::vector<double> scalings_;
+        double tail_;
+        double tokensInTier(double airdropPoints, std::size_t k) const {
+            return k < prefix_.size() ? prefix_[k] + factors_[k] * (std::exp((airdropPoints - prev_[k]) / scalings_[k]) - 1.0) : tail_;
+        }
+        void compileTiers(const std::vector<Tier>& tiers);
         alignas(64) char padding[64];
     };
 
@@ -0,0 +1,648 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "airdrop_policy.hpp"
+#include "preTGE_rewards.hpp"
+#include "postTGE_rewards.hpp"
+#include "simulation.hpp"
+#include "price_paths.hpp"
+#include "user_pool.hpp"
+#include "activity.hpp"
+#include "formula.hpp"
+#include "rng.hpp"
+#include "simd_math.hpp"
+#include "sybil_filter.hpp"
+#include "thread_pool.hpp"
+#include "tier_table.hpp"
+
+// Micro and macro benchmarks for the simulation hot paths.
+//   bench [--filter S] [--min-time SEC] [--repetitions N] [--max-users N] [--threads N]
+//         [--json FILE] [--compare BASELINE.json] [--threshold FRACTION]
+//   bench --verify [--filter S]
+// Results are written as JSON (stdout unless --json). With --compare, each benchmark's median is
+// checked against the baseline and the exit status is 1 if any is slower by more than the threshold.
+// --verify runs no benchmarks: it checks the optimized kernels against plain reference code on
+// generated inputs and exits with status 1 on any mismatch.
+
+namespace {
+
+    template<typename T>
+    inline void doNotOptimize(const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    struct Benchmark {
+        std::string name;
+        std::size_t items; // work items per iteration, for throughput
+        std::function<void()> body;
+        // Macro benchmarks are too slow to calibrate; they run a fixed single iteration per repetition.
+        bool macro = false;
+    };
+
+    struct Measurement {
+        std::string name;
+        std::size_t iterations;
+        double medianNs;
+        double minNs;
+        double itemsPerSecond;
+    };
+
+    struct Options {
+        std::string filter;
+        double minTime = 0.2;
+        int repetitions = 5;
+        std::size_t maxUsers = 1000000;
+        std::size_t threads = 0;
+        bool useThreads = false;
+        std::string jsonPath;
+        std::string comparePath;
+        double threshold = 0.10;
+        bool verify = false;
+    };
+
+    struct CheckResult {
+        std::size_t cases = 0;
+        std::size_t failures = 0;
+    };
+
+    struct Check {
+        std::string name;
+        std::function<CheckResult()> run;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    double timeIterations(const Benchmark& bench, std::size_t iterations) {
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < iterations; ++i)
+            bench.body();
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    Measurement measure(const Benchmark& bench, const Options& options) {
+        std::size_t iterations = 1;
+        bench.body(); // warm-up
+        if (!bench.macro) {
+            // Grow the iteration count until one repetition takes at least minTime
+            double elapsed = timeIterations(bench, iterations);
+            while (elapsed < options.minTime * 1e9 && iterations < (std::size_t{ 1 } << 30)) {
+                double scale = elapsed > 0 ? options.minTime * 1e9 / elapsed : 10.0;
+                iterations = std::max(iterations + 1, static_cast<std::size_t>(iterations * std::min(scale * 1.2, 10.0)));
+                elapsed = timeIterations(bench, iterations);
+            }
+        }
+        std::vector<double> perIteration;
+        for (int r = 0; r < options.repetitions; ++r)
+            perIteration.push_back(timeIterations(bench, iterations) / iterations);
+        std::sort(perIteration.begin(), perIteration.end());
+        double median = perIteration[perIteration.size() / 2];
+        return { bench.name, iterations, median, perIteration.front(), bench.items / (median * 1e-9) };
+    }
+
+    // Reads the name -> median map back from a file written by writeJson.
+    std::unordered_map<std::string, double> readBaseline(const std::string& path) {
+        std::ifstream in(path);
+        if (!in)
+            throw std::runtime_error("cannot open baseline " + path);
+        std::unordered_map<std::string, double> baseline;
+        std::string line;
+        while (std::getline(in, line)) {
+            auto namePos = line.find("\"name\": \"");
+            auto medianPos = line.find("\"median_ns\": ");
+            if (namePos == std::string::npos || medianPos == std::string::npos)
+                continue;
+            namePos += 9;
+            std::string name = line.substr(namePos, line.find('"', namePos) - namePos);
+            baseline[name] = std::stod(line.substr(medianPos + 13));
+        }
+        return baseline;
+    }
+
+    void writeJson(std::ostream& out, const std::vector<Measurement>& results) {
+        out << "{\n  \"simd\": \"" << SimdMath::levelName(SimdMath::activeLevel()) << "\",\n  \"benchmarks\": [\n";
+        out << std::setprecision(6);
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const auto& m = results[i];
+            // One benchmark per line; readBaseline relies on this layout
+            out << "    {\"name\": \"" << m.name << "\", \"iterations\": " << m.iterations
+                << ", \"median_ns\": " << m.medianNs << ", \"min_ns\": " << m.minNs
+                << ", \"items_per_second\": " << m.itemsPerSecond << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+    // Plausible activity values for every feature, so each PreTGE policy exercises all of its tiers.
+    void fillActivity(Activity::ActivityColumns& activity, std::uint64_t seed) {
+        for (std::size_t f = 0; f < Activity::kNumFeatures; ++f) {
+            auto feature = static_cast<Activity::Feature>(f);
+            auto column = activity.column(feature);
+            for (std::size_t i = 0; i < column.size(); ++i) {
+                RNG::Stream rng({ seed, 0 }, static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(f), RNG::Domain::Policy);
+                switch (feature) {
+                    case Activity::Feature::ActiveDays:
+                    case Activity::Feature::ConsecutiveDays: column[i] = rng.below(366); break;
+                    case Activity::Feature::UniqueMarkets: column[i] = rng.below(50); break;
+                    case Activity::Feature::Wins:
+                    case Activity::Feature::Losses: column[i] = rng.below(200); break;
+                    case Activity::Feature::QScore: column[i] = rng.uniform(); break;
+                    default: column[i] = rng.lognormal(8.0, 2.0); break;
+                }
+            }
+        }
+    }
+
+    std::vector<Benchmark> buildBenchmarks(const Options& options, Scheduler::ThreadPool* threadPool) {
+        std::vector<Benchmark> benches;
+        constexpr int kMicroUsers = 100000;
+        constexpr int kPreTGESteps = 50;
+        constexpr int kHorizon = 60;
+        constexpr double kTotalSupply = 1e9;
+
+        // Shared fixture: a pool after a full PreTGE phase, so policies see realistic point values
+        auto pool = std::make_shared<UserPoolNS::UserPool>(kMicroUsers);
+        pool->setThreadPool(threadPool);
+        for (int s = 0; s < kPreTGESteps; ++s)
+            pool->stepAll<Users::Phase::PreTGE>();
+        auto points = std::make_shared<std::vector<double>>(pool->airdropPoints().begin(), pool->airdropPoints().end());
+        auto tokens = std::make_shared<std::vector<double>>(kMicroUsers);
+
+        std::vector<std::pair<std::string, std::shared_ptr<Airdrop::AirdropPolicy>>> airdropPolicies = {
+            {"linear", std::make_shared<Airdrop::LinearAirdropPolicy>()},
+            {"exponential", std::make_shared<Airdrop::ExponentialAirdropPolicy>(1.0, 0.01)},
+            {"tiered_linear", std::make_shared<Airdrop::TieredLinearAirdropPolicy>()},
+            {"tiered_constant", std::make_shared<Airdrop::TieredConstantAirdropPolicy>()},
+            {"tiered_exponential", std::make_shared<Airdrop::TieredExponentialAirdropPolicy>()}
+        };
+        // Campaign-sized tables: 256 tiers evenly over the fixture's point range
+        {
+            constexpr std::size_t kManyTiers = 256;
+            const double maxPoints = *std::max_element(points->begin(), points->end());
+            std::vector<std::pair<double, double>> tiers;
+            for (std::size_t k = 1; k <= kManyTiers; ++k)
+                tiers.push_back({ maxPoints * static_cast<double>(k) / kManyTiers, 1.0 + 0.01 * static_cast<double>(k) });
+            airdropPolicies.push_back({ "tiered_linear_256", std::make_shared<Airdrop::TieredLinearAirdropPolicy>(tiers) });
+            airdropPolicies.push_back({ "tiered_constant_256", std::make_shared<Airdrop::TieredConstantAirdropPolicy>(tiers) });
+        }
+        for (const auto& [name, policy] : airdropPolicies) {
+            benches.push_back({ "airdrop/" + name + "/100k", kMicroUsers, [=]() {
+                policy->calculateTokens(*points, pool->userIds(), *tokens);
+                doNotOptimize(tokens->data());
+            } });
+        }
+
+        auto activity = std::make_shared<Activity::ActivityColumns>(kMicroUsers);
+        fillActivity(*activity, 7);
+        auto preTGEPoints = std::make_shared<std::vector<double>>(kMicroUsers);
+        std::vector<std::pair<std::string, std::shared_ptr<PreTGE::PreTGERewardsPolicy>>> preTGEPolicies = {
+            {"dydx_retro", std::make_shared<PreTGE::DydxRetroTieredRewardPolicy>()},
+            {"vertex_maker_taker", std::make_shared<PreTGE::VertexMakerTakerRewardPolicy>()},
+            {"jupiter_volume_tier", std::make_shared<PreTGE::JupiterVolumeTierRewardPolicy>()},
+            {"aevo_boosted_volume", std::make_shared<PreTGE::AevoBoostedVolumeRewardPolicy>()},
+            {"helix_loyalty", std::make_shared<PreTGE::HelixLoyaltyPointsRewardPolicy>()},
+            {"gamelike_mmr", std::make_shared<PreTGE::GameLikeMMRRewardPolicy>()},
+            {"custom_formula", std::make_shared<PreTGE::CustomPreTGERewardPolicy>(
+                "1000 * log(1 + trading_volume) + 100 * min(unique_markets, 10) + tiers(qscore, 1, 0, 10, 50, 200)")}
+        };
+        for (const auto& [name, policy] : preTGEPolicies) {
+            benches.push_back({ "pretge/" + name + "/100k", kMicroUsers, [=]() {
+                policy->calculatePoints(activity->view(), pool->userIds(), *preTGEPoints, pool->rngKey(), pool->stepCount());
+                doNotOptimize(preTGEPoints->data());
+            } });
+        }
+
+        auto aevo = std::make_shared<PreTGE::AevoBoostedVolumeRewardPolicy>();
+        benches.push_back({ "pretge/aevo_boosted_volume_stream/100k", kMicroUsers, [=]() {
+            RNG::Stream rng({ 7, 0 }, 0, 0, RNG::Domain::Policy);
+            aevo->calculatePoints(activity->view().get<Activity::Feature::TradeVolume>(),
+                                  activity->view().get<Activity::Feature::TrailingVolume>(), rng, *preTGEPoints);
+            doNotOptimize(preTGEPoints->data());
+        } });
+
+        // Sybil filter over the fixture's 50 steps of behaviour
+        auto sybilConfig = std::make_shared<Sybil::FilterConfig>();
+        auto fingerprints = std::make_shared<Sybil::Fingerprints>(Sybil::recordBehaviour(*pool));
+        benches.push_back({ "sybil/fingerprint/100k", kMicroUsers, [=]() {
+            auto recorded = Sybil::recordBehaviour(*pool);
+            doNotOptimize(recorded.row(0).data());
+        } });
+        benches.push_back({ "sybil/cluster/100k", kMicroUsers, [=]() {
+            auto clusters = Sybil::cluster(*fingerprints, *sybilConfig, threadPool);
+            doNotOptimize(clusters.flagged.data());
+        } });
+
+        auto stepPool = std::make_shared<UserPoolNS::UserPool>(kMicroUsers, std::make_shared<Airdrop::LinearAirdropPolicy>());
+        stepPool->setThreadPool(threadPool);
+        benches.push_back({ "userpool/generate/100k", kMicroUsers, [=]() {
+            stepPool->generateUsers();
+            doNotOptimize(stepPool->wealth().data());
+        } });
+        benches.push_back({ "userpool/step_pretge/100k", kMicroUsers, [=]() {
+            stepPool->stepAll<Users::Phase::PreTGE>();
+            doNotOptimize(stepPool->airdropPoints().data());
+        } });
+        benches.push_back({ "userpool/publish_activity/100k", kMicroUsers, [=]() {
+            stepPool->publishActivity();
+            doNotOptimize(stepPool->activity().view().get<Activity::Feature::TradingVolume>().data());
+        } });
+        benches.push_back({ "userpool/step_tge/100k", kMicroUsers, [=]() {
+            stepPool->stepAll<Users::Phase::TGE>();
+            doNotOptimize(stepPool->tokens().data());
+        } });
+        benches.push_back({ "userpool/step_posttge/100k", kMicroUsers, [=]() {
+            stepPool->stepAll<Users::Phase::PostTGE>();
+            doNotOptimize(stepPool->active().data());
+        } });
+
+        auto manager = std::make_shared<PostTGE::PostTGERewardsManager>(kTotalSupply);
+        benches.push_back({ "posttge/unlocked_allocations/61_months", kHorizon + 1, [=]() {
+            for (int month = 0; month <= kHorizon; ++month) {
+                auto allocations = manager->getUnlockedAllocations(month);
+                doNotOptimize(allocations.size());
+            }
+        } });
+
+        // Ten years at daily resolution through the compiled schedules
+        constexpr std::size_t kDailySteps = 3653;
+        auto engine = std::make_shared<PostTGE::VestingEngine>(kTotalSupply);
+        auto vestingMatrix = std::make_shared<std::vector<double>>(kDailySteps * engine->numGroups());
+        auto vestingTotals = std::make_shared<std::vector<double>>(kDailySteps);
+        benches.push_back({ "posttge/vesting_engine/10y_daily", kDailySteps, [=]() {
+            engine->fillHorizon(0.0, 1.0 / PostTGE::kDaysPerMonth, kDailySteps, *vestingMatrix, *vestingTotals);
+            doNotOptimize(vestingTotals->data());
+        } });
+
+        auto unlocked = std::make_shared<std::vector<double>>();
+        for (int month = 0; month <= kHorizon; ++month) {
+            double total = 0.0;
+            for (const auto& [group, amount] : manager->getUnlockedAllocations(month))
+                total += amount;
+            unlocked->push_back(total);
+        }
+        double tgeTotal = 0.15 * kTotalSupply;
+        benches.push_back({ "price/compute_token_price/61_months", kHorizon + 1, [=]() {
+            auto prices = Simulation::computeTokenPrice(tgeTotal, *unlocked, *pool);
+            doNotOptimize(prices.data());
+        } });
+        benches.push_back({ "price/dynamic/61_months", kHorizon + 1, [=]() {
+            auto prices = Simulation::simulatePriceEvolutionDynamic(tgeTotal, *unlocked, *pool);
+            doNotOptimize(prices.data());
+        } });
+
+        // 10^5-point sensitivity grid over all four price parameters
+        auto priceGrid = std::make_shared<std::vector<Simulation::PriceParams>>();
+        for (int b = 0; b < 10; ++b)
+            for (int e = 0; e < 100; ++e)
+                for (int r = 0; r < 10; ++r)
+                    for (int a = 0; a < 10; ++a)
+                        priceGrid->push_back({ 5.0 + b, 0.5 + 0.01 * e, 0.05 * r, 0.1 * a });
+        double sellWeight = pool->averageSellWeight();
+        benches.push_back({ "price/sweep/100k_points", priceGrid->size() * (kHorizon + 1), [=]() {
+            auto sweep = Simulation::sweepTokenPrice(tgeTotal, *unlocked, sellWeight, *priceGrid, threadPool);
+            doNotOptimize(sweep.prices.data());
+        } });
+
+        auto supplyPrice = std::make_shared<std::vector<double>>(Simulation::computeTokenPrice(tgeTotal, *unlocked, *pool));
+        benches.push_back({ "price/paths/100k_x_61_months", 100000 * (kHorizon + 1), [=]() {
+            auto bands = PricePaths::simulatePricePaths(*supplyPrice, 100000, {}, {}, threadPool);
+            doNotOptimize(bands.mean.data());
+        }, true });
+
+        for (int numUsers : { 10000, 100000, 1000000 }) {
+            if (static_cast<std::size_t>(numUsers) > options.maxUsers)
+                continue;
+            std::string label = numUsers >= 1000000 ? std::to_string(numUsers / 1000000) + "m" : std::to_string(numUsers / 1000) + "k";
+            benches.push_back({ "simulation/run/" + label, static_cast<std::size_t>(numUsers), [=]() {
+                Simulation::MonteCarloSimulation sim(numUsers, kTotalSupply, kPreTGESteps, kHorizon,
+                                                     std::make_shared<Airdrop::LinearAirdropPolicy>(),
+                                                     std::make_shared<PreTGE::DydxRetroTieredRewardPolicy>());
+                sim.setThreadPool(threadPool);
+                auto result = sim.run();
+                doNotOptimize(result.prices.data());
+            }, true });
+        }
+        return benches;
+    }
+
+    // The tier a front-to-back scan of the thresholds stops at; TierTable::find must agree for any table.
+    std::size_t scanTiers(std::span<const double> thresholds, Tiers::Bound bound, double value) {
+        for (std::size_t k = 0; k < thresholds.size(); ++k) {
+            const double t = thresholds[k];
+            const bool match = bound == Tiers::Bound::Below ? value < t : bound == Tiers::Bound::AtMost ? value <= t : !(value >= t);
+            if (match)
+                return k;
+        }
+        return thresholds.size();
+    }
+
+    double specialValue(RNG::Stream& rng) {
+        constexpr std::array<double, 5> kSpecial = { NAN, INFINITY, -INFINITY, 0.0, -0.0 };
+        return kSpecial[rng.below(kSpecial.size())];
+    }
+
+    // Random tables of 1-300 tiers, sorted as the policies build them or in any order, with NaN and
+    // infinite thresholds; values land on, next to and between the thresholds. Every bound is checked
+    // through find(value) and the batch find(), which take different code paths.
+    CheckResult verifyTierTables() {
+        constexpr std::uint32_t kTables = 3000;
+        constexpr std::size_t kValues = 200;
+        CheckResult result;
+        for (std::uint32_t t = 0; t < kTables; ++t) {
+            RNG::Stream rng({ 24, 0 }, t, 0, RNG::Domain::Policy);
+            const std::size_t size = 1 + rng.below(rng.below(2) ? Tiers::TierTable::kMaxUnrolled : 300);
+            const bool sorted = rng.below(4) != 0;
+            std::vector<double> thresholds(size);
+            double level = std::round(rng.uniform(-50.0, 50.0));
+            for (double& threshold : thresholds) {
+                level += rng.below(3); // repeated thresholds included
+                threshold = rng.below(16) == 0 ? specialValue(rng) : sorted ? level : std::round(rng.uniform(-100.0, 400.0));
+            }
+            std::vector<double> values(kValues);
+            for (double& value : values) {
+                const double near = thresholds[rng.below(static_cast<std::uint32_t>(size))];
+                switch (rng.below(6)) {
+                    case 0: value = near; break;
+                    case 1: value = std::nextafter(near, -INFINITY); break;
+                    case 2: value = std::nextafter(near, INFINITY); break;
+                    case 3: value = specialValue(rng); break;
+                    default: value = rng.uniform(-150.0, 450.0); break;
+                }
+            }
+            for (Tiers::Bound bound : { Tiers::Bound::Below, Tiers::Bound::AtMost, Tiers::Bound::Unreached }) {
+                Tiers::TierTable table(thresholds, bound);
+                std::vector<std::uint32_t> tiers(kValues);
+                table.find(values, tiers);
+                for (std::size_t i = 0; i < kValues; ++i) {
+                    const std::size_t expected = scanTiers(thresholds, bound, values[i]);
+                    ++result.cases;
+                    if (table.find(values[i]) == expected && tiers[i] == expected)
+                        continue;
+                    if (result.failures++ < 5)
+                        std::cerr << "  table " << t << " (" << size << " tiers, bound " << static_cast<int>(bound) << "): value "
+                                  << values[i] << " scans to " << expected << ", find " << table.find(values[i])
+                                  << ", batch " << tiers[i] << std::endl;
+                }
+            }
+        }
+        return result;
+    }
+
+    // Formula programs against the std::function policies they stand in for, on realistic activity with
+    // zero, negative, NaN and infinite values mixed in. The batch program, the per-user map overload and
+    // the lambda must agree to a few ulp (exp and pow go through SimdMath); NaN must match NaN.
+    CheckResult verifyFormulas() {
+        using Stats = std::unordered_map<std::string, double>;
+        auto get = [](const Stats& stats, const char* name) {
+            auto it = stats.find(name);
+            return it == stats.end() ? 0.0 : it->second;
+        };
+        const std::vector<std::pair<std::string, std::function<double(const Stats&, int)>>> cases = {
+            { "1000 * log(1 + trading_volume) + 100 * min(unique_markets, 10) + tiers(qscore, 0.25, 0, 0.75, 50, 200)",
+              [=](const Stats& st, int) {
+                  const double q = get(st, "qscore");
+                  return 1000 * std::log(1 + get(st, "trading_volume")) + 100 * std::min(get(st, "unique_markets"), 10.0) +
+                         (q < 0.25 ? 0.0 : q < 0.75 ? 50.0 : 200.0);
+              } },
+            { "sqrt(trade_volume) * (wins - losses) / (1 + active_days)",
+              [=](const Stats& st, int) {
+                  return std::sqrt(get(st, "trade_volume")) * (get(st, "wins") - get(st, "losses")) / (1 + get(st, "active_days"));
+              } },
+            { "max(maker_volume, taker_volume, referral_points) - abs(qscore - 0.5) * -2",
+              [=](const Stats& st, int) {
+                  return std::max(std::max(get(st, "maker_volume"), get(st, "taker_volume")), get(st, "referral_points")) -
+                         std::abs(get(st, "qscore") - 0.5) * -2;
+              } },
+            { "exp(-qscore) * pow(1 + consecutive_days, 0.5) + swap_volume ^ 2 / 1e9",
+              [=](const Stats& st, int) {
+                  return std::exp(-get(st, "qscore")) * std::pow(1 + get(st, "consecutive_days"), 0.5) +
+                         std::pow(get(st, "swap_volume"), 2) / 1e9;
+              } },
+            { "2 * (3 + 4) - 1", [](const Stats&, int) { return 13.0; } },
+        };
+
+        constexpr std::size_t kUsers = 10007; // not a whole number of blocks
+        Activity::ActivityColumns activity(kUsers);
+        fillActivity(activity, 25);
+        constexpr std::array<double, 4> kEdges = { 0.0, -1.0, NAN, INFINITY };
+        for (std::size_t f = 0; f < Activity::kNumFeatures; ++f) {
+            auto column = activity.column(static_cast<Activity::Feature>(f));
+            for (std::size_t i = f; i < kUsers; i += 97)
+                column[i] = kEdges[(i / 97) % kEdges.size()];
+        }
+        std::vector<int> users(kUsers);
+        for (std::size_t i = 0; i < kUsers; ++i)
+            users[i] = static_cast<int>(i);
+        auto same = [](double a, double b) {
+            if (std::isnan(a) || std::isnan(b))
+                return std::isnan(a) && std::isnan(b);
+            return a == b || std::abs(a - b) <= 1e-12 * std::max({ 1.0, std::abs(a), std::abs(b) });
+        };
+
+        CheckResult result;
+        std::vector<double> fromFormula(kUsers);
+        std::vector<double> fromLambda(kUsers);
+        const Activity::ActivityView view = activity.view();
+        for (const auto& [source, lambda] : cases) {
+            PreTGE::CustomPreTGERewardPolicy formula(source);
+            PreTGE::CustomPreTGERewardPolicy reference(lambda);
+            formula.calculatePoints(view, users, fromFormula, {}, 0);
+            reference.calculatePoints(view, users, fromLambda, {}, 0);
+            for (std::size_t i = 0; i < kUsers; ++i) {
+                const double single = formula.calculatePoints(view.row(i), users[i]);
+                ++result.cases;
+                if (same(fromFormula[i], fromLambda[i]) && same(single, fromLambda[i]))
+                    continue;
+                if (result.failures++ < 5)
+                    std::cerr << std::setprecision(17) << "  \"" << source << "\" user " << i << ": batch " << fromFormula[i]
+                              << ", map " << single << ", lambda " << fromLambda[i] << std::endl;
+            }
+        }
+
+        // A short output span is an error, not an overrun
+        ++result.cases;
+        try {
+            Formula::Program("trading_volume").evaluate(view, std::span<double>(fromFormula).first(kUsers - 1));
+            ++result.failures;
+            std::cerr << "  evaluate accepted " << kUsers - 1 << " outputs for " << kUsers << " users" << std::endl;
+        } catch (const std::runtime_error&) {
+        }
+        return result;
+    }
+
+    // Every policy's batch calculateTokens against its per-user overload, at each SIMD level this CPU
+    // runs. Lengths leave a remainder after the 4- and 8-wide blocks; points sit on and next to the tier
+    // thresholds and include negative, NaN and infinite values. Linear and the constant/linear tiers must
+    // match bit for bit. The exp kernels are within 2 ulp of std::exp, so the exp-based policies may be
+    // off by 4 ulp of max(|tokens|, factor): factor * (exp(x) - 1) cancels as x nears 0, leaving an error
+    // that scales with factor rather than with the tokens.
+    CheckResult verifyAirdropBatch() {
+        using namespace Airdrop;
+        struct Case { std::string name; std::shared_ptr<AirdropPolicy> policy; double expFactor; };
+        const std::vector<Case> cases = {
+            { "linear", std::make_shared<LinearAirdropPolicy>(), 0.0 },
+            { "linear(2.5)", std::make_shared<LinearAirdropPolicy>(2.5), 0.0 },
+            { "exponential", std::make_shared<ExponentialAirdropPolicy>(), 1.0 },
+            { "exponential(1.3, 0.7)", std::make_shared<ExponentialAirdropPolicy>(1.3, 0.7), 1.3 },
+            { "tiered_constant", std::make_shared<TieredConstantAirdropPolicy>(), 0.0 },
+            { "tiered_linear", std::make_shared<TieredLinearAirdropPolicy>(), 0.0 },
+            { "tiered_exponential", std::make_shared<TieredExponentialAirdropPolicy>(), 2.0 },
+        };
+        constexpr std::array<double, 4> kThresholds = { 0.0, 0.2, 0.6, 1.0 };
+        constexpr std::array<std::size_t, 7> kLengths = { 1, 3, 5, 7, 13, 1001, 10007 };
+        constexpr double kExpUlps = 4.0;
+
+        auto same = [](double batch, double single, double expFactor) {
+            if (std::isnan(batch) || std::isnan(single))
+                return std::isnan(batch) && std::isnan(single);
+            if (batch == single || expFactor == 0.0 || std::isinf(batch) || std::isinf(single))
+                return batch == single;
+            const double scale = std::max(std::abs(single), expFactor);
+            return std::abs(batch - single) <= kExpUlps * (std::nextafter(scale, INFINITY) - scale);
+        };
+
+        CheckResult result;
+        const SimdMath::Level active = SimdMath::activeLevel();
+        const SimdMath::Level detected = SimdMath::detectedLevel();
+        for (SimdMath::Level level : { SimdMath::Level::Scalar, SimdMath::Level::AVX2, SimdMath::Level::AVX512 }) {
+            if (level > detected)
+                continue;
+            SimdMath::setLevel(level);
+            for (std::size_t length : kLengths) {
+                RNG::Stream rng({ 3, 0 }, static_cast<std::uint32_t>(length), 0, RNG::Domain::Policy);
+                std::vector<double> points(length);
+                std::vector<int> users(length);
+                for (std::size_t i = 0; i < length; ++i) {
+                    const double near = kThresholds[rng.below(kThresholds.size())];
+                    switch (rng.below(7)) {
+                        case 0: points[i] = near; break;
+                        case 1: points[i] = std::nextafter(near, -INFINITY); break;
+                        case 2: points[i] = std::nextafter(near, INFINITY); break;
+                        case 3: points[i] = specialValue(rng); break;
+                        case 4: points[i] = -rng.uniform(0.0, 5.0); break;
+                        default: points[i] = rng.uniform(0.0, 2.0); break;
+                    }
+                    users[i] = static_cast<int>(i);
+                }
+                std::vector<double> tokens(length);
+                for (const auto& [name, policy, expFactor] : cases) {
+                    policy->calculateTokens(points, users, tokens);
+                    for (std::size_t i = 0; i < length; ++i) {
+                        const double single = policy->calculateTokens(points[i], users[i]);
+                        ++result.cases;
+                        if (same(tokens[i], single, expFactor))
+                            continue;
+                        if (result.failures++ < 5)
+                            std::cerr << std::setprecision(17) << "  " << name << " at " << SimdMath::levelName(level) << ", length "
+                                      << length << ": points " << points[i] << " batch " << tokens[i] << ", per-user " << single
+                                      << std::endl;
+                    }
+                }
+            }
+        }
+        SimdMath::setLevel(active);
+        return result;
+    }
+
+    std::vector<Check> buildChecks() {
+        return {
+            { "tier_table/scan", verifyTierTables },
+            { "formula/lambda", verifyFormulas },
+            { "airdrop/batch", verifyAirdropBatch },
+        };
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc)
+            options.filter = argv[++i];
+        else if (arg == "--min-time" && i + 1 < argc)
+            options.minTime = std::stod(argv[++i]);
+        else if (arg == "--repetitions" && i + 1 < argc)
+            options.repetitions = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--max-users" && i + 1 < argc)
+            options.maxUsers = std::stoul(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::stoul(argv[++i]);
+            options.useThreads = true;
+        } else if (arg == "--json" && i + 1 < argc)
+            options.jsonPath = argv[++i];
+        else if (arg == "--compare" && i + 1 < argc)
+            options.comparePath = argv[++i];
+        else if (arg == "--threshold" && i + 1 < argc)
+            options.threshold = std::stod(argv[++i]);
+        else if (arg == "--verify")
+            options.verify = true;
+        else {
+            std::cerr << "unknown argument: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    if (options.verify) {
+        std::size_t failed = 0;
+        for (const auto& check : buildChecks()) {
+            if (!options.filter.empty() && check.name.find(options.filter) == std::string::npos)
+                continue;
+            CheckResult result = check.run();
+            failed += result.failures > 0;
+            std::cerr << (result.failures > 0 ? "FAIL " : "ok   ") << std::left << std::setw(40) << check.name << std::right
+                      << result.cases << " cases, " << result.failures << " mismatches" << std::endl;
+        }
+        return failed > 0 ? 1 : 0;
+    }
+
+    // Single-threaded by default so timings are stable; --threads adds a pool for the user kernels
+    std::unique_ptr<Scheduler::ThreadPool> threadPool;
+    if (options.useThreads)
+        threadPool = std::make_unique<Scheduler::ThreadPool>(options.threads);
+
+    std::vector<Measurement> results;
+    for (const auto& bench : buildBenchmarks(options, threadPool.get())) {
+        if (!options.filter.empty() && bench.name.find(options.filter) == std::string::npos)
+            continue;
+        results.push_back(measure(bench, options));
+        const auto& m = results.back();
+        std::cerr << std::left << std::setw(44) << m.name << std::right << std::setw(14) << std::fixed
+                  << std::setprecision(0) << m.medianNs << " ns" << std::setw(14) << std::setprecision(2)
+                  << m.itemsPerSecond / 1e6 << " M items/s" << std::endl;
+    }
+
+    if (options.jsonPath.empty()) {
+        writeJson(std::cout, results);
+    } else {
+        std::ofstream out(options.jsonPath);
+        writeJson(out, results);
+    }
+
+    if (options.comparePath.empty())
+        return 0;
+    auto baseline = readBaseline(options.comparePath);
+    int regressions = 0;
+    for (const auto& m : results) {
+        auto it = baseline.find(m.name);
+        if (it == baseline.end() || it->second <= 0)
+            continue;
+        double change = m.medianNs / it->second - 1.0;
+        bool regressed = change > options.threshold;
+        regressions += regressed;
+        std::cerr << (regressed ? "REGRESSION " : "ok         ") << std::left << std::setw(44) << m.name << std::right
+                  << std::showpos << std::setprecision(1) << change * 100.0 << std::noshowpos << "%" << std::endl;
+    }
+    return regressions > 0 ? 1 : 0;
+}
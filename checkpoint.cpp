@@ -0,0 +1,239 @@
+#include "checkpoint.hpp"
+#include "codec.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <unistd.h>
+
+namespace Checkpoint {
+
+    namespace {
+        constexpr char kManifestMagic[8] = { 'D', 'E', 'X', 'C', 'K', 'P', '0', '1' };
+        constexpr char kSnapshotMagic[8] = { 'D', 'E', 'X', 'S', 'N', 'P', '0', '2' };
+        constexpr std::uint32_t kRecordMagic = 0x31434552; // "REC1"
+
+        std::vector<std::byte> readFile(const std::string& path) {
+            std::ifstream in(path, std::ios::binary);
+            if (!in)
+                return {};
+            std::vector<char> chars((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            std::vector<std::byte> bytes(chars.size());
+            std::memcpy(bytes.data(), chars.data(), chars.size());
+            return bytes;
+        }
+
+        void writeAll(std::FILE* file, const std::vector<std::byte>& bytes, const std::string& path) {
+            if (std::fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size() || std::fflush(file) != 0 ||
+                fsync(fileno(file)) != 0)
+                throw std::runtime_error("Checkpoint: cannot write " + path);
+        }
+
+        std::vector<std::byte> header(const char (&magic)[8], std::uint64_t fingerprint) {
+            std::vector<std::byte> out;
+            Codec::put(out, magic);
+            Codec::put(out, fingerprint);
+            return out;
+        }
+
+        bool hasHeader(std::span<const std::byte>& in, const char (&magic)[8], std::uint64_t fingerprint) {
+            if (in.size() < sizeof(magic) + sizeof(fingerprint) || std::memcmp(in.data(), magic, sizeof(magic)) != 0)
+                return false;
+            in = in.subspan(sizeof(magic));
+            return Codec::take<std::uint64_t>(in) == fingerprint;
+        }
+    }
+
+    Store::Store(const std::string& dir, std::uint64_t fingerprint, bool resume) : dir_(dir), fingerprint_(fingerprint) {
+        std::filesystem::create_directories(dir_);
+        // A snapshot write interrupted before its rename leaves a .dexs.tmp that nothing ever reads
+        for (const auto& entry : std::filesystem::directory_iterator(dir_)) {
+            const std::filesystem::path& file = entry.path();
+            const bool partial = file.extension() == ".tmp" && file.stem().extension() == ".dexs";
+            if (partial || (!resume && file.extension() == ".dexs"))
+                std::filesystem::remove(file);
+        }
+        if (resume)
+            loadManifest();
+        else
+            std::filesystem::remove(dir_ + "/manifest.dexc");
+        const std::string path = dir_ + "/manifest.dexc";
+        const bool fresh = !std::filesystem::exists(path) || std::filesystem::file_size(path) == 0;
+        manifest_ = std::fopen(path.c_str(), "ab");
+        if (!manifest_)
+            throw std::runtime_error("Checkpoint: cannot open " + path);
+        if (fresh)
+            writeAll(manifest_, header(kManifestMagic, fingerprint_), path);
+        writer_ = std::thread([this] { writerLoop(); });
+    }
+
+    Store::~Store() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        writer_.join();
+        if (manifest_)
+            std::fclose(manifest_);
+    }
+
+    void Store::loadManifest() {
+        const std::string path = dir_ + "/manifest.dexc";
+        std::vector<std::byte> bytes = readFile(path);
+        if (bytes.empty())
+            return;
+        std::span<const std::byte> in(bytes);
+        if (!hasHeader(in, kManifestMagic, fingerprint_))
+            throw std::runtime_error("Checkpoint: " + path + " was written by a different configuration");
+        // Keep every intact record; the first torn or corrupt one ends the log
+        std::size_t validEnd = bytes.size() - in.size();
+        try {
+            while (!in.empty()) {
+                if (Codec::take<std::uint32_t>(in) != kRecordMagic)
+                    break;
+                std::string unit = Codec::takeString(in);
+                std::vector<std::byte> result = Codec::takeVector<std::byte>(in);
+                std::uint64_t checksum = Codec::take<std::uint64_t>(in);
+                if (checksum != Codec::hash(result, Codec::hash(unit)))
+                    break;
+                completed_[unit] = std::move(result);
+                validEnd = bytes.size() - in.size();
+            }
+        } catch (const std::runtime_error&) {
+            // Truncated record
+        }
+        if (validEnd < bytes.size())
+            std::filesystem::resize_file(path, validEnd);
+    }
+
+    const std::vector<std::byte>* Store::completed(const std::string& unit) const {
+        auto it = completed_.find(unit);
+        return it == completed_.end() ? nullptr : &it->second;
+    }
+
+    std::string Store::snapshotPath(const std::string& unit) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/snap-%016llx.dexs", static_cast<unsigned long long>(Codec::hash(unit)));
+        return dir_ + name;
+    }
+
+    std::optional<std::vector<std::byte>> Store::snapshot(const std::string& unit) const {
+        std::vector<std::byte> bytes = readFile(snapshotPath(unit));
+        std::span<const std::byte> in(bytes);
+        if (!hasHeader(in, kSnapshotMagic, fingerprint_))
+            return std::nullopt;
+        try {
+            if (Codec::takeString(in) != unit)
+                return std::nullopt;
+            std::vector<std::byte> state = Codec::takeVector<std::byte>(in);
+            if (Codec::take<std::uint64_t>(in) != Codec::hash(state))
+                return std::nullopt;
+            return state;
+        } catch (const std::runtime_error&) {
+            return std::nullopt;
+        }
+    }
+
+    void Store::saveSnapshot(const std::string& unit, std::vector<std::byte> state) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto queued = std::find_if(queue_.begin(), queue_.end(),
+                                       [&](const Job& job) { return !job.completion && job.unit == unit; });
+            if (queued != queue_.end())
+                queued->bytes = std::move(state);
+            else
+                queue_.push_back({ false, unit, std::move(state) });
+        }
+        wake_.notify_one();
+    }
+
+    void Store::markCompleted(const std::string& unit, std::vector<std::byte> result) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // A snapshot still queued for this unit is obsolete
+            std::erase_if(queue_, [&](const Job& job) { return !job.completion && job.unit == unit; });
+            queue_.push_back({ true, unit, std::move(result) });
+        }
+        wake_.notify_one();
+    }
+
+    void Store::flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return queue_.empty() && !busy_; });
+        if (error_)
+            std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+
+    std::uint64_t Store::bytesWritten() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytesWritten_;
+    }
+
+    void Store::write(const Job& job) {
+        DEX_TRACE_SCOPE(job.completion ? "checkpoint.complete" : "checkpoint.snapshot");
+        if (job.completion) {
+            std::vector<std::byte> record;
+            Codec::put(record, kRecordMagic);
+            Codec::putString(record, job.unit);
+            Codec::putSpan(record, std::span<const std::byte>(job.bytes));
+            Codec::put(record, Codec::hash(job.bytes, Codec::hash(job.unit)));
+            writeAll(manifest_, record, dir_ + "/manifest.dexc");
+            std::filesystem::remove(snapshotPath(job.unit));
+            std::lock_guard<std::mutex> lock(mutex_);
+            bytesWritten_ += record.size();
+            return;
+        }
+        // Write to a temporary name and rename, so a crash leaves either the old snapshot or the new one
+        std::vector<std::byte> image = header(kSnapshotMagic, fingerprint_);
+        Codec::putString(image, job.unit);
+        Codec::putSpan(image, std::span<const std::byte>(job.bytes));
+        Codec::put(image, Codec::hash(job.bytes));
+        const std::string path = snapshotPath(job.unit);
+        const std::string tmpPath = path + ".tmp";
+        std::FILE* file = std::fopen(tmpPath.c_str(), "wb");
+        if (!file)
+            throw std::runtime_error("Checkpoint: cannot open " + tmpPath);
+        try {
+            writeAll(file, image, tmpPath);
+        } catch (...) {
+            std::fclose(file);
+            throw;
+        }
+        std::fclose(file);
+        std::filesystem::rename(tmpPath, path);
+        std::lock_guard<std::mutex> lock(mutex_);
+        bytesWritten_ += image.size();
+    }
+
+    void Store::writerLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (queue_.empty())
+                break;
+            Job job = std::move(queue_.front());
+            queue_.pop_front();
+            busy_ = true;
+            lock.unlock();
+            try {
+                write(job);
+            } catch (...) {
+                lock.lock();
+                if (!error_)
+                    error_ = std::current_exception();
+                lock.unlock();
+            }
+            lock.lock();
+            busy_ = false;
+            if (queue_.empty())
+                idle_.notify_all();
+        }
+        idle_.notify_all();
+    }
+
+} // namespace Checkpoint
@@ -0,0 +1,81 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Checkpoint {
+
+    // Durable progress of a long sweep, kept in one directory:
+    //   manifest.dexc     append-only log of completed work units and their encoded results; each record
+    //                     carries a checksum, and a torn tail is dropped (and truncated) on resume
+    //   snap-<hash>.dexs  latest state of an in-flight unit, replaced atomically by rename
+    // Both start with the run fingerprint so a resume against a different configuration is rejected.
+    // Writes go through one background thread; callers only pay for encoding their state.
+    class Store {
+    public:
+        // Without `resume`, any previous manifest and snapshots in `dir` are discarded. With it, completed
+        // units are loaded; throws std::runtime_error if the directory belongs to another fingerprint.
+        // Leftover partial snapshot writes (*.dexs.tmp) are removed either way.
+        Store(const std::string& dir, std::uint64_t fingerprint, bool resume);
+        // Drains outstanding writes.
+        ~Store();
+        Store(const Store&) = delete;
+        Store& operator=(const Store&) = delete;
+
+        // Result recorded for `unit` by a previous run, or null.
+        const std::vector<std::byte>* completed(const std::string& unit) const;
+        // Latest state saved for an unfinished `unit`, if any.
+        std::optional<std::vector<std::byte>> snapshot(const std::string& unit) const;
+
+        // Queues `state` as the unit's snapshot; a snapshot of the same unit still in the queue is replaced.
+        void saveSnapshot(const std::string& unit, std::vector<std::byte> state);
+        // Queues a manifest record; once it is synced the unit's snapshot is deleted.
+        void markCompleted(const std::string& unit, std::vector<std::byte> result);
+        // Blocks until the queue is empty; rethrows the first write error.
+        void flush();
+        std::size_t numCompleted() const { return completed_.size(); }
+        std::uint64_t bytesWritten() const;
+    private:
+        struct Job {
+            bool completion;
+            std::string unit;
+            std::vector<std::byte> bytes;
+        };
+
+        std::string dir_;
+        std::uint64_t fingerprint_;
+        std::unordered_map<std::string, std::vector<std::byte>> completed_;
+        std::FILE* manifest_ = nullptr;
+
+        mutable std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable idle_;
+        std::deque<Job> queue_;
+        bool busy_ = false;
+        bool stop_ = false;
+        std::exception_ptr error_;
+        std::uint64_t bytesWritten_ = 0;
+        std::thread writer_;
+
+        std::string snapshotPath(const std::string& unit) const;
+        void loadManifest();
+        void write(const Job& job);
+        void writerLoop();
+        alignas(64) char padding[64];
+    };
+
+} // namespace Checkpoint
+
+#endif // CHECKPOINT_HPP
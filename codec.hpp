@@ -0,0 +1,87 @@
+#ifndef CODEC_HPP
+#define CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace Codec {
+
+    // Native-endian binary images of trivially copyable values, for data that is read back by the same
+    // build (shard results, checkpoints). Readers consume from the front of a span and throw
+    // std::runtime_error on truncated input instead of reading past it.
+
+    // Grows `out` by n bytes copied from data (resize + memcpy: no range insert for the optimizer to misjudge).
+    inline void putBytes(std::vector<std::byte>& out, const void* data, std::size_t n) {
+        if (n == 0)
+            return;
+        const std::size_t at = out.size();
+        out.resize(at + n);
+        std::memcpy(out.data() + at, data, n);
+    }
+
+    template<typename T>
+    void put(std::vector<std::byte>& out, const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        putBytes(out, &value, sizeof(T));
+    }
+
+    template<typename T>
+    void putSpan(std::vector<std::byte>& out, std::span<const T> values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        put(out, static_cast<std::uint64_t>(values.size()));
+        putBytes(out, values.data(), values.size_bytes());
+    }
+
+    inline void putString(std::vector<std::byte>& out, const std::string& s) {
+        putSpan(out, std::span<const char>(s));
+    }
+
+    inline std::span<const std::byte> takeBytes(std::span<const std::byte>& in, std::size_t n) {
+        if (in.size() < n)
+            throw std::runtime_error("Codec: truncated input");
+        auto bytes = in.first(n);
+        in = in.subspan(n);
+        return bytes;
+    }
+
+    template<typename T>
+    T take(std::span<const std::byte>& in) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        std::memcpy(&value, takeBytes(in, sizeof(T)).data(), sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    std::vector<T> takeVector(std::span<const std::byte>& in) {
+        auto count = take<std::uint64_t>(in);
+        if (count > in.size() / sizeof(T))
+            throw std::runtime_error("Codec: truncated input");
+        std::vector<T> values(count);
+        std::memcpy(values.data(), takeBytes(in, count * sizeof(T)).data(), count * sizeof(T));
+        return values;
+    }
+
+    inline std::string takeString(std::span<const std::byte>& in) {
+        auto chars = takeVector<char>(in);
+        return std::string(chars.begin(), chars.end());
+    }
+
+    // FNV-1a, 64-bit: record checksums and configuration fingerprints.
+    inline std::uint64_t hash(std::span<const std::byte> bytes, std::uint64_t h = 0xCBF29CE484222325ULL) {
+        for (std::byte b : bytes)
+            h = (h ^ static_cast<std::uint64_t>(b)) * 0x100000001B3ULL;
+        return h;
+    }
+
+    inline std::uint64_t hash(const std::string& s) { return hash(std::as_bytes(std::span<const char>(s))); }
+
+} // namespace Codec
+
+#endif // CODEC_HPP
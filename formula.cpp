@@ -0,0 +1,408 @@
+#include "formula.hpp"
+#include "simd_math.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+
+namespace Formula {
+
+    namespace {
+        struct Node {
+            enum class Kind : std::uint8_t { Number, Feature, Apply };
+            Kind kind = Kind::Number;
+            double value = 0.0;
+            Activity::Feature feature = Activity::Feature::TradingVolume;
+            Op op = Op::Copy;
+            std::vector<std::size_t> args;
+            std::size_t depth = 1;
+        };
+
+        struct Function {
+            const char* name;
+            Op op;
+            std::size_t minArgs;
+            std::size_t maxArgs;
+        };
+
+        constexpr std::size_t kVariadic = std::numeric_limits<std::size_t>::max();
+        // Bounds the parser's and the compiler's recursion, in nested sub-expressions and in tree depth
+        constexpr std::size_t kMaxDepth = 256;
+        constexpr std::array<Function, 8> kFunctions = {{
+            { "min", Op::Min, 2, kVariadic },
+            { "max", Op::Max, 2, kVariadic },
+            { "pow", Op::Pow, 2, 2 },
+            { "log", Op::Log, 1, 1 },
+            { "exp", Op::Exp, 1, 1 },
+            { "sqrt", Op::Sqrt, 1, 1 },
+            { "abs", Op::Abs, 1, 1 },
+            { "tiers", Op::Tiers, 4, kVariadic }
+        }};
+
+        double apply(Op op, double a, double b) {
+            switch (op) {
+                case Op::Copy: return a;
+                case Op::Neg: return -a;
+                case Op::Add: return a + b;
+                case Op::Sub: return a - b;
+                case Op::Mul: return a * b;
+                case Op::Div: return a / b;
+                case Op::Min: return b < a ? b : a;
+                case Op::Max: return a < b ? b : a;
+                case Op::Pow: return std::pow(a, b);
+                case Op::Log: return std::log(a);
+                case Op::Exp: return std::exp(a);
+                case Op::Sqrt: return std::sqrt(a);
+                case Op::Abs: return std::abs(a);
+                case Op::Tiers: break;
+            }
+            return a;
+        }
+
+        // Recursive descent over the grammar in formula.hpp; constant subtrees fold as they are built.
+        class Parser {
+        public:
+            explicit Parser(const std::string& source) : source_(source) {}
+
+            std::size_t parse() {
+                std::size_t root = expr();
+                skipSpace();
+                if (pos_ != source_.size())
+                    fail("unexpected '" + std::string(1, source_[pos_]) + "'");
+                return root;
+            }
+
+            const std::vector<Node>& nodes() const { return nodes_; }
+
+            [[noreturn]] void fail(const std::string& what) const { fail(what, pos_); }
+            [[noreturn]] void fail(const std::string& what, std::size_t at) const {
+                throw std::runtime_error("Formula: " + what + " at position " + std::to_string(at) + " in \"" + source_ + "\"");
+            }
+        private:
+            const std::string& source_;
+            std::size_t pos_ = 0;
+            std::size_t depth_ = 0;
+            std::vector<Node> nodes_;
+
+            void skipSpace() {
+                while (pos_ < source_.size() && std::isspace(static_cast<unsigned char>(source_[pos_])))
+                    ++pos_;
+            }
+
+            bool accept(char c) {
+                skipSpace();
+                if (pos_ < source_.size() && source_[pos_] == c) {
+                    ++pos_;
+                    return true;
+                }
+                return false;
+            }
+
+            void expect(char c) {
+                if (!accept(c))
+                    fail(std::string("expected '") + c + "'");
+            }
+
+            std::size_t number(double value) {
+                Node node;
+                node.value = value;
+                nodes_.push_back(node);
+                return nodes_.size() - 1;
+            }
+
+            std::size_t make(Op op, std::vector<std::size_t> args) {
+                bool folded = std::all_of(args.begin(), args.end(), [&](std::size_t arg) { return nodes_[arg].kind == Node::Kind::Number; });
+                if (folded && op == Op::Tiers) {
+                    std::vector<double> thresholds;
+                    for (std::size_t k = 1; k + 1 < args.size(); k += 2)
+                        thresholds.push_back(nodes_[args[k]].value);
+                    std::size_t tier = Tiers::TierTable(thresholds, Tiers::Bound::Below).find(nodes_[args[0]].value);
+                    return number(nodes_[args[tier < thresholds.size() ? 2 * tier + 2 : args.size() - 1]].value);
+                }
+                if (folded)
+                    return number(apply(op, nodes_[args[0]].value, args.size() > 1 ? nodes_[args[1]].value : 0.0));
+                Node node;
+                node.kind = Node::Kind::Apply;
+                node.op = op;
+                node.args = std::move(args);
+                for (std::size_t arg : node.args)
+                    node.depth = std::max(node.depth, nodes_[arg].depth + 1);
+                if (node.depth > kMaxDepth)
+                    fail("expression too deep");
+                nodes_.push_back(std::move(node));
+                return nodes_.size() - 1;
+            }
+
+            std::size_t expr() {
+                std::size_t lhs = term();
+                for (;;) {
+                    if (accept('+'))
+                        lhs = make(Op::Add, { lhs, term() });
+                    else if (accept('-'))
+                        lhs = make(Op::Sub, { lhs, term() });
+                    else
+                        return lhs;
+                }
+            }
+
+            std::size_t term() {
+                std::size_t lhs = unary();
+                for (;;) {
+                    if (accept('*'))
+                        lhs = make(Op::Mul, { lhs, unary() });
+                    else if (accept('/'))
+                        lhs = make(Op::Div, { lhs, unary() });
+                    else
+                        return lhs;
+                }
+            }
+
+            // Every nested sub-expression (parentheses, arguments, exponents, signs) recurses through here
+            std::size_t unary() {
+                if (++depth_ > kMaxDepth)
+                    fail("formula nested too deeply");
+                std::size_t node = accept('-') ? make(Op::Neg, { unary() }) : power();
+                --depth_;
+                return node;
+            }
+
+            std::size_t power() {
+                std::size_t base = atom();
+                if (accept('^'))
+                    return make(Op::Pow, { base, unary() });
+                return base;
+            }
+
+            std::size_t atom() {
+                skipSpace();
+                if (pos_ == source_.size())
+                    fail("unexpected end of formula");
+                if (accept('(')) {
+                    std::size_t inner = expr();
+                    expect(')');
+                    return inner;
+                }
+                const char c = source_[pos_];
+                if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+                    const char* begin = source_.c_str() + pos_;
+                    char* end = nullptr;
+                    double value = std::strtod(begin, &end);
+                    if (end == begin)
+                        fail("malformed number");
+                    pos_ += static_cast<std::size_t>(end - begin);
+                    return number(value);
+                }
+                if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+                    return name();
+                fail("unexpected '" + std::string(1, c) + "'");
+            }
+
+            std::size_t name() {
+                const std::size_t start = pos_;
+                while (pos_ < source_.size() && (std::isalnum(static_cast<unsigned char>(source_[pos_])) || source_[pos_] == '_'))
+                    ++pos_;
+                const std::string id = source_.substr(start, pos_ - start);
+                if (!accept('(')) {
+                    auto feature = Activity::featureFromName(id);
+                    if (!feature)
+                        fail("unknown name '" + id + "'", start);
+                    Node node;
+                    node.kind = Node::Kind::Feature;
+                    node.feature = *feature;
+                    nodes_.push_back(node);
+                    return nodes_.size() - 1;
+                }
+                auto function = std::find_if(kFunctions.begin(), kFunctions.end(), [&](const Function& f) { return id == f.name; });
+                if (function == kFunctions.end())
+                    fail("unknown function '" + id + "'", start);
+                std::vector<std::size_t> args{ expr() };
+                while (accept(','))
+                    args.push_back(expr());
+                expect(')');
+                if (args.size() < function->minArgs || args.size() > function->maxArgs)
+                    fail("wrong number of arguments to " + id + "()", start);
+                if (function->op == Op::Tiers) {
+                    if (args.size() % 2 != 0)
+                        fail("tiers() takes a value, threshold/value pairs and a fallback", start);
+                    for (std::size_t k = 1; k < args.size(); ++k)
+                        if (nodes_[args[k]].kind != Node::Kind::Number)
+                            fail("tiers() thresholds and values must be constants", start);
+                    return make(Op::Tiers, std::move(args));
+                }
+                if (function->op != Op::Min && function->op != Op::Max)
+                    return make(function->op, std::move(args));
+                // Variadic min/max chain into binary instructions
+                std::size_t acc = args[0];
+                for (std::size_t k = 1; k < args.size(); ++k)
+                    acc = make(function->op, { acc, args[k] });
+                return acc;
+            }
+        };
+    }
+
+    // Lowers the tree to register bytecode. A destination register is allocated before the inputs are
+    // released, so no instruction writes over one of its own inputs (SimdMath::pow requires that).
+    class Compiler {
+    public:
+        Compiler(Program& program, const std::vector<Node>& nodes) : program_(program), nodes_(nodes) {}
+
+        void compile(std::size_t root) {
+            const Node& node = nodes_[root];
+            if (node.kind == Node::Kind::Number) {
+                program_.constant_ = true;
+                program_.constantValue_ = node.value;
+                return;
+            }
+            Operand result = emit(root);
+            if (result.kind != Operand::Kind::Register)
+                push(Op::Copy, result, result, 0);
+        }
+    private:
+        Program& program_;
+        const std::vector<Node>& nodes_;
+        std::vector<std::uint16_t> free_;
+
+        std::uint16_t allocate() {
+            if (!free_.empty()) {
+                std::uint16_t reg = free_.back();
+                free_.pop_back();
+                return reg;
+            }
+            if (program_.numRegisters_ == std::numeric_limits<std::uint16_t>::max())
+                throw std::runtime_error("Formula: too many registers in \"" + program_.source_ + "\"");
+            return static_cast<std::uint16_t>(program_.numRegisters_++);
+        }
+
+        void release(Operand operand) {
+            if (operand.kind == Operand::Kind::Register)
+                free_.push_back(operand.index);
+        }
+
+        Operand push(Op op, Operand a, Operand b, std::uint16_t table) {
+            const std::uint16_t dst = allocate();
+            release(a);
+            if (b.kind != a.kind || b.index != a.index)
+                release(b);
+            program_.code_.push_back({ op, dst, a, b, table });
+            return { Operand::Kind::Register, dst };
+        }
+
+        template<typename T>
+        std::uint16_t intern(std::vector<T>& pool, T value, const char* what) {
+            auto it = std::find(pool.begin(), pool.end(), value);
+            if (it != pool.end())
+                return static_cast<std::uint16_t>(it - pool.begin());
+            if (pool.size() > std::numeric_limits<std::uint16_t>::max())
+                throw std::runtime_error(std::string("Formula: too many ") + what + " in \"" + program_.source_ + "\"");
+            pool.push_back(value);
+            return static_cast<std::uint16_t>(pool.size() - 1);
+        }
+
+        Operand emit(std::size_t index) {
+            const Node& node = nodes_[index];
+            switch (node.kind) {
+                case Node::Kind::Number: return { Operand::Kind::Constant, intern(program_.constants_, node.value, "constants") };
+                case Node::Kind::Feature: return { Operand::Kind::Feature, intern(program_.features_, node.feature, "features") };
+                case Node::Kind::Apply: break;
+            }
+            Operand a = emit(node.args[0]);
+            if (node.op == Op::Tiers) {
+                Program::TierStep step;
+                std::vector<double> thresholds;
+                for (std::size_t k = 1; k + 1 < node.args.size(); k += 2) {
+                    thresholds.push_back(nodes_[node.args[k]].value);
+                    step.values.push_back(nodes_[node.args[k + 1]].value);
+                }
+                step.values.push_back(nodes_[node.args.back()].value);
+                step.table = Tiers::TierTable(thresholds, Tiers::Bound::Below);
+                if (program_.tiers_.size() > std::numeric_limits<std::uint16_t>::max())
+                    throw std::runtime_error("Formula: too many tier tables in \"" + program_.source_ + "\"");
+                program_.tiers_.push_back(std::move(step));
+                return push(Op::Tiers, a, a, static_cast<std::uint16_t>(program_.tiers_.size() - 1));
+            }
+            // Unary instructions read their input as b too, so b always resolves to a valid block
+            Operand b = node.args.size() > 1 ? emit(node.args[1]) : a;
+            return push(node.op, a, b, 0);
+        }
+    };
+
+    Program::Program(const std::string& source) : source_(source) {
+        Parser parser(source_);
+        std::size_t root = parser.parse();
+        Compiler(*this, parser.nodes()).compile(root);
+    }
+
+    void Program::evaluate(const Activity::ActivityView& activity, std::span<double> out) const {
+        const std::size_t size = activity.size();
+        if (out.size() < size)
+            throw std::runtime_error("Formula: " + std::to_string(out.size()) + " outputs for " + std::to_string(size) +
+                                     " users in \"" + source_ + "\"");
+        if (constant_) {
+            std::fill(out.begin(), out.begin() + size, constantValue_);
+            return;
+        }
+        std::vector<double> registers(numRegisters_ * kBlock);
+        std::vector<double> constants(constants_.size() * kBlock);
+        for (std::size_t k = 0; k < constants_.size(); ++k)
+            std::fill_n(constants.data() + k * kBlock, kBlock, constants_[k]);
+        std::array<std::uint32_t, kBlock> tiers;
+
+        for (std::size_t begin = 0; begin < size; begin += kBlock) {
+            const std::size_t n = std::min(kBlock, size - begin);
+            auto resolve = [&](Operand operand) -> const double* {
+                switch (operand.kind) {
+                    case Operand::Kind::Register: return registers.data() + operand.index * kBlock;
+                    case Operand::Kind::Feature: return activity.get(features_[operand.index]).data() + begin;
+                    case Operand::Kind::Constant: break;
+                }
+                return constants.data() + operand.index * kBlock;
+            };
+            for (std::size_t pc = 0; pc < code_.size(); ++pc) {
+                const Instruction& in = code_[pc];
+                const double* __restrict a = resolve(in.a);
+                const double* __restrict b = resolve(in.b);
+                double* __restrict d = pc + 1 == code_.size() ? out.data() + begin : registers.data() + in.dst * kBlock;
+                switch (in.op) {
+                    case Op::Copy: std::copy_n(a, n, d); break;
+                    case Op::Neg: for (std::size_t j = 0; j < n; ++j) d[j] = -a[j]; break;
+                    case Op::Add: for (std::size_t j = 0; j < n; ++j) d[j] = a[j] + b[j]; break;
+                    case Op::Sub: for (std::size_t j = 0; j < n; ++j) d[j] = a[j] - b[j]; break;
+                    case Op::Mul: for (std::size_t j = 0; j < n; ++j) d[j] = a[j] * b[j]; break;
+                    case Op::Div: for (std::size_t j = 0; j < n; ++j) d[j] = a[j] / b[j]; break;
+                    case Op::Min: for (std::size_t j = 0; j < n; ++j) d[j] = b[j] < a[j] ? b[j] : a[j]; break;
+                    case Op::Max: for (std::size_t j = 0; j < n; ++j) d[j] = a[j] < b[j] ? b[j] : a[j]; break;
+                    case Op::Pow: SimdMath::pow({ a, n }, { b, n }, { d, n }); break;
+                    case Op::Exp: SimdMath::exp({ a, n }, { d, n }); break;
+                    case Op::Log: for (std::size_t j = 0; j < n; ++j) d[j] = std::log(a[j]); break;
+                    case Op::Sqrt: for (std::size_t j = 0; j < n; ++j) d[j] = std::sqrt(a[j]); break;
+                    case Op::Abs: for (std::size_t j = 0; j < n; ++j) d[j] = std::abs(a[j]); break;
+                    case Op::Tiers: {
+                        const TierStep& step = tiers_[in.table];
+                        step.table.find({ a, n }, std::span<std::uint32_t>(tiers).first(n));
+                        for (std::size_t j = 0; j < n; ++j)
+                            d[j] = step.values[tiers[j]];
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    double Program::evaluate(const std::unordered_map<std::string, double>& activityStats) const {
+        if (constant_)
+            return constantValue_;
+        Activity::ActivityColumns columns(1);
+        for (Activity::Feature feature : features_) {
+            auto it = activityStats.find(Activity::featureName(feature));
+            if (it != activityStats.end())
+                columns.column(feature)[0] = it->second;
+        }
+        double result = 0.0;
+        evaluate(columns.view(), std::span<double>(&result, 1));
+        return result;
+    }
+
+} // namespace Formula
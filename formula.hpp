@@ -0,0 +1,84 @@
+#ifndef FORMULA_HPP
+#define FORMULA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "activity.hpp"
+#include "tier_table.hpp"
+
+namespace Formula {
+
+    // Reward formulas over the activity features, parsed once and evaluated a block of users at a time:
+    //   expr   := term (('+' | '-') term)*
+    //   term   := unary (('*' | '/') unary)*
+    //   unary  := '-' unary | power
+    //   power  := atom ('^' unary)?
+    //   atom   := number | feature | call | '(' expr ')'
+    //   call   := min(e, e, ...) | max(e, e, ...) | log(e) | exp(e) | sqrt(e) | abs(e) | pow(e, e)
+    //           | tiers(e, t1, v1, ..., tn, vn, fallback)
+    // Features are the Activity names (trading_volume, active_days, ...); missing ones read as 0.
+    // tiers() takes constant thresholds and values: the value of the first tier with e < ti, else fallback.
+    // Example: "1000 * log(1 + trading_volume) + 100 * min(unique_markets, 10)"
+    enum class Op : std::uint8_t { Copy, Neg, Add, Sub, Mul, Div, Min, Max, Pow, Log, Exp, Sqrt, Abs, Tiers };
+
+    // Where an instruction reads an input from
+    struct Operand {
+        enum class Kind : std::uint8_t { Register, Feature, Constant };
+        Kind kind = Kind::Register;
+        std::uint16_t index = 0;
+    };
+
+    struct Instruction {
+        Op op;
+        std::uint16_t dst;
+        Operand a;
+        Operand b;       // binary ops only
+        std::uint16_t table = 0; // Op::Tiers
+    };
+
+    // A compiled formula: register bytecode with constant subexpressions folded. Every instruction runs
+    // as one loop over a block of kBlock users, so the per-instruction dispatch is amortized and the
+    // loops vectorize (exp and pow go through SimdMath). Evaluation only reads the program, so one
+    // instance can be shared across threads.
+    class Program {
+    public:
+        static constexpr std::size_t kBlock = 256;
+
+        // Throws std::runtime_error naming the position of a syntax error, an unknown name or nesting deeper
+        // than 256 levels, or if the program needs more than 65535 constants, tier tables or registers.
+        explicit Program(const std::string& source);
+
+        const std::string& source() const { return source_; }
+        std::span<const Instruction> code() const { return code_; }
+        std::size_t numRegisters() const { return numRegisters_; }
+
+        // out[i] = formula for user i of the view; throws std::runtime_error if out is shorter than the view.
+        void evaluate(const Activity::ActivityView& activity, std::span<double> out) const;
+        // One user given as the legacy string-keyed map.
+        double evaluate(const std::unordered_map<std::string, double>& activityStats) const;
+    private:
+        struct TierStep {
+            Tiers::TierTable table;
+            std::vector<double> values; // one per tier, then the fallback
+        };
+
+        std::string source_;
+        std::vector<Instruction> code_;
+        std::vector<double> constants_;
+        std::vector<TierStep> tiers_;
+        std::vector<Activity::Feature> features_;
+        std::size_t numRegisters_ = 0;
+        // Set when the whole formula folds to a constant
+        bool constant_ = false;
+        double constantValue_ = 0.0;
+
+        friend class Compiler;
+    };
+
+} // namespace Formula
+
+#endif // FORMULA_HPP
@@ -2,21 +2,149 @@
 #include <vector>
 #include <string>
 #include <future>
-#include <unordered_map>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
 #include "airdrop_policy.hpp"
 #include "preTGE_rewards.hpp"
 #include "simulation.hpp"
 #include "user_pool.hpp"
 #include "users.hpp"
 #include "postTGE_rewards.hpp"
-// Include our jthread wrapper if needed
-#include "jthread.h"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+#include "replication.hpp"
+#include "result_store.hpp"
+#include "population.hpp"
+#include "trace.hpp"
+#include "price_paths.hpp"
+#include "streaming.hpp"
+#include "sharding.hpp"
+#include "checkpoint.hpp"
+#include "codec.hpp"
+#include "sybil_filter.hpp"
 
 using namespace Airdrop;
 using namespace PreTGE;
 using namespace Simulation;
 
-int main() {
+int main(int argc, char** argv) {
+    // Master seed: every run with the same seed reproduces bit-for-bit, whatever the thread count
+    std::uint64_t seed = RNG::kDefaultSeed;
+    std::size_t numThreads = 0; // 0 = one worker per hardware thread
+    // Replications per combo; above 1 each combo reports streaming means and confidence intervals
+    Replication::ReplicationConfig replication;
+    replication.maxReplications = 1;
+    std::string resultsPath = "results.dexr";
+    bool compressResults = false;
+    std::string populationPath; // snapshot to load, or to create if missing
+    std::string tracePath;      // Chrome trace of the whole run (needs -DDEX_ENABLE_TRACING=ON)
+    std::size_t pricePaths = 0; // jump-diffusion paths for the price bands of the example combo
+    std::string vestingPath;    // allocation table to use instead of the built-in one
+    std::size_t streamUsers = 0; // above 0: stream this many users in batches and keep only aggregates
+    Streaming::StreamingConfig streaming;
+    bool sharded = false;           // --processes N: fork N workers (0 = one per hardware thread) and merge their shards
+    Sharding::ShardConfig sharding;
+    std::size_t shardUsers = 1 << 20;
+    std::string checkpointDir;  // durable progress for long sweeps; --resume continues from it
+    bool resume = false;
+    int checkpointSteps = 10;   // PreTGE steps between snapshots of an in-flight combo
+    std::optional<Sybil::FilterConfig> sybilFilter; // --sybil-filter MULT: cluster wallets before TGE, scale flagged tokens
+    std::string preTGEFormula;  // extra "Custom" PreTGE policy scoring users by this Formula expression
+    auto usage = [](std::ostream& out) {
+        out << "usage: main [--seed N] [--threads N] [--replications N] [--ci-width F] [--results FILE] [--compress]\n"
+               "            [--population FILE] [--trace FILE] [--price-paths N] [--vesting FILE]\n"
+               "            [--stream-users N] [--batch-size N] [--processes N] [--shard-users N]\n"
+               "            [--checkpoint DIR] [--resume] [--checkpoint-steps N] [--pretge-formula EXPR]\n"
+               "            [--sybil-filter MULT]" << std::endl;
+    };
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const int flagIndex = i;
+        // The flag's value; throws if the command line ends first
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::invalid_argument(arg);
+            return argv[++i];
+        };
+        try {
+            if (arg == "--seed")
+                seed = std::stoull(value());
+            else if (arg == "--threads")
+                numThreads = std::stoul(value());
+            else if (arg == "--replications")
+                replication.maxReplications = std::stoul(value());
+            else if (arg == "--ci-width")
+                replication.targetRelativeCI = std::stod(value());
+            else if (arg == "--results")
+                resultsPath = value();
+            else if (arg == "--compress")
+                compressResults = true;
+            else if (arg == "--population")
+                populationPath = value();
+            else if (arg == "--trace")
+                tracePath = value();
+            else if (arg == "--price-paths")
+                pricePaths = std::stoul(value());
+            else if (arg == "--vesting")
+                vestingPath = value();
+            else if (arg == "--stream-users")
+                streamUsers = std::stoull(value());
+            else if (arg == "--batch-size")
+                streaming.batchSize = std::stoull(value());
+            else if (arg == "--processes") {
+                sharded = true;
+                sharding.workers = std::stoul(value());
+            }
+            else if (arg == "--shard-users")
+                shardUsers = std::stoull(value());
+            else if (arg == "--checkpoint")
+                checkpointDir = value();
+            else if (arg == "--resume")
+                resume = true;
+            else if (arg == "--checkpoint-steps")
+                checkpointSteps = std::stoi(value());
+            else if (arg == "--pretge-formula")
+                preTGEFormula = value();
+            else if (arg == "--sybil-filter") {
+                sybilFilter.emplace();
+                sybilFilter->tokenMultiplier = std::stod(value());
+            }
+            else if (arg == "--help") {
+                usage(std::cout);
+                return 0;
+            }
+            else {
+                std::cerr << "unknown argument: " << arg << std::endl;
+                usage(std::cerr);
+                return 2;
+            }
+        } catch (const std::logic_error&) {
+            // std::invalid_argument and std::out_of_range from value() and the conversions
+            if (i == flagIndex)
+                std::cerr << "missing value for " << arg << std::endl;
+            else
+                std::cerr << "invalid value for " << arg << ": " << argv[i] << std::endl;
+            usage(std::cerr);
+            return 2;
+        }
+    }
+
+    if (!tracePath.empty()) {
+        // Worker processes record into their own trace buffers, which are never sent back to the coordinator
+        if (sharded) {
+            std::cerr << "--trace is not supported with --processes" << std::endl;
+            return 1;
+        }
+        if (!Trace::kCompiledIn)
+            std::cerr << "--trace ignored: rebuild with -DDEX_ENABLE_TRACING=ON" << std::endl;
+        Trace::setEnabled(true);
+    }
+
+    std::vector<PostTGE::ScheduleSpec> vestingSchedules =
+        vestingPath.empty() ? PostTGE::defaultSchedules() : PostTGE::loadSchedules(vestingPath);
+
     // Define airdrop policies
     std::vector<std::pair<std::string, std::shared_ptr<AirdropPolicy>>> airdropPolicies = {
         {"Linear", std::make_shared<LinearAirdropPolicy>()},
@@ -35,6 +163,8 @@ int main() {
         {"Helix Loyalty", std::make_shared<HelixLoyaltyPointsRewardPolicy>()},
         {"Game-like MMR", std::make_shared<GameLikeMMRRewardPolicy>()}
     };
+    if (!preTGEFormula.empty())
+        preTGEPolicies.push_back({"Custom: " + preTGEFormula, std::make_shared<CustomPreTGERewardPolicy>(preTGEFormula)});
 
     // Simulation parameters
     int numUsers = 100000;
@@ -45,33 +175,291 @@ int main() {
     double elasticity = 1.0;
     double buybackRate = 0.2;
 
-    // Run simulations concurrently using std::async
-    std::vector<std::future<std::pair<std::string, SimulationResult>>> futures;
-    for (const auto& prePolicyPair : preTGEPolicies) {
-        for (const auto& adPolicyPair : airdropPolicies) {
-            std::string comboName = prePolicyPair.first + " + " + adPolicyPair.first;
-            std::cout << "Submitting simulation for: " << comboName << std::endl;
-            futures.push_back(std::async(std::launch::async, [=]() -> std::pair<std::string, SimulationResult> {
-                MonteCarloSimulation sim(numUsers, totalSupply, preTGESteps, simulationHorizon, adPolicyPair.second, prePolicyPair.second, 0.15);
-                SimulationResult res = sim.run();
-                return std::make_pair(comboName, res);
+    // Streamed and sharded units keep no per-unit state to resume from; refuse before a Store would reset the directory
+    if (!checkpointDir.empty() && (sharded || streamUsers > 0)) {
+        std::cerr << "--checkpoint is not supported with --stream-users or --processes" << std::endl;
+        return 1;
+    }
+    if (sybilFilter && (sharded || streamUsers > 0))
+        std::cerr << "--sybil-filter ignored: clustering needs the whole population in one pool" << std::endl;
+
+    if (sharded) {
+        // Forked before this process starts any threads. Each work unit streams one user range of one
+        // replication of one PreTGE policy; shards merge in unit order, so output is independent of --processes.
+        const std::size_t users = streamUsers > 0 ? streamUsers : static_cast<std::size_t>(numUsers);
+        const std::uint32_t replications = static_cast<std::uint32_t>(std::max<std::size_t>(1, replication.maxReplications));
+        sharding.threadsPerWorker = std::max<std::size_t>(1, numThreads);
+        std::vector<std::shared_ptr<AirdropPolicy>> airdropFanOut;
+        for (const auto& adPolicyPair : airdropPolicies)
+            airdropFanOut.push_back(adPolicyPair.second);
+        auto makeSim = [&](std::uint32_t combo, std::uint32_t rep) {
+            RNG::StreamKey rngKey{ replications > 1 ? RNG::deriveSeed(seed, rep) : seed, combo };
+            Streaming::StreamingSimulation sim(users, totalSupply, preTGESteps, simulationHorizon, preTGEPolicies[combo].second,
+                                               0.15, rngKey, streaming);
+            sim.setVestingSchedules(vestingSchedules);
+            return sim;
+        };
+        auto units = Sharding::planUnits(static_cast<std::uint32_t>(preTGEPolicies.size()), replications, users, shardUsers);
+        std::cout << "Running " << units.size() << " work units on "
+                  << (sharding.workers > 0 ? std::to_string(sharding.workers) + " worker processes" : "one worker process per hardware thread")
+                  << std::endl;
+        auto shards = Sharding::run(units.size(), sharding, [&](std::size_t index, Scheduler::ThreadPool* pool) {
+            const Sharding::WorkUnit& unit = units[index];
+            auto sim = makeSim(unit.combo, unit.replication);
+            sim.setThreadPool(pool);
+            return Streaming::encode(sim.run(airdropFanOut, unit.firstUser, unit.numUsers));
+        });
+
+        // With several replications every one is stored, as "<combo> #<replication>"
+        ResultStore::Writer writer(resultsPath, compressResults);
+        std::size_t next = 0;
+        for (std::uint32_t combo = 0; combo < preTGEPolicies.size(); ++combo) {
+            std::vector<Replication::ComboAccumulator> accumulators(airdropPolicies.size());
+            Streaming::StreamingReport first;
+            for (std::uint32_t rep = 0; rep < replications; ++rep) {
+                Streaming::StreamingReport report = Streaming::decode(shards[next++]);
+                while (next < units.size() && units[next].combo == combo && units[next].replication == rep)
+                    Streaming::merge(report, Streaming::decode(shards[next++]));
+                makeSim(combo, rep).finish(report);
+                for (std::size_t p = 0; p < report.policies.size(); ++p) {
+                    std::string comboName = preTGEPolicies[combo].first + " + " + airdropPolicies[p].first;
+                    if (replications > 1)
+                        comboName += " #" + std::to_string(rep);
+                    writer.append(comboName, report.policies[p].result);
+                    accumulators[p].add(report.policies[p].result);
+                }
+                if (rep == 0)
+                    first = std::move(report);
+            }
+            std::cout << preTGEPolicies[combo].first << ": " << first.numUsers << " users x " << replications << " replications" << std::endl;
+            for (std::size_t p = 0; p < first.policies.size(); ++p) {
+                std::cout << "  " << airdropPolicies[p].first << (replications > 1 ? " replication 0" : "") << " tokens p50/p99: " << first.policies[p].tokens.quantile(0.5)
+                          << " / " << first.policies[p].tokens.quantile(0.99) << ", final price " << accumulators[p].prices().back().mean;
+                // The price does not vary between replications; the cohort shares do
+                if (replications > 1)
+                    std::cout << ", largest relative share CI " << accumulators[p].maxRelativeShareCI(replication.z);
+                std::cout << std::endl;
+            }
+        }
+        writer.close();
+        std::cout << "Results written to " << resultsPath << " (" << writer.bytesWritten() << " bytes)" << std::endl;
+        std::cout << "Simulation complete." << std::endl;
+        return 0;
+    }
+
+    // Everything that changes the results goes into the fingerprint, so a resume cannot mix configurations
+    std::unique_ptr<Checkpoint::Store> checkpoints;
+    if (!checkpointDir.empty()) {
+        std::string config = "seed=" + std::to_string(seed) + ";users=" + std::to_string(numUsers) +
+                             ";population=" + populationPath + ";steps=" + std::to_string(preTGESteps) +
+                             ";horizon=" + std::to_string(simulationHorizon) + ";vesting=" + vestingPath +
+                             ";replications=" + std::to_string(replication.maxReplications) +
+                             ";ci=" + std::to_string(replication.targetRelativeCI) +
+                             ";sybil=" + (sybilFilter ? std::to_string(sybilFilter->tokenMultiplier) : "off") +
+                             ";formula=" + preTGEFormula;
+        checkpoints = std::make_unique<Checkpoint::Store>(checkpointDir, Codec::hash(config), resume);
+        if (resume)
+            std::cout << "Resuming from " << checkpointDir << " (" << checkpoints->numCompleted() << " completed units)" << std::endl;
+    }
+
+    // Run simulations as tasks on a work-stealing pool; each combo also splits its user kernels into subtasks
+    Scheduler::ThreadPool threadPool(numThreads);
+    std::cout << "Worker threads: " << threadPool.size() << std::endl;
+
+    if (replication.maxReplications > 1) {
+        Replication::ReplicationDriver driver(replication, &threadPool);
+        driver.setCheckpoints(checkpoints.get());
+        std::vector<std::future<std::pair<std::string, Replication::ReplicationReport>>> reports;
+        std::uint32_t comboId = 0;
+        for (const auto& prePolicyPair : preTGEPolicies) {
+            for (const auto& adPolicyPair : airdropPolicies) {
+                std::string comboName = prePolicyPair.first + " + " + adPolicyPair.first;
+                std::uint32_t combo = comboId++;
+                reports.push_back(threadPool.submit([=, &driver, &threadPool]() {
+                    auto report = driver.run(seed, combo, [&](const RNG::StreamKey& rngKey) {
+                        MonteCarloSimulation sim(numUsers, totalSupply, preTGESteps, simulationHorizon, adPolicyPair.second, prePolicyPair.second, 0.15, rngKey);
+                        sim.setThreadPool(&threadPool);
+                        sim.setVestingSchedules(vestingSchedules);
+                        if (sybilFilter)
+                            sim.setSybilFilter(*sybilFilter);
+                        return sim.run();
+                    });
+                    return std::make_pair(comboName, std::move(report));
+                }));
+            }
+        }
+        // Replications are folded into their accumulators as they finish, so each combo is stored as its means
+        ResultStore::Writer writer(resultsPath, compressResults);
+        for (auto& fut : reports) {
+            auto [comboName, report] = fut.get();
+            const auto& acc = report.accumulator;
+            writer.append(comboName, acc.meanResult());
+            std::cout << comboName << ": " << acc.replications() << " replications"
+                      << (report.converged ? " (converged)" : "") << std::endl;
+            // TGE total and the price path are fixed by the cohort counts and the unlock schedule; only the
+            // cohort shares vary between replications
+            std::cout << "  TGE total: " << acc.tgeTotal().mean << std::endl;
+            if (!acc.prices().empty())
+                std::cout << "  Final price: " << acc.prices().back().mean << std::endl;
+            for (std::size_t c = 0; c < Users::kNumCohorts; ++c) {
+                const auto cohort = static_cast<Users::Cohort>(c);
+                const auto& moments = acc.distributionMoments(cohort);
+                const auto& sketch = acc.distributionSketch(cohort);
+                std::cout << "  " << Users::kCohortParams[c].name << " share " << moments.mean << " +/- "
+                          << moments.ciHalfWidth(replication.z) << ", p5/p50/p95: "
+                          << sketch.quantile(0.05) << " / " << sketch.quantile(0.5) << " / " << sketch.quantile(0.95) << std::endl;
+            }
+        }
+        writer.close();
+        if (checkpoints)
+            checkpoints->flush();
+        if (!tracePath.empty() && Trace::kCompiledIn)
+            Trace::writeChromeTrace(tracePath);
+        std::cout << "Results written to " << resultsPath << " (" << writer.bytesWritten() << " bytes)" << std::endl;
+        std::cout << "Simulation complete." << std::endl;
+        return 0;
+    }
+
+    if (streamUsers > 0) {
+        // Bounded memory: each PreTGE task holds one batch of users at a time, and the results carry no per-user tokens
+        ResultStore::Writer writer(resultsPath, compressResults);
+        std::vector<std::shared_ptr<AirdropPolicy>> airdropFanOut;
+        for (const auto& adPolicyPair : airdropPolicies)
+            airdropFanOut.push_back(adPolicyPair.second);
+        std::vector<std::future<std::pair<std::string, Streaming::StreamingReport>>> futures;
+        std::uint32_t comboId = 0;
+        for (const auto& prePolicyPair : preTGEPolicies) {
+            RNG::StreamKey rngKey{ seed, comboId++ };
+            futures.push_back(threadPool.submit([=, &threadPool, &writer, &airdropPolicies]() {
+                Streaming::StreamingSimulation sim(streamUsers, totalSupply, preTGESteps, simulationHorizon, prePolicyPair.second,
+                                                   0.15, rngKey, streaming);
+                sim.setThreadPool(&threadPool);
+                sim.setVestingSchedules(vestingSchedules);
+                auto report = sim.run(airdropFanOut);
+                for (std::size_t p = 0; p < report.policies.size(); ++p)
+                    writer.append(prePolicyPair.first + " + " + airdropPolicies[p].first, report.policies[p].result);
+                return std::make_pair(prePolicyPair.first, std::move(report));
             }));
         }
+        for (auto& fut : futures) {
+            auto [preName, report] = fut.get();
+            std::cout << preName << ": " << report.numUsers << " users in " << report.batches << " batches" << std::endl;
+            for (std::size_t p = 0; p < report.policies.size(); ++p) {
+                const auto& tokens = report.policies[p].tokens;
+                std::cout << "  " << airdropPolicies[p].first << " tokens p50/p99: " << tokens.quantile(0.5) << " / "
+                          << tokens.quantile(0.99) << std::endl;
+            }
+        }
+        writer.close();
+        if (!tracePath.empty() && Trace::kCompiledIn)
+            Trace::writeChromeTrace(tracePath);
+        std::cout << "Results written to " << resultsPath << " (" << writer.bytesWritten() << " bytes)" << std::endl;
+        std::cout << "Simulation complete." << std::endl;
+        return 0;
+    }
+
+    // One population shared read-only by every combo, so policies are compared on the same users
+    std::shared_ptr<const PopulationNS::Population> population;
+    if (!populationPath.empty() && std::filesystem::exists(populationPath)) {
+        population = PopulationNS::Population::open(populationPath);
+        // A snapshot stands in for generate(numUsers, seed), so it must have been generated from the same settings
+        if (population->rngKey().seed != seed || population->size() != static_cast<std::size_t>(numUsers)) {
+            std::cerr << "Population snapshot " << populationPath << " holds " << population->size() << " users from seed "
+                      << population->rngKey().seed << ", but this run uses " << numUsers << " users from seed " << seed
+                      << "; delete it or pass another --population path" << std::endl;
+            return 1;
+        }
+        std::cout << "Loaded population snapshot " << populationPath << " (" << population->size() << " users)" << std::endl;
+    } else {
+        population = PopulationNS::Population::generate(numUsers, RNG::StreamKey{ seed, 0 });
+        if (!populationPath.empty()) {
+            population->save(populationPath);
+            std::cout << "Saved population snapshot " << populationPath << std::endl;
+        }
+    }
+
+    // One task per PreTGE policy: PreTGE runs once and every airdrop policy is evaluated on the same points
+    // (paired comparisons). Results stream to disk as each task finishes, so memory does not grow with the grid.
+    ResultStore::Writer writer(resultsPath, compressResults);
+    std::vector<std::shared_ptr<AirdropPolicy>> airdropFanOut;
+    for (const auto& adPolicyPair : airdropPolicies)
+        airdropFanOut.push_back(adPolicyPair.second);
+    std::vector<std::future<std::pair<std::string, std::optional<Sybil::CaptureReport>>>> futures;
+    std::uint32_t comboId = 0;
+    for (const auto& prePolicyPair : preTGEPolicies) {
+        std::cout << "Submitting simulation for: " << prePolicyPair.first << " + all airdrop policies" << std::endl;
+        RNG::StreamKey rngKey{ seed, comboId++ };
+        futures.push_back(threadPool.submit([=, &threadPool, &writer, &airdropPolicies, &checkpoints]() {
+            // A combo finished by an earlier run is replayed from the manifest; an unfinished one restarts
+            // from its last PreTGE snapshot
+            const std::string unit = "fanout/" + prePolicyPair.first;
+            std::vector<SimulationResult> results;
+            std::optional<Sybil::CaptureReport> capture;
+            if (const auto* completed = checkpoints ? checkpoints->completed(unit) : nullptr) {
+                std::span<const std::byte> in(*completed);
+                while (!in.empty())
+                    results.push_back(decodeResult(in));
+            } else {
+                MonteCarloSimulation sim(population, totalSupply, preTGESteps, simulationHorizon, nullptr, prePolicyPair.second, 0.15, rngKey);
+                sim.setThreadPool(&threadPool);
+                sim.setVestingSchedules(vestingSchedules);
+                if (sybilFilter)
+                    sim.setSybilFilter(*sybilFilter);
+                if (checkpoints) {
+                    if (auto state = checkpoints->snapshot(unit))
+                        sim.restoreState(*state);
+                    sim.setCheckpointHook(checkpointSteps, [&checkpoints, unit](std::vector<std::byte> state) {
+                        checkpoints->saveSnapshot(unit, std::move(state));
+                    });
+                }
+                results = sim.runFanOut(airdropFanOut);
+                capture = sim.getSybilCapture();
+                if (checkpoints) {
+                    std::vector<std::byte> encoded;
+                    for (const auto& result : results)
+                        encodeResult(result, encoded);
+                    checkpoints->markCompleted(unit, std::move(encoded));
+                }
+            }
+            for (std::size_t p = 0; p < results.size(); ++p)
+                writer.append(prePolicyPair.first + " + " + airdropPolicies[p].first, results[p]);
+            return std::make_pair(prePolicyPair.first, capture);
+        }));
     }
 
-    // Collect results
-    std::unordered_map<std::string, SimulationResult> results;
     for (auto& fut : futures) {
-        auto [comboName, res] = fut.get();
-        results[comboName] = res;
-        std::cout << "Completed simulation for: " << comboName << std::endl;
+        auto [preName, capture] = fut.get();
+        std::cout << "Completed simulations for: " << preName << std::endl;
+        if (capture)
+            std::cout << "  Sybil filter: flagged " << capture->flaggedSybils << " of " << capture->sybils << " sybils ("
+                      << capture->activeSybils << " active) and " << capture->flaggedRegular << " regular wallets in "
+                      << capture->clusters << " clusters" << std::endl;
     }
+    writer.close();
+    if (checkpoints)
+        checkpoints->flush();
+    if (!tracePath.empty() && Trace::kCompiledIn) {
+        Trace::writeChromeTrace(tracePath);
+        std::cout << "Trace written to " << tracePath << std::endl;
+    }
+    std::cout << "Results written to " << resultsPath << " (" << writer.bytesWritten() << " bytes)" << std::endl;
 
     // For example, print one result:
+    ResultStore::Reader reader(resultsPath);
     std::string chosen = "dYdX Retro + Linear";
-    if (results.find(chosen) != results.end()) {
-        auto& res = results[chosen];
-        std::cout << "TGE Total Tokens for " << chosen << ": " << res.TGETotal << std::endl;
+    if (const auto* combo = reader.find(chosen)) {
+        std::cout << "TGE Total Tokens for " << chosen << ": " << combo->TGETotal << std::endl;
+        if (pricePaths > 0) {
+            auto supplyPrice = reader.column(chosen, "prices").decodeF64();
+            auto bands = PricePaths::simulatePricePaths(supplyPrice, pricePaths, {}, RNG::StreamKey{ seed, 0 }, &threadPool);
+            std::cout << "Price bands over " << bands.numPaths << " paths (p1/p5/p50/p95/p99):" << std::endl;
+            for (std::size_t t = 0; t < supplyPrice.size(); t += 12) {
+                std::cout << "  month " << t << ":";
+                for (const auto& band : bands.quantiles)
+                    std::cout << " " << band[t];
+                std::cout << std::endl;
+            }
+        }
     }
     std::cout << "Simulation complete." << std::endl;
     return 0;
@@ -0,0 +1,214 @@
+#include "population.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace PopulationNS {
+
+    namespace {
+        constexpr char kMagic[8] = { 'D', 'E', 'X', 'P', 'O', 'P', '0', '1' };
+        constexpr std::uint32_t kVersion = 1;
+        constexpr std::size_t kAlign = 64;
+
+        // Fixed-size snapshot header; columns follow at 64-byte aligned offsets (ids, wealth, rates, cohorts).
+        struct SnapshotHeader {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t reserved;
+            std::uint64_t numUsers;
+            std::uint64_t seed;
+            std::uint32_t combo;
+            std::uint32_t reserved2;
+            std::uint64_t offsets[4];
+        };
+
+        constexpr std::size_t alignUp(std::size_t n) { return (n + kAlign - 1) / kAlign * kAlign; }
+
+        struct Layout {
+            std::uint64_t offsets[4];
+            std::uint64_t fileSize;
+        };
+
+        Layout layoutFor(std::size_t n) {
+            Layout layout;
+            std::size_t pos = alignUp(sizeof(SnapshotHeader));
+            const std::size_t widths[4] = { sizeof(int), sizeof(double), sizeof(int), sizeof(Users::Cohort) };
+            for (int c = 0; c < 4; ++c) {
+                layout.offsets[c] = pos;
+                pos = alignUp(pos + n * widths[c]);
+            }
+            layout.fileSize = pos;
+            return layout;
+        }
+    }
+
+    Population::CohortBounds Population::cohortBounds(std::size_t numUsers) {
+        double sybilPercentage = 0.3;
+        std::size_t numSybil = static_cast<std::size_t>(numUsers * sybilPercentage);
+        std::size_t numRegular = numUsers - numSybil;
+
+        double smallPercentage = 0.6;
+        double mediumPercentage = 0.3;
+
+        std::size_t numSmall = static_cast<std::size_t>(numRegular * smallPercentage);
+        std::size_t numMedium = static_cast<std::size_t>(numRegular * mediumPercentage);
+        std::size_t numLarge = numRegular - numSmall - numMedium;
+        // User ids are assigned in cohort blocks: small, medium, large, sybil
+        return { numSmall, numSmall + numMedium, numSmall + numMedium + numLarge };
+    }
+
+    void Population::fillAttributes(std::size_t numUsers) {
+        const CohortBounds bounds = cohortBounds(numUsers);
+        const std::size_t n = ownedIds_.size();
+        ownedWealth_.resize(n);
+        ownedRates_.resize(n);
+        ownedCohorts_.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            int id = ownedIds_[i];
+            Users::Cohort cohort = cohortOf(static_cast<std::size_t>(id), bounds);
+            const Users::CohortParams& params = Users::cohortParams(cohort);
+            ownedCohorts_[i] = cohort;
+            ownedWealth_[i] = RNG::Stream(rngKey_, static_cast<std::uint32_t>(id), 0, RNG::Domain::Population)
+                                  .lognormal(params.wealthMu, params.wealthSigma);
+            ownedRates_[i] = RNG::Stream(rngKey_, static_cast<std::uint32_t>(id), 0, RNG::Domain::UserInit)
+                                 .poisson(params.interactionMean);
+        }
+        userIds_ = ownedIds_;
+        wealth_ = ownedWealth_;
+        interactionRate_ = ownedRates_;
+        cohort_ = ownedCohorts_;
+    }
+
+    std::shared_ptr<const Population> Population::generate(int numUsers, const RNG::StreamKey& rngKey) {
+        DEX_TRACE_SCOPE("population.generate");
+        DEX_TRACE_ADD(AllocatedBytes, numUsers * (2 * sizeof(int) + sizeof(double) + sizeof(Users::Cohort)));
+        std::shared_ptr<Population> pop(new Population());
+        pop->rngKey_ = rngKey;
+
+        std::vector<int> order(numUsers);
+        for (int id = 0; id < numUsers; ++id)
+            order[id] = id;
+        // Fisher-Yates driven by a single counter-based stream so the order is reproducible from the seed
+        RNG::Stream shuffle(rngKey, 0, 0, RNG::Domain::Shuffle);
+        for (std::size_t i = order.size(); i > 1; --i) {
+            std::size_t j = shuffle.below(static_cast<std::uint32_t>(i));
+            std::swap(order[i - 1], order[j]);
+        }
+        pop->ownedIds_ = std::move(order);
+        pop->fillAttributes(static_cast<std::size_t>(numUsers));
+        return pop;
+    }
+
+    std::shared_ptr<const Population> Population::generateRange(std::size_t numUsers, const RNG::StreamKey& rngKey,
+                                                                 std::size_t first, std::size_t count) {
+        DEX_TRACE_SCOPE("population.generateRange");
+        if (numUsers > static_cast<std::size_t>(std::numeric_limits<int>::max()) || first + count > numUsers)
+            throw std::runtime_error("Population: user range out of bounds");
+        DEX_TRACE_ADD(AllocatedBytes, count * (2 * sizeof(int) + sizeof(double) + sizeof(Users::Cohort)));
+        std::shared_ptr<Population> pop(new Population());
+        pop->rngKey_ = rngKey;
+        pop->ownedIds_.resize(count);
+        for (std::size_t i = 0; i < count; ++i)
+            pop->ownedIds_[i] = static_cast<int>(first + i);
+        pop->fillAttributes(numUsers);
+        return pop;
+    }
+
+    void Population::save(const std::string& path) const {
+        std::size_t n = size();
+        Layout layout = layoutFor(n);
+        SnapshotHeader header{};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.numUsers = n;
+        header.seed = rngKey_.seed;
+        header.combo = rngKey_.combo;
+        std::copy(std::begin(layout.offsets), std::end(layout.offsets), header.offsets);
+
+        // Write to a temporary name and rename, so readers never map a half-written snapshot
+        std::string tmpPath = path + ".tmp";
+        std::FILE* file = std::fopen(tmpPath.c_str(), "wb");
+        if (!file)
+            throw std::runtime_error("Population: cannot open " + tmpPath + " for writing");
+        std::vector<char> image(layout.fileSize, 0);
+        std::memcpy(image.data(), &header, sizeof(header));
+        std::memcpy(image.data() + layout.offsets[0], userIds_.data(), userIds_.size_bytes());
+        std::memcpy(image.data() + layout.offsets[1], wealth_.data(), wealth_.size_bytes());
+        std::memcpy(image.data() + layout.offsets[2], interactionRate_.data(), interactionRate_.size_bytes());
+        std::memcpy(image.data() + layout.offsets[3], cohort_.data(), cohort_.size_bytes());
+        bool ok = std::fwrite(image.data(), 1, image.size(), file) == image.size();
+        ok = std::fclose(file) == 0 && ok;
+        if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+            std::remove(tmpPath.c_str());
+            throw std::runtime_error("Population: failed to write " + path);
+        }
+    }
+
+    std::shared_ptr<const Population> Population::open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Population: cannot open " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+            ::close(fd);
+            throw std::runtime_error("Population: " + path + " is not a population snapshot");
+        }
+        std::size_t fileSize = static_cast<std::size_t>(st.st_size);
+        void* mapped = ::mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+            throw std::runtime_error("Population: cannot map " + path);
+
+        std::shared_ptr<Population> pop(new Population());
+        pop->mapping_ = mapped;
+        pop->mappingSize_ = fileSize;
+
+        SnapshotHeader header;
+        std::memcpy(&header, mapped, sizeof(header));
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion)
+            throw std::runtime_error("Population: " + path + " is not a population snapshot");
+        std::size_t n = header.numUsers;
+        Layout layout = layoutFor(n);
+        if (fileSize != layout.fileSize || !std::equal(std::begin(layout.offsets), std::end(layout.offsets), header.offsets))
+            throw std::runtime_error("Population: corrupt snapshot " + path);
+
+        const char* base = static_cast<const char*>(mapped);
+        // Cohorts index the per-cohort parameter and total arrays, so a bad byte must not reach them
+        const auto* cohorts = reinterpret_cast<const std::uint8_t*>(base + layout.offsets[3]);
+        if (std::any_of(cohorts, cohorts + n, [](std::uint8_t c) { return c >= Users::kNumCohorts; }))
+            throw std::runtime_error("Population: invalid cohort in snapshot " + path);
+        // Ids index per-user streams and column slots, and the cohort is a function of the id
+        const auto* ids = reinterpret_cast<const int*>(base + layout.offsets[0]);
+        const CohortBounds bounds = cohortBounds(n);
+        std::vector<bool> seen(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (ids[i] < 0 || static_cast<std::size_t>(ids[i]) >= n || seen[ids[i]])
+                throw std::runtime_error("Population: invalid or duplicate user id " + std::to_string(ids[i]) + " in snapshot " + path);
+            seen[ids[i]] = true;
+            if (static_cast<Users::Cohort>(cohorts[i]) != cohortOf(static_cast<std::size_t>(ids[i]), bounds))
+                throw std::runtime_error("Population: cohort of user " + std::to_string(ids[i]) + " does not match its id in snapshot " + path);
+        }
+        pop->rngKey_ = RNG::StreamKey{ header.seed, header.combo };
+        pop->userIds_ = { reinterpret_cast<const int*>(base + layout.offsets[0]), n };
+        pop->wealth_ = { reinterpret_cast<const double*>(base + layout.offsets[1]), n };
+        pop->interactionRate_ = { reinterpret_cast<const int*>(base + layout.offsets[2]), n };
+        pop->cohort_ = { reinterpret_cast<const Users::Cohort*>(base + layout.offsets[3]), n };
+        return pop;
+    }
+
+    Population::~Population() {
+        if (mapping_)
+            ::munmap(mapping_, mappingSize_);
+    }
+
+} // namespace PopulationNS
@@ -0,0 +1,74 @@
+#ifndef POPULATION_HPP
+#define POPULATION_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include "rng.hpp"
+#include "users.hpp"
+
+namespace PopulationNS {
+
+    // The immutable part of a user pool: ids, wealth, interaction rates and cohorts, one column each.
+    // A population is generated once and shared read-only by any number of simulations; a snapshot
+    // file maps it back without regenerating, so separate processes see the same users too.
+    class Population {
+    public:
+        static std::shared_ptr<const Population> generate(int numUsers, const RNG::StreamKey& rngKey = {});
+        // Users [first, first + count) of a numUsers population, in id order rather than shuffled. Each user's
+        // attributes match generate(numUsers, rngKey), so a population can be produced batch by batch.
+        static std::shared_ptr<const Population> generateRange(std::size_t numUsers, const RNG::StreamKey& rngKey,
+                                                                std::size_t first, std::size_t count);
+        // Maps a snapshot written by save(); throws std::runtime_error if the file is missing or malformed:
+        // ids must be a permutation of [0, numUsers) and each cohort byte the one generate() derives from its id.
+        static std::shared_ptr<const Population> open(const std::string& path);
+        void save(const std::string& path) const;
+
+        ~Population();
+        Population(const Population&) = delete;
+        Population& operator=(const Population&) = delete;
+
+        std::size_t size() const { return userIds_.size(); }
+        const RNG::StreamKey& rngKey() const { return rngKey_; }
+        bool isMapped() const { return mapping_ != nullptr; }
+
+        std::span<const int> userIds() const { return userIds_; }
+        std::span<const double> wealth() const { return wealth_; }
+        std::span<const int> interactionRate() const { return interactionRate_; }
+        std::span<const Users::Cohort> cohort() const { return cohort_; }
+    private:
+        Population() = default;
+        // Exclusive id bounds of the small, medium and large cohort blocks; sybils fill the rest.
+        using CohortBounds = std::array<std::size_t, 3>;
+        static CohortBounds cohortBounds(std::size_t numUsers);
+        static Users::Cohort cohortOf(std::size_t id, const CohortBounds& bounds) {
+            return id < bounds[0] ? Users::Cohort::Small
+                 : id < bounds[1] ? Users::Cohort::Medium
+                 : id < bounds[2] ? Users::Cohort::Large
+                 : Users::Cohort::Sybil;
+        }
+        // Derives wealth, rates and cohorts for ownedIds_ and points the column views at them.
+        void fillAttributes(std::size_t numUsers);
+
+        RNG::StreamKey rngKey_;
+        // Generated populations own their columns; mapped ones point into the snapshot file.
+        std::vector<int> ownedIds_;
+        std::vector<double> ownedWealth_;
+        std::vector<int> ownedRates_;
+        std::vector<Users::Cohort> ownedCohorts_;
+        void* mapping_ = nullptr;
+        std::size_t mappingSize_ = 0;
+
+        std::span<const int> userIds_;
+        std::span<const double> wealth_;
+        std::span<const int> interactionRate_;
+        std::span<const Users::Cohort> cohort_;
+    };
+
+} // namespace PopulationNS
+
+#endif // POPULATION_HPP
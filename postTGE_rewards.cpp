@@ -38,27 +38,22 @@ namespace PostTGE {
         return allocation_ * fraction;
     }
 
-    PostTGERewardsManager::PostTGERewardsManager(double totalSupply)
-        : totalSupply_(totalSupply) {
-        initializeSchedules();
+    PostTGERewardsManager::PostTGERewardsManager(double totalSupply, const std::vector<ScheduleSpec>& specs)
+        : totalSupply_(totalSupply), engine_(totalSupply, specs) {
+        initializeSchedules(specs);
     }
 
-    void PostTGERewardsManager::initializeSchedules() {
-        schedules_["Team"] = std::make_shared<VestingSchedule>(totalSupply_ * 0.20, 0.20, 12, 0.20, 36);
-        schedules_["TGE Airdrop"] = std::make_shared<VestingSchedule>(totalSupply_ * 0.15, 1.0, 0, 0.0, 0);
-        schedules_["Future Investors"] = std::make_shared<VestingSchedule>(totalSupply_ * 0.17, 0.0, 0, 0.0, 48);
-        schedules_["Strategic Reserve/Treasury"] = std::make_shared<VestingSchedule>(totalSupply_ * 0.20, 0.0, 0, 0.0, 48);
-        schedules_["Investors"] = std::make_shared<VestingSchedule>(totalSupply_ * 0.08, 0.20, 0, 0.20, 36, 1);
-        schedules_["Rewards"] = std::make_shared<VestingSchedule>(totalSupply_ * 0.05, 1.0, 0, 0.0, 0);
-        schedules_["Promotion"] = std::make_shared<VestingSchedule>(totalSupply_ * 0.03, 0.20, 0, 0.20, 24, 1);
-        schedules_["Advisors"] = std::make_shared<VestingSchedule>(totalSupply_ * 0.02, 0.20, 12, 0.20, 36);
+    void PostTGERewardsManager::initializeSchedules(const std::vector<ScheduleSpec>& specs) {
+        for (const auto& spec : specs)
+            schedules_[spec.name] = std::make_shared<VestingSchedule>(totalSupply_ * spec.allocationFraction, spec.unlockAtTGE,
+                                                                      spec.lockupDuration, spec.initialCliffUnlock,
+                                                                      spec.unlockDuration, spec.initialCliffDelay);
     }
 
     std::unordered_map<std::string, double> PostTGERewardsManager::getUnlockedAllocations(int monthsElapsed) const {
         std::unordered_map<std::string, double> unlocked;
-        for (const auto& [group, schedule] : schedules_) {
-            unlocked[group] = schedule->getUnlockedTokens(monthsElapsed);
-        }
+        for (std::size_t g = 0; g < engine_.numGroups(); ++g)
+            unlocked[engine_.groupName(g)] = engine_.unlocked(g, monthsElapsed);
         return unlocked;
     }
 
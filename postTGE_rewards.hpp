@@ -5,6 +5,7 @@
 #include <unordered_map>
 #include <vector>
 #include <memory>
+#include "vesting.hpp"
 
 namespace PostTGE {
 
@@ -26,13 +27,16 @@ namespace PostTGE {
 
     class PostTGERewardsManager {
     public:
-        explicit PostTGERewardsManager(double totalSupply);
+        explicit PostTGERewardsManager(double totalSupply, const std::vector<ScheduleSpec>& specs = defaultSchedules());
         std::unordered_map<std::string, double> getUnlockedAllocations(int monthsElapsed) const;
         const std::unordered_map<std::string, std::shared_ptr<VestingSchedule>>& getSchedules() const { return schedules_; }
+        // Compiled form of the same schedules; use this for horizons and sub-monthly time steps.
+        const VestingEngine& getEngine() const { return engine_; }
     private:
         double totalSupply_;
         std::unordered_map<std::string, std::shared_ptr<VestingSchedule>> schedules_;
-        void initializeSchedules();
+        VestingEngine engine_;
+        void initializeSchedules(const std::vector<ScheduleSpec>& specs);
         alignas(64) char padding[64];
     };
 
@@ -6,22 +6,41 @@
 namespace PreTGE {
 
     using Tier = std::pair<double, double>;
+    using Activity::Feature;
 
-    DydxRetroTieredRewardPolicy::DydxRetroTieredRewardPolicy(const std::vector<Tier>& tiers) {
-        if (tiers.empty()) {
-            tiers_ = { {1000, 310}, {10000, 1163}, {100000, 2500}, {1000000, 6414}, {std::numeric_limits<double>::infinity(), 9530} };
-        } else {
-            tiers_ = tiers;
+    void PreTGERewardsPolicy::calculatePoints(const Activity::ActivityView& activity, std::span<const int> users, std::span<double> points,
+                                              const RNG::StreamKey& /*rngKey*/, std::uint32_t /*step*/) const {
+        for (std::size_t i = 0; i < activity.size(); ++i)
+            points[i] = calculatePoints(activity.row(i), users[i]);
+    }
+
+    namespace {
+        std::vector<double> thresholdsOf(const std::vector<Tier>& tiers) {
+            std::vector<double> thresholds;
+            for (const auto& [threshold, points] : tiers)
+                thresholds.push_back(threshold);
+            return thresholds;
         }
     }
 
+    DydxRetroTieredRewardPolicy::DydxRetroTieredRewardPolicy(const std::vector<Tier>& tiers) {
+        std::vector<Tier> compiled = tiers;
+        if (compiled.empty())
+            compiled = { {1000, 310}, {10000, 1163}, {100000, 2500}, {1000000, 6414}, {std::numeric_limits<double>::infinity(), 9530} };
+        table_ = Tiers::TierTable(thresholdsOf(compiled), Tiers::Bound::Below);
+        for (const auto& [threshold, points] : compiled)
+            rewards_.push_back(points);
+        rewards_.push_back(compiled.back().second);
+    }
+
     double DydxRetroTieredRewardPolicy::calculatePoints(const std::unordered_map<std::string, double>& activityStats, int /*user*/) const {
         double volume = activityStats.count("trading_volume") ? activityStats.at("trading_volume") : 0;
-        for (const auto& [threshold, points] : tiers_) {
-            if (volume < threshold)
-                return points;
-        }
-        return tiers_.back().second;
+        return rewards_[table_.find(volume)];
+    }
+
+    void DydxRetroTieredRewardPolicy::calculatePoints(const Activity::ActivityView& activity, std::span<const int> /*users*/, std::span<double> points,
+                                                      const RNG::StreamKey& /*rngKey*/, std::uint32_t /*step*/) const {
+        table_.forEachTier(activity.get<Feature::TradingVolume>(), [&](std::size_t i, std::uint32_t k) { points[i] = rewards_[k]; });
     }
 
     VertexMakerTakerRewardPolicy::VertexMakerTakerRewardPolicy(double makerWeight, double takerWeight, double qscoreWeight, double referralRate)
@@ -36,54 +55,89 @@ namespace PreTGE {
         return basePoints + referral * referralRate_;
     }
 
-    JupiterVolumeTierRewardPolicy::JupiterVolumeTierRewardPolicy(const std::vector<Tier>& tiers) {
-        if (tiers.empty()) {
-            tiers_ = { {1000, 50}, {29000, 250}, {500000, 3000}, {3000000, 10000}, {14000000, 20000} };
-        } else {
-            tiers_ = tiers;
+    void VertexMakerTakerRewardPolicy::calculatePoints(const Activity::ActivityView& activity, std::span<const int> /*users*/, std::span<double> points,
+                                                       const RNG::StreamKey& /*rngKey*/, std::uint32_t /*step*/) const {
+        auto maker = activity.get<Feature::MakerVolume>();
+        auto taker = activity.get<Feature::TakerVolume>();
+        auto qscore = activity.get<Feature::QScore>();
+        auto referral = activity.get<Feature::ReferralPoints>();
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            double basePoints = maker[i] * makerWeight_ + taker[i] * takerWeight_ + qscore[i] * qscoreWeight_;
+            points[i] = basePoints + referral[i] * referralRate_;
         }
     }
 
+    JupiterVolumeTierRewardPolicy::JupiterVolumeTierRewardPolicy(const std::vector<Tier>& tiers) {
+        std::vector<Tier> compiled = tiers;
+        if (compiled.empty())
+            compiled = { {1000, 50}, {29000, 250}, {500000, 3000}, {3000000, 10000}, {14000000, 20000} };
+        table_ = Tiers::TierTable(thresholdsOf(compiled), Tiers::Bound::Unreached);
+        rewards_.push_back(0);
+        for (const auto& [threshold, points] : compiled)
+            rewards_.push_back(points);
+    }
+
     double JupiterVolumeTierRewardPolicy::calculatePoints(const std::unordered_map<std::string, double>& activityStats, int /*user*/) const {
         double volume = activityStats.count("swap_volume") ? activityStats.at("swap_volume") : 0;
-        double reward = 0;
-        for (const auto& [threshold, points] : tiers_) {
-            if (volume >= threshold)
-                reward = points;
-            else
-                break;
-        }
-        return reward;
+        return rewards_[table_.find(volume)];
     }
 
-    AevoBoostedVolumeRewardPolicy::AevoBoostedVolumeRewardPolicy(double baseMax, const std::unordered_map<int, double>& luckyProbs)
-        : baseMax_(baseMax), rng_(std::random_device{}()) {
-        if (luckyProbs.empty()) {
-            luckyProbs_ = { {10, 0.10}, {50, 0.025}, {100, 0.01} };
-        } else {
-            luckyProbs_ = luckyProbs;
+    void JupiterVolumeTierRewardPolicy::calculatePoints(const Activity::ActivityView& activity, std::span<const int> /*users*/, std::span<double> points,
+                                                        const RNG::StreamKey& /*rngKey*/, std::uint32_t /*step*/) const {
+        table_.forEachTier(activity.get<Feature::SwapVolume>(), [&](std::size_t i, std::uint32_t k) { points[i] = rewards_[k]; });
+    }
+
+    AevoBoostedVolumeRewardPolicy::AevoBoostedVolumeRewardPolicy(double baseMax, const std::unordered_map<int, double>& luckyProbs,
+                                                                 std::uint64_t seed)
+        : baseMax_(baseMax), seed_(seed) {
+        std::vector<std::pair<int, double>> outcomes(luckyProbs.begin(), luckyProbs.end());
+        if (luckyProbs.empty())
+            outcomes = { {10, 0.10}, {50, 0.025}, {100, 0.01} };
+        // Fixed outcome order, so the table (and every draw) does not depend on the map's iteration order
+        std::sort(outcomes.begin(), outcomes.end());
+        double lucky = 0.0;
+        for (const auto& [multiplier, prob] : outcomes)
+            lucky += std::max(prob, 0.0);
+        outcomes.insert(outcomes.begin(), { 1, std::max(1.0 - lucky, 0.0) });
+        std::vector<double> weights;
+        for (const auto& [multiplier, prob] : outcomes) {
+            multipliers_.push_back(multiplier);
+            weights.push_back(prob);
         }
+        luckyTable_ = RNG::AliasTable(weights);
+    }
+
+    double AevoBoostedVolumeRewardPolicy::boostedVolume(double tradeVolume, double trailingVolume, int luckyMultiplier) const {
+        constexpr double threshold = 5000000;
+        double baseMultiplier = 1 + (baseMax_ - 1) * std::min(trailingVolume / threshold, 1.0);
+        return tradeVolume * (baseMultiplier + luckyMultiplier - 1);
     }
 
-    double AevoBoostedVolumeRewardPolicy::calculatePoints(const std::unordered_map<std::string, double>& activityStats, int /*user*/) const {
+    double AevoBoostedVolumeRewardPolicy::calculatePoints(const std::unordered_map<std::string, double>& activityStats, int user) const {
+        RNG::Stream rng = userStream(user);
+        return calculatePoints(activityStats, rng);
+    }
+
+    double AevoBoostedVolumeRewardPolicy::calculatePoints(const std::unordered_map<std::string, double>& activityStats, RNG::Stream& rng) const {
         double tradeVolume = activityStats.count("trade_volume") ? activityStats.at("trade_volume") : 0;
         double trailingVolume = activityStats.count("trailing_volume") ? activityStats.at("trailing_volume") : 0;
-        double threshold = 5000000;
-        double baseMultiplier = 1 + (baseMax_ - 1) * std::min(trailingVolume / threshold, 1.0);
-        std::uniform_real_distribution<double> dist(0.0, 1.0);
-        double rnd = dist(rng_);
-        double cumulative = 0.0;
-        int luckyMultiplier = 1;
-        std::vector<std::pair<int, double>> sortedProbs(luckyProbs_.begin(), luckyProbs_.end());
-        std::sort(sortedProbs.begin(), sortedProbs.end(), [](auto a, auto b){ return a.second < b.second; });
-        for (const auto& [multiplier, prob] : sortedProbs) {
-            cumulative += prob;
-            if (rnd < cumulative) {
-                luckyMultiplier = multiplier;
-                break;
-            }
+        return boostedVolume(tradeVolume, trailingVolume, luckyMultiplier(rng));
+    }
+
+    void AevoBoostedVolumeRewardPolicy::calculatePoints(const Activity::ActivityView& activity, std::span<const int> users, std::span<double> points,
+                                                        const RNG::StreamKey& rngKey, std::uint32_t step) const {
+        auto tradeVolume = activity.get<Feature::TradeVolume>();
+        auto trailingVolume = activity.get<Feature::TrailingVolume>();
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            RNG::Stream rng = userStream(rngKey, users[i], step);
+            points[i] = boostedVolume(tradeVolume[i], trailingVolume[i], luckyMultiplier(rng));
         }
-        return tradeVolume * (baseMultiplier + luckyMultiplier - 1);
+    }
+
+    void AevoBoostedVolumeRewardPolicy::calculatePoints(std::span<const double> tradeVolume, std::span<const double> trailingVolume,
+                                                        RNG::Stream& rng, std::span<double> points) const {
+        for (std::size_t i = 0; i < points.size(); ++i)
+            points[i] = boostedVolume(tradeVolume[i], trailingVolume[i], luckyMultiplier(rng));
     }
 
     HelixLoyaltyPointsRewardPolicy::HelixLoyaltyPointsRewardPolicy(double volumeWeight, double diversityBonus, double loyaltyBonus)
@@ -96,6 +150,15 @@ namespace PreTGE {
         return volumeWeight_ * volume + diversityBonus_ * uniqueMarkets + loyaltyBonus_ * activeDays * volume;
     }
 
+    void HelixLoyaltyPointsRewardPolicy::calculatePoints(const Activity::ActivityView& activity, std::span<const int> /*users*/, std::span<double> points,
+                                                         const RNG::StreamKey& /*rngKey*/, std::uint32_t /*step*/) const {
+        auto volume = activity.get<Feature::TradingVolume>();
+        auto activeDays = activity.get<Feature::ActiveDays>();
+        auto uniqueMarkets = activity.get<Feature::UniqueMarkets>();
+        for (std::size_t i = 0; i < points.size(); ++i)
+            points[i] = volumeWeight_ * volume[i] + diversityBonus_ * uniqueMarkets[i] + loyaltyBonus_ * activeDays[i] * volume[i];
+    }
+
     GameLikeMMRRewardPolicy::GameLikeMMRRewardPolicy(double basePoints, double winRateWeight, double consistencyBonus)
         : basePoints_(basePoints), winRateWeight_(winRateWeight), consistencyBonus_(consistencyBonus) {}
 
@@ -108,11 +171,34 @@ namespace PreTGE {
         return basePoints_ + winRateWeight_ * winRate + consistencyBonus_ * consecutiveDays;
     }
 
+    void GameLikeMMRRewardPolicy::calculatePoints(const Activity::ActivityView& activity, std::span<const int> /*users*/, std::span<double> points,
+                                                  const RNG::StreamKey& /*rngKey*/, std::uint32_t /*step*/) const {
+        auto wins = activity.get<Feature::Wins>();
+        auto losses = activity.get<Feature::Losses>();
+        auto consecutiveDays = activity.get<Feature::ConsecutiveDays>();
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            double totalGames = wins[i] + losses[i];
+            double winRate = totalGames > 0 ? wins[i] / totalGames : 0;
+            points[i] = basePoints_ + winRateWeight_ * winRate + consistencyBonus_ * consecutiveDays[i];
+        }
+    }
+
     CustomPreTGERewardPolicy::CustomPreTGERewardPolicy(std::function<double(const std::unordered_map<std::string, double>&, int)> customFunction)
         : customFunction_(customFunction) {}
 
+    CustomPreTGERewardPolicy::CustomPreTGERewardPolicy(const std::string& formula)
+        : program_(std::make_shared<const Formula::Program>(formula)) {}
+
     double CustomPreTGERewardPolicy::calculatePoints(const std::unordered_map<std::string, double>& activityStats, int user) const {
-        return customFunction_(activityStats, user);
+        return program_ ? program_->evaluate(activityStats) : customFunction_(activityStats, user);
+    }
+
+    void CustomPreTGERewardPolicy::calculatePoints(const Activity::ActivityView& activity, std::span<const int> users, std::span<double> points,
+                                                   const RNG::StreamKey& rngKey, std::uint32_t step) const {
+        if (program_)
+            program_->evaluate(activity, points);
+        else
+            PreTGERewardsPolicy::calculatePoints(activity, users, points, rngKey, step);
     }
 
 } // namespace PreTGE
@@ -4,10 +4,16 @@
 #include <vector>
 #include <limits>
 #include <cmath>
-#include <random>
 #include <functional>
+#include <memory>
 #include <unordered_map>
 #include <string>
+#include <cstdint>
+#include <span>
+#include "rng.hpp"
+#include "activity.hpp"
+#include "tier_table.hpp"
+#include "formula.hpp"
 
 namespace PreTGE {
 
@@ -16,6 +22,12 @@ namespace PreTGE {
     public:
         virtual ~PreTGERewardsPolicy() = default;
         virtual double calculatePoints(const std::unordered_map<std::string, double>& activityStats, int /*user*/) const = 0;
+        // Batch scoring over typed activity columns. A policy with random components draws user u's share from
+        // RNG::Stream(rngKey, u, step, Domain::Policy), so its points follow the simulation's key. The default
+        // rebuilds the string map per user and forwards to the overload above; the built-in policies override it
+        // with column arithmetic.
+        virtual void calculatePoints(const Activity::ActivityView& activity, std::span<const int> users, std::span<double> points,
+                                     const RNG::StreamKey& rngKey, std::uint32_t step) const;
     protected:
         alignas(64) char padding[64];
     };
@@ -26,8 +38,11 @@ namespace PreTGE {
         using Tier = std::pair<double, double>;
         explicit DydxRetroTieredRewardPolicy(const std::vector<Tier>& tiers = {});
         double calculatePoints(const std::unordered_map<std::string, double>& activityStats, int /*user*/) const override;
+        void calculatePoints(const Activity::ActivityView& activity, std::span<const int> users, std::span<double> points,
+                             const RNG::StreamKey& rngKey, std::uint32_t step) const override;
     private:
-        std::vector<Tier> tiers_;
+        Tiers::TierTable table_; // volume < threshold
+        std::vector<double> rewards_; // one per tier, then the last tier's reward for volumes past every tier
         alignas(64) char padding[64];
     };
 
@@ -36,6 +51,8 @@ namespace PreTGE {
     public:
         VertexMakerTakerRewardPolicy(double makerWeight = 0.375, double takerWeight = 0.375, double qscoreWeight = 0.25, double referralRate = 0.25);
         double calculatePoints(const std::unordered_map<std::string, double>& activityStats, int /*user*/) const override;
+        void calculatePoints(const Activity::ActivityView& activity, std::span<const int> users, std::span<double> points,
+                             const RNG::StreamKey& rngKey, std::uint32_t step) const override;
     private:
         double makerWeight_;
         double takerWeight_;
@@ -50,20 +67,44 @@ namespace PreTGE {
         using Tier = std::pair<double, double>;
         explicit JupiterVolumeTierRewardPolicy(const std::vector<Tier>& tiers = {});
         double calculatePoints(const std::unordered_map<std::string, double>& activityStats, int /*user*/) const override;
+        void calculatePoints(const Activity::ActivityView& activity, std::span<const int> users, std::span<double> points,
+                             const RNG::StreamKey& rngKey, std::uint32_t step) const override;
     private:
-        std::vector<Tier> tiers_;
+        // The reward is that of the last tier in the leading run of thresholds the volume reaches, so the
+        // first threshold it does not reach indexes rewards_, which starts with 0.
+        Tiers::TierTable table_;
+        std::vector<double> rewards_;
         alignas(64) char padding[64];
     };
 
     // Aevo Boosted Volume Reward Policy
     class AevoBoostedVolumeRewardPolicy : public PreTGERewardsPolicy {
     public:
-        explicit AevoBoostedVolumeRewardPolicy(double baseMax = 4.0, const std::unordered_map<int, double>& luckyProbs = {});
+        // luckyProbs maps a lucky multiplier to its probability; the rest of the mass goes to 1 (no luck),
+        // and probabilities summing past 1 are scaled down to fit.
+        explicit AevoBoostedVolumeRewardPolicy(double baseMax = 4.0, const std::unordered_map<int, double>& luckyProbs = {},
+                                               std::uint64_t seed = RNG::kDefaultSeed);
+        // The lucky draw comes from the user's own stream, so results do not depend on evaluation order. Without
+        // a simulation key (this overload) the stream is keyed by `seed`.
         double calculatePoints(const std::unordered_map<std::string, double>& activityStats, int /*user*/) const override;
+        void calculatePoints(const Activity::ActivityView& activity, std::span<const int> users, std::span<double> points,
+                             const RNG::StreamKey& rngKey, std::uint32_t step) const override;
+        // Same rule with the lucky draws taken from a caller-supplied stream (e.g. one per thread), in order.
+        double calculatePoints(const std::unordered_map<std::string, double>& activityStats, RNG::Stream& rng) const;
+        void calculatePoints(std::span<const double> tradeVolume, std::span<const double> trailingVolume, RNG::Stream& rng,
+                             std::span<double> points) const;
+        // O(1) draw from the alias table built at construction.
+        int luckyMultiplier(RNG::Stream& rng) const { return multipliers_[luckyTable_.sample(rng)]; }
     private:
         double baseMax_;
-        std::unordered_map<int, double> luckyProbs_;
-        mutable std::mt19937 rng_;
+        std::uint64_t seed_;
+        std::vector<int> multipliers_;
+        RNG::AliasTable luckyTable_;
+        double boostedVolume(double tradeVolume, double trailingVolume, int luckyMultiplier) const;
+        RNG::Stream userStream(int user) const { return userStream({ seed_, 0 }, user, 0); }
+        static RNG::Stream userStream(const RNG::StreamKey& rngKey, int user, std::uint32_t step) {
+            return RNG::Stream(rngKey, static_cast<std::uint32_t>(user), step, RNG::Domain::Policy);
+        }
         alignas(64) char padding[64];
     };
 
@@ -72,6 +113,8 @@ namespace PreTGE {
     public:
         HelixLoyaltyPointsRewardPolicy(double volumeWeight = 1.0, double diversityBonus = 100, double loyaltyBonus = 0.1);
         double calculatePoints(const std::unordered_map<std::string, double>& activityStats, int /*user*/) const override;
+        void calculatePoints(const Activity::ActivityView& activity, std::span<const int> users, std::span<double> points,
+                             const RNG::StreamKey& rngKey, std::uint32_t step) const override;
     private:
         double volumeWeight_;
         double diversityBonus_;
@@ -84,6 +127,8 @@ namespace PreTGE {
     public:
         GameLikeMMRRewardPolicy(double basePoints = 1000, double winRateWeight = 500, double consistencyBonus = 300);
         double calculatePoints(const std::unordered_map<std::string, double>& activityStats, int /*user*/) const override;
+        void calculatePoints(const Activity::ActivityView& activity, std::span<const int> users, std::span<double> points,
+                             const RNG::StreamKey& rngKey, std::uint32_t step) const override;
     private:
         double basePoints_;
         double winRateWeight_;
@@ -95,9 +140,14 @@ namespace PreTGE {
     class CustomPreTGERewardPolicy : public PreTGERewardsPolicy {
     public:
         explicit CustomPreTGERewardPolicy(std::function<double(const std::unordered_map<std::string, double>&, int)> customFunction);
+        // Points from a Formula expression over the activity features, e.g. read from a config file
+        explicit CustomPreTGERewardPolicy(const std::string& formula);
         double calculatePoints(const std::unordered_map<std::string, double>& activityStats, int user) const override;
+        void calculatePoints(const Activity::ActivityView& activity, std::span<const int> users, std::span<double> points,
+                             const RNG::StreamKey& rngKey, std::uint32_t step) const override;
     private:
         std::function<double(const std::unordered_map<std::string, double>&, int)> customFunction_;
+        std::shared_ptr<const Formula::Program> program_;
         alignas(64) char padding[64];
     };
 
@@ -0,0 +1,194 @@
+#include "price_paths.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <numbers>
+#include "replication.hpp"
+#include "simd_math.hpp"
+#include "trace.hpp"
+
+namespace PricePaths {
+
+    namespace {
+        struct Partial {
+            std::vector<Replication::QuantileSketch> sketches;
+            std::vector<double> sums;
+        };
+
+        // Scratch columns for one block of paths.
+        struct Block {
+            std::array<std::vector<std::uint32_t>, 4> words;
+            std::vector<double> u1, u2, uJump, v1, v2, log1, logJump, arg, diffusion, state;
+            explicit Block(std::size_t n)
+                : u1(n), u2(n), uJump(n), v1(n), v2(n), log1(n), logJump(n), arg(n), diffusion(n), state(n) {
+                for (auto& column : words)
+                    column.resize(n);
+            }
+        };
+
+        // Philox block `counter` of RNG::Stream(rngKey, firstPath + b, t, Domain::Price) for every lane b: the
+        // same words the stream would produce. The round keys are precomputed and the rounds unroll, so each
+        // lane's state stays in registers and the loop over lanes vectorizes.
+        void philoxColumns(const RNG::StreamKey& rngKey, std::size_t firstPath, std::uint32_t t, std::uint32_t counter,
+                           std::size_t count, Block& block) {
+            std::array<std::uint32_t, 10> key0, key1;
+            key0[0] = static_cast<std::uint32_t>(rngKey.seed);
+            key1[0] = static_cast<std::uint32_t>(rngKey.seed >> 32);
+            for (int round = 1; round < 10; ++round) {
+                key0[round] = key0[round - 1] + RNG::detail::kPhiloxW0;
+                key1[round] = key1[round - 1] + RNG::detail::kPhiloxW1;
+            }
+            const std::uint32_t tag = (static_cast<std::uint32_t>(RNG::Domain::Price) << 24) | (rngKey.combo & 0xFFFFFFu);
+            const auto path = static_cast<std::uint32_t>(firstPath);
+            std::uint32_t* __restrict w0 = block.words[0].data();
+            std::uint32_t* __restrict w1 = block.words[1].data();
+            std::uint32_t* __restrict w2 = block.words[2].data();
+            std::uint32_t* __restrict w3 = block.words[3].data();
+            for (std::size_t b = 0; b < count; ++b) {
+                std::uint32_t x0 = counter, x1 = path + static_cast<std::uint32_t>(b), x2 = t, x3 = tag;
+                for (int round = 0; round < 10; ++round) {
+                    const std::uint64_t p0 = static_cast<std::uint64_t>(RNG::detail::kPhiloxM0) * x0;
+                    const std::uint64_t p1 = static_cast<std::uint64_t>(RNG::detail::kPhiloxM1) * x2;
+                    x0 = static_cast<std::uint32_t>(p1 >> 32) ^ x1 ^ key0[round];
+                    x1 = static_cast<std::uint32_t>(p1);
+                    x2 = static_cast<std::uint32_t>(p0 >> 32) ^ x3 ^ key1[round];
+                    x3 = static_cast<std::uint32_t>(p0);
+                }
+                w0[b] = x0;
+                w1[b] = x1;
+                w2[b] = x2;
+                w3[b] = x3;
+            }
+        }
+
+        // RNG::Stream::uniform from the two words it consumes, high word first: ((hi << 32 | lo) >> 11) * 2^-53,
+        // split into two exact int32 conversions (which vectorize, unlike u64 to double) and an exact sum.
+        inline double uniform(std::uint32_t hi, std::uint32_t lo) {
+            const double high = static_cast<double>(static_cast<std::int32_t>(hi ^ 0x80000000u)) + 0x1.0p31;
+            return high * 0x1.0p-32 + static_cast<double>(static_cast<std::int32_t>(lo >> 11)) * 0x1.0p-53;
+        }
+
+        // out[b] = uniform from words (hiWord, hiWord + 1) of the last philoxColumns call, or 1 - uniform.
+        void uniformColumn(const Block& block, std::size_t hiWord, bool complement, std::size_t count, double* out) {
+            const std::uint32_t* hi = block.words[hiWord].data();
+            const std::uint32_t* lo = block.words[hiWord + 1].data();
+            const double base = complement ? 1.0 : 0.0;
+            const double sign = complement ? -1.0 : 1.0;
+            for (std::size_t b = 0; b < count; ++b)
+                out[b] = base + sign * uniform(hi[b], lo[b]);
+        }
+
+        // cos(2 pi u) for u in [0, 1): the quadrant comes from u itself, so the reduction is exact and the
+        // fdlibm sin/cos kernels on [-pi/4, pi/4] apply. Within a few ulp of std::cos. Adding 2^52 rounds 4u
+        // to the quadrant and leaves it in the low mantissa bits, so the selects below are bit operations.
+        inline double cosTwoPi(double u) {
+            const double shifted = u * 4.0 + 0x1.0p52;
+            const double quadrant = shifted - 0x1.0p52;
+            const std::uint64_t q = std::bit_cast<std::uint64_t>(shifted);
+            const double x = (u - 0.25 * quadrant) * (2.0 * std::numbers::pi);
+            const double z = x * x;
+            const double sinX = x + x * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 +
+                                z * (-1.98412698298579493134e-04 + z * (2.75573137070700676789e-06 +
+                                z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+            const double cosX = 1.0 - 0.5 * z + z * z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 +
+                                z * (2.48015872894767294178e-05 + z * (-2.75573143513906633035e-07 +
+                                z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11)))));
+            // cos(x + quadrant * pi / 2): odd quadrants take sin, quadrants 1 and 2 flip the sign
+            const std::uint64_t odd = 0 - (q & 1);
+            const std::uint64_t value = (std::bit_cast<std::uint64_t>(sinX) & odd) | (std::bit_cast<std::uint64_t>(cosX) & ~odd);
+            return std::bit_cast<double>(value ^ (((q + 1) & 2) << 62));
+        }
+
+        void runBlock(const std::vector<double>& supplyPrice, const JumpDiffusionParams& params, const RNG::StreamKey& rngKey,
+                      std::size_t firstPath, std::size_t count, Block& block, Partial& partial) {
+            const double drift = (params.mu - 0.5 * params.sigma * params.sigma) * params.dt;
+            const double vol = params.sigma * std::sqrt(params.dt);
+            const double jumpProb = params.jumpIntensity * params.dt;
+
+            std::fill_n(block.state.begin(), count, 1.0);
+            for (std::size_t b = 0; b < count; ++b)
+                partial.sketches[0].add(supplyPrice[0]);
+            partial.sums[0] += supplyPrice[0] * count;
+
+            const std::span<const double> u1(block.u1.data(), count), v1(block.v1.data(), count);
+            for (std::size_t t = 1; t < supplyPrice.size(); ++t) {
+                // The five uniforms RNG::Stream::normal/uniform would draw for a single path, as columns: Philox
+                // block 0 holds u1 and u2, block 1 the jump test and v1, block 2 v2
+                const auto step = static_cast<std::uint32_t>(t);
+                philoxColumns(rngKey, firstPath, step, 0, count, block);
+                uniformColumn(block, 0, true, count, block.u1.data());
+                uniformColumn(block, 2, false, count, block.u2.data());
+                philoxColumns(rngKey, firstPath, step, 1, count, block);
+                uniformColumn(block, 0, false, count, block.uJump.data());
+                uniformColumn(block, 2, true, count, block.v1.data());
+                philoxColumns(rngKey, firstPath, step, 2, count, block);
+                uniformColumn(block, 0, false, count, block.v2.data());
+
+                // Box-Muller for both normals and the diffusion exponent as column passes. Every lane computes
+                // its jump normal, so the jump is a select rather than a branch
+                SimdMath::log(u1, std::span<double>(block.log1.data(), count));
+                SimdMath::log(v1, std::span<double>(block.logJump.data(), count));
+                for (std::size_t b = 0; b < count; ++b)
+                    block.arg[b] = drift + vol * (std::sqrt(-2.0 * block.log1[b]) * cosTwoPi(block.u2[b]));
+                SimdMath::exp(std::span<const double>(block.arg.data(), count), std::span<double>(block.diffusion.data(), count));
+                for (std::size_t b = 0; b < count; ++b) {
+                    const double normal = std::sqrt(-2.0 * block.logJump[b]) * cosTwoPi(block.v2[b]);
+                    const double hit = block.uJump[b] < jumpProb ? 1.0 : 0.0;
+                    const double jump = 1.0 + hit * (params.jumpMean + params.jumpStd * normal);
+                    block.state[b] = block.state[b] * block.diffusion[b] * jump;
+                }
+                double sum = 0.0;
+                for (std::size_t b = 0; b < count; ++b) {
+                    double price = supplyPrice[t] * block.state[b];
+                    partial.sketches[t].add(price);
+                    sum += price;
+                }
+                partial.sums[t] += sum;
+            }
+        }
+    }
+
+    PriceBands simulatePricePaths(const std::vector<double>& supplyPrice, std::size_t numPaths,
+                                  const JumpDiffusionParams& params, const RNG::StreamKey& rngKey,
+                                  Scheduler::ThreadPool* threadPool, const PathOptions& options) {
+        DEX_TRACE_SCOPE("price.paths");
+        PriceBands bands;
+        bands.numPaths = numPaths;
+        bands.probabilities = options.probabilities;
+        bands.relativeAccuracy = options.relativeAccuracy;
+        const std::size_t months = supplyPrice.size();
+        if (months == 0 || numPaths == 0)
+            return bands;
+
+        const std::size_t blockSize = std::max<std::size_t>(options.blockSize, 1);
+        Partial identity{ std::vector<Replication::QuantileSketch>(months, Replication::QuantileSketch(options.relativeAccuracy)),
+                          std::vector<double>(months, 0.0) };
+        Partial total = Scheduler::parallelReduce(threadPool, numPaths, std::max(options.taskSize, blockSize), identity,
+            [&](std::size_t begin, std::size_t end) {
+                Partial partial = identity;
+                Block block(blockSize);
+                for (std::size_t first = begin; first < end; first += blockSize)
+                    runBlock(supplyPrice, params, rngKey, first, std::min(blockSize, end - first), block, partial);
+                return partial;
+            },
+            [](const Partial& a, const Partial& b) {
+                Partial merged = a;
+                for (std::size_t t = 0; t < merged.sketches.size(); ++t) {
+                    merged.sketches[t].merge(b.sketches[t]);
+                    merged.sums[t] += b.sums[t];
+                }
+                return merged;
+            });
+
+        bands.quantiles.assign(bands.probabilities.size(), std::vector<double>(months));
+        bands.mean.resize(months);
+        for (std::size_t t = 0; t < months; ++t) {
+            for (std::size_t q = 0; q < bands.probabilities.size(); ++q)
+                bands.quantiles[q][t] = total.sketches[t].quantile(bands.probabilities[q]);
+            bands.mean[t] = total.sums[t] / static_cast<double>(numPaths);
+        }
+        return bands;
+    }
+
+} // namespace PricePaths
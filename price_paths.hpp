@@ -0,0 +1,51 @@
+#ifndef PRICE_PATHS_HPP
+#define PRICE_PATHS_HPP
+
+#include <cstddef>
+#include <vector>
+#include "rng.hpp"
+#include "thread_pool.hpp"
+
+namespace PricePaths {
+
+    // Same model and defaults as Simulation::simulatePriceEvolutionDynamic.
+    struct JumpDiffusionParams {
+        double mu = 0.0;
+        double sigma = 0.05;
+        double jumpIntensity = 0.1;
+        double jumpMean = -0.05;
+        double jumpStd = 0.1;
+        double dt = 1.0;
+    };
+
+    struct PriceBands {
+        std::size_t numPaths = 0;
+        std::vector<double> probabilities;
+        // quantiles[q][month] for probabilities[q], each within `relativeAccuracy` of the exact value.
+        std::vector<std::vector<double>> quantiles;
+        std::vector<double> mean;
+        double relativeAccuracy = 0.0;
+    };
+
+    struct PathOptions {
+        std::vector<double> probabilities = { 0.01, 0.05, 0.5, 0.95, 0.99 };
+        double relativeAccuracy = 0.005;
+        // Paths advanced together one month at a time; sized so the per-path scratch columns stay in L1.
+        std::size_t blockSize = 512;
+        // Paths per parallel task and per partial sketch set.
+        std::size_t taskSize = 16384;
+    };
+
+    // Runs numPaths jump-diffusion multipliers over a supply-driven price curve (computeTokenPrice output),
+    // computed once by the caller. Paths are advanced in blocks laid out as columns and folded straight
+    // into per-month quantile sketches, so memory does not depend on numPaths. Path p draws month t from
+    // stream (rngKey, p, t, Domain::Price): the uniforms are bit-identical to the stream's, generated as
+    // columns, and the normals, jumps and exp run as vectorized column passes, so path 0 matches
+    // simulatePriceEvolutionDynamic to a few ulp. The bands are identical for any thread count.
+    PriceBands simulatePricePaths(const std::vector<double>& supplyPrice, std::size_t numPaths,
+                                  const JumpDiffusionParams& params = {}, const RNG::StreamKey& rngKey = {},
+                                  Scheduler::ThreadPool* threadPool = nullptr, const PathOptions& options = {});
+
+} // namespace PricePaths
+
+#endif // PRICE_PATHS_HPP
@@ -0,0 +1,302 @@
+#include "replication.hpp"
+#include "codec.hpp"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <optional>
+
+namespace Replication {
+
+    void Welford::add(double x) {
+        ++count;
+        double delta = x - mean;
+        mean += delta / count;
+        m2 += delta * (x - mean);
+    }
+
+    void Welford::merge(const Welford& other) {
+        if (other.count == 0)
+            return;
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+        double n = static_cast<double>(count + other.count);
+        double delta = other.mean - mean;
+        mean += delta * other.count / n;
+        m2 += other.m2 + delta * delta * (static_cast<double>(count) * other.count / n);
+        count += other.count;
+    }
+
+    double Welford::stddev() const {
+        return std::sqrt(variance());
+    }
+
+    double Welford::ciHalfWidth(double z) const {
+        return count > 1 ? z * std::sqrt(variance() / count) : INFINITY;
+    }
+
+    // Values below this magnitude are counted as zero rather than indexed.
+    static constexpr double kMinIndexable = 1e-300;
+
+    QuantileSketch::QuantileSketch(double relativeAccuracy)
+        : relativeAccuracy_(relativeAccuracy),
+          gamma_((1.0 + relativeAccuracy) / (1.0 - relativeAccuracy)),
+          logGamma_(std::log(gamma_)),
+          count_(0), zeroCount_(0) {}
+
+    int QuantileSketch::bucketIndex(double magnitude) const {
+        return static_cast<int>(std::ceil(std::log(magnitude) / logGamma_));
+    }
+
+    double QuantileSketch::bucketValue(int index) const {
+        return 2.0 * std::pow(gamma_, index) / (gamma_ + 1.0);
+    }
+
+    void QuantileSketch::BucketStore::add(int index, std::uint64_t n) {
+        if (counts.empty()) {
+            offset = index;
+            counts.push_back(n);
+            return;
+        }
+        if (index < offset) {
+            counts.insert(counts.begin(), static_cast<std::size_t>(offset - index), 0);
+            offset = index;
+        } else if (static_cast<std::size_t>(index - offset) >= counts.size()) {
+            counts.resize(static_cast<std::size_t>(index - offset) + 1, 0);
+        }
+        counts[static_cast<std::size_t>(index - offset)] += n;
+    }
+
+    void QuantileSketch::BucketStore::merge(const BucketStore& other) {
+        if (other.counts.empty())
+            return;
+        // Extend to the other store's range once, then add counts in place
+        add(other.offset, 0);
+        add(other.offset + static_cast<int>(other.counts.size()) - 1, 0);
+        for (std::size_t i = 0; i < other.counts.size(); ++i)
+            counts[static_cast<std::size_t>(other.offset - offset) + i] += other.counts[i];
+    }
+
+    void QuantileSketch::add(double x) {
+        ++count_;
+        // Overflowed values land in the outermost bucket instead of an undefined index; NaN counts as zero
+        x = std::clamp(x, -std::numeric_limits<double>::max(), std::numeric_limits<double>::max());
+        if (x > kMinIndexable)
+            positive_.add(bucketIndex(x), 1);
+        else if (x < -kMinIndexable)
+            negative_.add(bucketIndex(-x), 1);
+        else
+            ++zeroCount_;
+    }
+
+    void QuantileSketch::merge(const QuantileSketch& other) {
+        // Bucket boundaries only line up for equal accuracy; the driver always builds them that way.
+        count_ += other.count_;
+        zeroCount_ += other.zeroCount_;
+        positive_.merge(other.positive_);
+        negative_.merge(other.negative_);
+    }
+
+    void QuantileSketch::encode(std::vector<std::byte>& out) const {
+        Codec::put(out, relativeAccuracy_);
+        Codec::put(out, count_);
+        Codec::put(out, zeroCount_);
+        for (const BucketStore* store : { &positive_, &negative_ }) {
+            Codec::put(out, static_cast<std::int32_t>(store->offset));
+            Codec::putSpan(out, std::span<const std::uint64_t>(store->counts));
+        }
+    }
+
+    QuantileSketch QuantileSketch::decode(std::span<const std::byte>& in) {
+        QuantileSketch sketch(Codec::take<double>(in));
+        sketch.count_ = Codec::take<std::uint64_t>(in);
+        sketch.zeroCount_ = Codec::take<std::uint64_t>(in);
+        for (BucketStore* store : { &sketch.positive_, &sketch.negative_ }) {
+            store->offset = Codec::take<std::int32_t>(in);
+            store->counts = Codec::takeVector<std::uint64_t>(in);
+        }
+        return sketch;
+    }
+
+    double QuantileSketch::quantile(double q) const {
+        if (count_ == 0)
+            return NAN;
+        q = std::clamp(q, 0.0, 1.0);
+        std::uint64_t rank = static_cast<std::uint64_t>(q * (count_ - 1));
+        std::uint64_t seen = 0;
+        // Negatives from the largest magnitude down, then zeros, then positives upwards
+        for (std::size_t i = negative_.counts.size(); i-- > 0;) {
+            seen += negative_.counts[i];
+            if (seen > rank)
+                return -bucketValue(negative_.offset + static_cast<int>(i));
+        }
+        seen += zeroCount_;
+        if (seen > rank)
+            return 0.0;
+        for (std::size_t i = 0; i < positive_.counts.size(); ++i) {
+            seen += positive_.counts[i];
+            if (seen > rank)
+                return bucketValue(positive_.offset + static_cast<int>(i));
+        }
+        return bucketValue(positive_.offset + static_cast<int>(positive_.counts.size()) - 1);
+    }
+
+    ComboAccumulator::ComboAccumulator(double sketchAccuracy) : replications_(0) {
+        for (auto& sketch : shareSketches_)
+            sketch = QuantileSketch(sketchAccuracy);
+    }
+
+    void ComboAccumulator::add(const Simulation::SimulationResult& result) {
+        ++replications_;
+        if (prices_.size() < result.prices.size())
+            prices_.resize(result.prices.size());
+        for (std::size_t t = 0; t < result.prices.size(); ++t)
+            prices_[t].add(result.prices[t]);
+        if (unlocks_.size() < result.totalUnlockedHistory.size())
+            unlocks_.resize(result.totalUnlockedHistory.size());
+        for (std::size_t t = 0; t < result.totalUnlockedHistory.size(); ++t)
+            unlocks_[t].add(result.totalUnlockedHistory[t]);
+        tgeTotal_.add(result.TGETotal);
+        for (std::size_t c = 0; c < Users::kNumCohorts; ++c) {
+            auto it = result.distribution.find(Users::kCohortParams[c].name);
+            if (it == result.distribution.end())
+                continue;
+            shareMoments_[c].add(it->second);
+            shareSketches_[c].add(it->second);
+        }
+    }
+
+    Simulation::SimulationResult ComboAccumulator::meanResult() const {
+        Simulation::SimulationResult result;
+        result.TGETotal = tgeTotal_.mean;
+        for (std::size_t t = 0; t < unlocks_.size(); ++t) {
+            result.months.push_back(static_cast<int>(t));
+            result.totalUnlockedHistory.push_back(unlocks_[t].mean);
+        }
+        for (const Welford& price : prices_)
+            result.prices.push_back(price.mean);
+        for (std::size_t c = 0; c < Users::kNumCohorts; ++c)
+            if (shareMoments_[c].count > 0)
+                result.distribution[Users::kCohortParams[c].name] = shareMoments_[c].mean;
+        return result;
+    }
+
+    void ComboAccumulator::merge(const ComboAccumulator& other) {
+        replications_ += other.replications_;
+        if (prices_.size() < other.prices_.size())
+            prices_.resize(other.prices_.size());
+        for (std::size_t t = 0; t < other.prices_.size(); ++t)
+            prices_[t].merge(other.prices_[t]);
+        if (unlocks_.size() < other.unlocks_.size())
+            unlocks_.resize(other.unlocks_.size());
+        for (std::size_t t = 0; t < other.unlocks_.size(); ++t)
+            unlocks_[t].merge(other.unlocks_[t]);
+        tgeTotal_.merge(other.tgeTotal_);
+        for (std::size_t c = 0; c < Users::kNumCohorts; ++c) {
+            shareMoments_[c].merge(other.shareMoments_[c]);
+            shareSketches_[c].merge(other.shareSketches_[c]);
+        }
+    }
+
+    void ComboAccumulator::encode(std::vector<std::byte>& out) const {
+        Codec::put(out, shareSketches_[0].relativeAccuracy());
+        Codec::put(out, replications_);
+        Codec::putSpan(out, std::span<const Welford>(prices_));
+        Codec::putSpan(out, std::span<const Welford>(unlocks_));
+        Codec::put(out, tgeTotal_);
+        Codec::put(out, shareMoments_);
+        for (const QuantileSketch& sketch : shareSketches_)
+            sketch.encode(out);
+    }
+
+    ComboAccumulator ComboAccumulator::decode(std::span<const std::byte>& in) {
+        ComboAccumulator acc(Codec::take<double>(in));
+        acc.replications_ = Codec::take<std::uint64_t>(in);
+        acc.prices_ = Codec::takeVector<Welford>(in);
+        acc.unlocks_ = Codec::takeVector<Welford>(in);
+        acc.tgeTotal_ = Codec::take<Welford>(in);
+        acc.shareMoments_ = Codec::take<std::array<Welford, Users::kNumCohorts>>(in);
+        for (QuantileSketch& sketch : acc.shareSketches_)
+            sketch = QuantileSketch::decode(in);
+        return acc;
+    }
+
+    double ComboAccumulator::maxRelativeShareCI(double z) const {
+        double worst = 0.0;
+        for (const Welford& share : shareMoments_) {
+            double halfWidth = share.ciHalfWidth(z);
+            // A cohort that never received tokens has nothing to estimate
+            if (halfWidth == 0.0 && share.mean == 0.0)
+                continue;
+            if (halfWidth == 0.0)
+                return INFINITY;
+            worst = std::max(worst, halfWidth / std::max(std::abs(share.mean), 1e-12));
+        }
+        return worst;
+    }
+
+    ReplicationDriver::ReplicationDriver(const ReplicationConfig& config, Scheduler::ThreadPool* threadPool)
+        : config_(config), threadPool_(threadPool) {
+        config_.batchSize = std::max<std::size_t>(config_.batchSize, 1);
+        config_.maxReplications = std::max<std::size_t>(config_.maxReplications, 1);
+        config_.minReplications = std::min(config_.minReplications, config_.maxReplications);
+    }
+
+    ReplicationReport ReplicationDriver::run(std::uint64_t seed, std::uint32_t combo, const SimulateFn& simulate) const {
+        ReplicationReport report{ ComboAccumulator(config_.sketchAccuracy), false };
+        std::size_t done = 0;
+        const std::string unit = "replications/" + std::to_string(combo);
+        if (checkpoints_) {
+            if (const auto* completed = checkpoints_->completed(unit)) {
+                std::span<const std::byte> in(*completed);
+                report.accumulator = ComboAccumulator::decode(in);
+                report.converged = Codec::take<std::uint8_t>(in) != 0;
+                return report;
+            }
+            if (auto snapshot = checkpoints_->snapshot(unit)) {
+                std::span<const std::byte> in(*snapshot);
+                done = Codec::take<std::uint64_t>(in);
+                report.accumulator = ComboAccumulator::decode(in);
+            }
+        }
+        // One round holds at most batchSize results; the round is folded in replication order and then dropped.
+        std::vector<std::optional<Simulation::SimulationResult>> round(config_.batchSize);
+        while (done < config_.maxReplications) {
+            std::size_t count = std::min(config_.batchSize, config_.maxReplications - done);
+            auto body = [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                    round[i] = simulate(RNG::StreamKey{ RNG::deriveSeed(seed, done + i), combo });
+            };
+            if (threadPool_)
+                threadPool_->parallelFor(count, 1, body);
+            else
+                body(0, count);
+            for (std::size_t i = 0; i < count; ++i) {
+                report.accumulator.add(*round[i]);
+                round[i].reset();
+            }
+            done += count;
+
+            if (config_.targetRelativeCI > 0.0 && done >= config_.minReplications &&
+                report.accumulator.maxRelativeShareCI(config_.z) <= config_.targetRelativeCI) {
+                report.converged = true;
+                break;
+            }
+            if (checkpoints_ && done < config_.maxReplications) {
+                std::vector<std::byte> state;
+                Codec::put(state, static_cast<std::uint64_t>(done));
+                report.accumulator.encode(state);
+                checkpoints_->saveSnapshot(unit, std::move(state));
+            }
+        }
+        if (checkpoints_) {
+            std::vector<std::byte> result;
+            report.accumulator.encode(result);
+            Codec::put(result, static_cast<std::uint8_t>(report.converged));
+            checkpoints_->markCompleted(unit, std::move(result));
+        }
+        return report;
+    }
+
+} // namespace Replication
@@ -0,0 +1,136 @@
+#ifndef REPLICATION_HPP
+#define REPLICATION_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+#include "checkpoint.hpp"
+#include "simulation.hpp"
+#include "thread_pool.hpp"
+#include "users.hpp"
+
+namespace Replication {
+
+    // Streaming mean/variance (Welford), mergeable with Chan et al.'s parallel update.
+    struct Welford {
+        std::uint64_t count = 0;
+        double mean = 0.0;
+        double m2 = 0.0;
+
+        void add(double x);
+        void merge(const Welford& other);
+        double variance() const { return count > 1 ? m2 / (count - 1) : 0.0; }
+        double stddev() const;
+        // Half-width of the normal-approximation confidence interval for the mean.
+        double ciHalfWidth(double z) const;
+    };
+
+    // Relative-error quantile sketch (DDSketch, Masson et al. 2019): values fall into logarithmic
+    // buckets, so any quantile is returned within `relativeAccuracy` and two sketches merge exactly
+    // by adding bucket counts. Memory grows with the log of the value range, not with the sample count.
+    class QuantileSketch {
+    public:
+        explicit QuantileSketch(double relativeAccuracy = 0.01);
+        void add(double x);
+        void merge(const QuantileSketch& other);
+        double quantile(double q) const;
+        std::uint64_t count() const { return count_; }
+        double relativeAccuracy() const { return relativeAccuracy_; }
+        std::size_t bucketCount() const { return positive_.counts.size() + negative_.counts.size(); }
+        // Appends a self-describing binary image; decode consumes one from the front of `in` and throws
+        // std::runtime_error if it is truncated.
+        void encode(std::vector<std::byte>& out) const;
+        static QuantileSketch decode(std::span<const std::byte>& in);
+    private:
+        // Contiguous counts for bucket indices [offset, offset + counts.size()); grows at either end.
+        struct BucketStore {
+            int offset = 0;
+            std::vector<std::uint64_t> counts;
+            void add(int index, std::uint64_t n);
+            void merge(const BucketStore& other);
+        };
+
+        double relativeAccuracy_;
+        double gamma_;
+        double logGamma_;
+        std::uint64_t count_;
+        std::uint64_t zeroCount_;
+        BucketStore positive_;
+        BucketStore negative_;
+        int bucketIndex(double magnitude) const;
+        double bucketValue(int index) const;
+    };
+
+    // Everything kept about one policy combo, independent of how many replications were folded in.
+    class ComboAccumulator {
+    public:
+        explicit ComboAccumulator(double sketchAccuracy = 0.01);
+        void add(const Simulation::SimulationResult& result);
+        void merge(const ComboAccumulator& other);
+
+        std::uint64_t replications() const { return replications_; }
+        const std::vector<Welford>& prices() const { return prices_; }
+        const std::vector<Welford>& unlocks() const { return unlocks_; }
+        const Welford& tgeTotal() const { return tgeTotal_; }
+        const Welford& distributionMoments(Users::Cohort cohort) const { return shareMoments_[static_cast<std::size_t>(cohort)]; }
+        const QuantileSketch& distributionSketch(Users::Cohort cohort) const { return shareSketches_[static_cast<std::size_t>(cohort)]; }
+        // Largest cohort token-share CI half-width relative to the mean share, over all cohorts. The price
+        // path is fixed by the cohort counts and the unlock schedule, so the shares are what replications
+        // estimate. A constant nonzero share counts as unconverged (infinity): replications that never move it
+        // are not independent; cohorts that never receive tokens are skipped.
+        double maxRelativeShareCI(double z) const;
+        // The per-step means as a result for the result store: TGE total, prices, total unlocks and cohort
+        // shares. Per-user tokens and per-group unlocks are not aggregated and stay empty.
+        Simulation::SimulationResult meanResult() const;
+        void encode(std::vector<std::byte>& out) const;
+        static ComboAccumulator decode(std::span<const std::byte>& in);
+    private:
+        std::uint64_t replications_;
+        std::vector<Welford> prices_;
+        std::vector<Welford> unlocks_;
+        Welford tgeTotal_;
+        std::array<Welford, Users::kNumCohorts> shareMoments_;
+        std::array<QuantileSketch, Users::kNumCohorts> shareSketches_;
+    };
+
+    struct ReplicationConfig {
+        std::size_t minReplications = 8;
+        std::size_t maxReplications = 1000;
+        // Replications run concurrently per round; bounds the number of results held in memory.
+        std::size_t batchSize = 8;
+        // Stop once every cohort token-share CI half-width is within this fraction of its mean (0 = never stop early).
+        double targetRelativeCI = 0.0;
+        double z = 1.96;
+        double sketchAccuracy = 0.01;
+    };
+
+    struct ReplicationReport {
+        ComboAccumulator accumulator;
+        bool converged;
+    };
+
+    // Runs independent replications of one combo. Replication r uses seed deriveSeed(seed, r) and is
+    // folded in replication order, so the report (including where it stops) does not depend on the
+    // thread count. `simulate` builds and runs one replication for the given stream key.
+    class ReplicationDriver {
+    public:
+        using SimulateFn = std::function<Simulation::SimulationResult(const RNG::StreamKey&)>;
+        ReplicationDriver(const ReplicationConfig& config, Scheduler::ThreadPool* threadPool = nullptr);
+        // With a store, each combo saves its accumulator after every round and its report when done;
+        // run() then returns a completed combo's report without simulating and resumes an unfinished
+        // one after its last saved round, with the same result as an uninterrupted run.
+        void setCheckpoints(Checkpoint::Store* store) { checkpoints_ = store; }
+        ReplicationReport run(std::uint64_t seed, std::uint32_t combo, const SimulateFn& simulate) const;
+    private:
+        ReplicationConfig config_;
+        Scheduler::ThreadPool* threadPool_;
+        Checkpoint::Store* checkpoints_ = nullptr;
+    };
+
+} // namespace Replication
+
+#endif // REPLICATION_HPP
@@ -0,0 +1,328 @@
+#include "result_store.hpp"
+#include "codec.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ResultStore {
+
+    static constexpr std::size_t kHeaderSize = 16;
+    static constexpr std::size_t kTrailerSize = 24;
+
+    static std::size_t elementSize(ColumnType type) {
+        return type == ColumnType::F64 ? sizeof(double) : sizeof(std::int32_t);
+    }
+
+    // Byte planes, then runs: control c < 0x80 is a literal of c + 1 bytes, c >= 0x80 repeats the next byte c - 0x80 + 3 times.
+    static std::vector<std::byte> encodeShuffleRle(const std::byte* src, std::size_t count, std::size_t width) {
+        std::vector<std::byte> planes(count * width);
+        for (std::size_t i = 0; i < count; ++i)
+            for (std::size_t b = 0; b < width; ++b)
+                planes[b * count + i] = src[i * width + b];
+
+        std::vector<std::byte> out;
+        out.reserve(planes.size() / 2);
+        std::size_t literalStart = 0;
+        auto flushLiterals = [&](std::size_t end) {
+            while (literalStart < end) {
+                std::size_t len = std::min<std::size_t>(end - literalStart, 128);
+                out.push_back(static_cast<std::byte>(len - 1));
+                out.insert(out.end(), planes.begin() + literalStart, planes.begin() + literalStart + len);
+                literalStart += len;
+            }
+        };
+        std::size_t i = 0;
+        while (i < planes.size()) {
+            std::size_t run = 1;
+            while (i + run < planes.size() && run < 130 && planes[i + run] == planes[i])
+                ++run;
+            if (run >= 3) {
+                flushLiterals(i);
+                out.push_back(static_cast<std::byte>(0x80 + run - 3));
+                out.push_back(planes[i]);
+                i += run;
+                literalStart = i;
+            } else {
+                i += run;
+            }
+        }
+        flushLiterals(planes.size());
+        return out;
+    }
+
+    static std::vector<std::byte> decodeShuffleRle(const std::byte* src, std::size_t size, std::size_t count, std::size_t width) {
+        std::vector<std::byte> planes;
+        planes.reserve(count * width);
+        std::size_t i = 0;
+        while (i < size) {
+            unsigned control = std::to_integer<unsigned>(src[i++]);
+            if (control < 0x80) {
+                std::size_t len = control + 1;
+                if (i + len > size)
+                    throw std::runtime_error("ResultStore: truncated literal run");
+                planes.insert(planes.end(), src + i, src + i + len);
+                i += len;
+            } else {
+                if (i >= size)
+                    throw std::runtime_error("ResultStore: truncated repeat run");
+                planes.insert(planes.end(), control - 0x80 + 3, src[i++]);
+            }
+        }
+        if (planes.size() != count * width)
+            throw std::runtime_error("ResultStore: decoded column has the wrong length");
+
+        std::vector<std::byte> out(count * width);
+        for (std::size_t b = 0; b < width; ++b)
+            for (std::size_t j = 0; j < count; ++j)
+                out[j * width + b] = planes[b * count + j];
+        return out;
+    }
+
+    Writer::Writer(const std::string& path, bool compress)
+        : file_(std::fopen(path.c_str(), "wb")), compress_(compress), offset_(0) {
+        if (!file_)
+            throw std::runtime_error("ResultStore: cannot open " + path + " for writing");
+        std::uint32_t header[2] = { kVersion, 0 };
+        writeBytes(kMagic, sizeof(kMagic));
+        writeBytes(header, sizeof(header));
+    }
+
+    Writer::~Writer() {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+
+    void Writer::writeBytes(const void* data, std::size_t size) {
+        if (size && std::fwrite(data, 1, size, file_) != size)
+            throw std::runtime_error("ResultStore: write failed");
+        offset_ += size;
+    }
+
+    ColumnInfo Writer::writeColumn(const std::string& name, ColumnType type, const void* data, std::size_t count) {
+        std::size_t width = elementSize(type);
+        const auto* bytes = static_cast<const std::byte*>(data);
+        ColumnInfo info{ name, type, ColumnCodec::None, count, offset_, count * width };
+        if (compress_ && count > 0) {
+            auto encoded = encodeShuffleRle(bytes, count, width);
+            if (encoded.size() < info.storedBytes) {
+                info.codec = ColumnCodec::ShuffleRle;
+                info.storedBytes = encoded.size();
+                writeBytes(encoded.data(), encoded.size());
+            }
+        }
+        if (info.codec == ColumnCodec::None)
+            writeBytes(bytes, info.storedBytes);
+        static constexpr std::byte zeros[8] = {};
+        writeBytes(zeros, (8 - offset_ % 8) % 8);
+        return info;
+    }
+
+    void Writer::append(const std::string& comboName, const Simulation::SimulationResult& result) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!file_)
+            throw std::runtime_error("ResultStore: append after close");
+        ComboInfo combo{ comboName, result.TGETotal, {}, {} };
+        combo.distribution.assign(result.distribution.begin(), result.distribution.end());
+        std::sort(combo.distribution.begin(), combo.distribution.end());
+
+        combo.columns.push_back(writeColumn("months", ColumnType::I32, result.months.data(), result.months.size()));
+        combo.columns.push_back(writeColumn("totalUnlocked", ColumnType::F64, result.totalUnlockedHistory.data(), result.totalUnlockedHistory.size()));
+        combo.columns.push_back(writeColumn("prices", ColumnType::F64, result.prices.data(), result.prices.size()));
+        combo.columns.push_back(writeColumn("TGETokens", ColumnType::F64, result.TGETokens.data(), result.TGETokens.size()));
+        std::vector<std::string> groups;
+        for (const auto& [group, history] : result.unlockedHistory)
+            groups.push_back(group);
+        std::sort(groups.begin(), groups.end());
+        for (const auto& group : groups) {
+            const auto& history = result.unlockedHistory.at(group);
+            combo.columns.push_back(writeColumn("unlocked/" + group, ColumnType::F64, history.data(), history.size()));
+        }
+        index_.push_back(std::move(combo));
+    }
+
+    void Writer::close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!file_)
+            return;
+        std::vector<std::byte> footer;
+        Codec::put(footer, static_cast<std::uint32_t>(index_.size()));
+        for (const auto& combo : index_) {
+            Codec::putString(footer, combo.name);
+            Codec::put(footer, combo.TGETotal);
+            Codec::put(footer, static_cast<std::uint32_t>(combo.distribution.size()));
+            for (const auto& [key, value] : combo.distribution) {
+                Codec::putString(footer, key);
+                Codec::put(footer, value);
+            }
+            Codec::put(footer, static_cast<std::uint32_t>(combo.columns.size()));
+            for (const auto& col : combo.columns) {
+                Codec::putString(footer, col.name);
+                Codec::put(footer, static_cast<std::uint8_t>(col.type));
+                Codec::put(footer, static_cast<std::uint8_t>(col.codec));
+                Codec::put(footer, col.count);
+                Codec::put(footer, col.offset);
+                Codec::put(footer, col.storedBytes);
+            }
+        }
+        std::uint64_t trailer[2] = { offset_, footer.size() };
+        writeBytes(footer.data(), footer.size());
+        writeBytes(trailer, sizeof(trailer));
+        writeBytes(kFooterMagic, sizeof(kFooterMagic));
+        bool ok = std::fclose(file_) == 0;
+        file_ = nullptr;
+        index_.clear();
+        if (!ok)
+            throw std::runtime_error("ResultStore: close failed");
+    }
+
+    std::vector<std::byte> Column::decode(std::size_t width) const {
+        if (isRaw())
+            return std::vector<std::byte>(data_, data_ + info_->storedBytes);
+        return decodeShuffleRle(data_, info_->storedBytes, info_->count, width);
+    }
+
+    std::span<const double> Column::f64() const {
+        if (info_->type != ColumnType::F64 || !isRaw())
+            throw std::runtime_error("ResultStore: column " + info_->name + " is not a raw f64 column");
+        return { reinterpret_cast<const double*>(data_), info_->count };
+    }
+
+    std::span<const std::int32_t> Column::i32() const {
+        if (info_->type != ColumnType::I32 || !isRaw())
+            throw std::runtime_error("ResultStore: column " + info_->name + " is not a raw i32 column");
+        return { reinterpret_cast<const std::int32_t*>(data_), info_->count };
+    }
+
+    std::vector<double> Column::decodeF64() const {
+        if (info_->type != ColumnType::F64)
+            throw std::runtime_error("ResultStore: column " + info_->name + " is not f64");
+        auto bytes = decode(sizeof(double));
+        std::vector<double> out(info_->count);
+        std::memcpy(out.data(), bytes.data(), bytes.size());
+        return out;
+    }
+
+    std::vector<std::int32_t> Column::decodeI32() const {
+        if (info_->type != ColumnType::I32)
+            throw std::runtime_error("ResultStore: column " + info_->name + " is not i32");
+        auto bytes = decode(sizeof(std::int32_t));
+        std::vector<std::int32_t> out(info_->count);
+        std::memcpy(out.data(), bytes.data(), bytes.size());
+        return out;
+    }
+
+    Reader::Reader(const std::string& path) : base_(nullptr), size_(0) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("ResultStore: cannot open " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < kHeaderSize + kTrailerSize) {
+            ::close(fd);
+            throw std::runtime_error("ResultStore: " + path + " is too small to be a result file");
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+            throw std::runtime_error("ResultStore: cannot map " + path);
+        base_ = static_cast<const std::byte*>(mapped);
+
+        try {
+            if (std::memcmp(base_, kMagic, sizeof(kMagic)) != 0 ||
+                std::memcmp(base_ + size_ - sizeof(kFooterMagic), kFooterMagic, sizeof(kFooterMagic)) != 0)
+                throw std::runtime_error("ResultStore: " + path + " is not a result file");
+            std::uint32_t version;
+            std::memcpy(&version, base_ + sizeof(kMagic), sizeof(version));
+            if (version != kVersion)
+                throw std::runtime_error("ResultStore: unsupported version in " + path);
+            std::uint64_t trailer[2];
+            std::memcpy(trailer, base_ + size_ - kTrailerSize, sizeof(trailer));
+            if (trailer[0] < kHeaderSize || trailer[0] + trailer[1] != size_ - kTrailerSize)
+                throw std::runtime_error("ResultStore: corrupt trailer in " + path);
+
+            std::span<const std::byte> cursor(base_ + trailer[0], trailer[1]);
+            auto numCombos = Codec::take<std::uint32_t>(cursor);
+            combos_.reserve(numCombos);
+            for (std::uint32_t c = 0; c < numCombos; ++c) {
+                ComboInfo combo;
+                combo.name = Codec::takeString(cursor);
+                combo.TGETotal = Codec::take<double>(cursor);
+                auto numDist = Codec::take<std::uint32_t>(cursor);
+                for (std::uint32_t d = 0; d < numDist; ++d) {
+                    auto key = Codec::takeString(cursor);
+                    combo.distribution.emplace_back(std::move(key), Codec::take<double>(cursor));
+                }
+                auto numCols = Codec::take<std::uint32_t>(cursor);
+                for (std::uint32_t k = 0; k < numCols; ++k) {
+                    ColumnInfo col;
+                    col.name = Codec::takeString(cursor);
+                    col.type = static_cast<ColumnType>(Codec::take<std::uint8_t>(cursor));
+                    col.codec = static_cast<ColumnCodec>(Codec::take<std::uint8_t>(cursor));
+                    col.count = Codec::take<std::uint64_t>(cursor);
+                    col.offset = Codec::take<std::uint64_t>(cursor);
+                    col.storedBytes = Codec::take<std::uint64_t>(cursor);
+                    if (col.offset + col.storedBytes > trailer[0] ||
+                        (col.codec == ColumnCodec::None && col.storedBytes != col.count * elementSize(col.type)))
+                        throw std::runtime_error("ResultStore: corrupt column index in " + path);
+                    combo.columns.push_back(std::move(col));
+                }
+                combos_.push_back(std::move(combo));
+            }
+        } catch (...) {
+            ::munmap(const_cast<std::byte*>(base_), size_);
+            throw;
+        }
+    }
+
+    Reader::~Reader() {
+        ::munmap(const_cast<std::byte*>(base_), size_);
+    }
+
+    const ComboInfo* Reader::find(const std::string& comboName) const {
+        for (const auto& combo : combos_)
+            if (combo.name == comboName)
+                return &combo;
+        return nullptr;
+    }
+
+    Column Reader::column(const std::string& comboName, const std::string& columnName) const {
+        const ComboInfo* combo = find(comboName);
+        if (!combo)
+            throw std::out_of_range("ResultStore: no combo " + comboName);
+        for (const auto& col : combo->columns)
+            if (col.name == columnName)
+                return Column(&col, base_ + col.offset);
+        throw std::out_of_range("ResultStore: no column " + columnName + " in " + comboName);
+    }
+
+    Simulation::SimulationResult Reader::load(const std::string& comboName) const {
+        const ComboInfo* combo = find(comboName);
+        if (!combo)
+            throw std::out_of_range("ResultStore: no combo " + comboName);
+        Simulation::SimulationResult result;
+        result.TGETotal = combo->TGETotal;
+        for (const auto& [key, value] : combo->distribution)
+            result.distribution[key] = value;
+        for (const auto& col : combo->columns) {
+            Column column(&col, base_ + col.offset);
+            if (col.name == "months")
+                result.months = column.decodeI32();
+            else if (col.name == "totalUnlocked")
+                result.totalUnlockedHistory = column.decodeF64();
+            else if (col.name == "prices")
+                result.prices = column.decodeF64();
+            else if (col.name == "TGETokens")
+                result.TGETokens = column.decodeF64();
+            else if (col.name.starts_with("unlocked/"))
+                result.unlockedHistory[col.name.substr(9)] = column.decodeF64();
+        }
+        return result;
+    }
+
+} // namespace ResultStore
@@ -0,0 +1,115 @@
+#ifndef RESULT_STORE_HPP
+#define RESULT_STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+#include "simulation.hpp"
+
+namespace ResultStore {
+
+    // On-disk layout (little-endian):
+    //   header   "DEXRES01" | u32 version | u32 reserved
+    //   chunks   one per column, each starting on an 8-byte boundary so raw chunks can be viewed in place
+    //   footer   per combo: name, TGE total, distribution, column index (name, type, codec, count, offset, size),
+    //            written with the Codec helpers (strings carry a u64 length)
+    //   trailer  u64 footer offset | u64 footer size | "DEXRESFT"
+
+    inline constexpr char kMagic[8] = { 'D', 'E', 'X', 'R', 'E', 'S', '0', '1' };
+    inline constexpr char kFooterMagic[8] = { 'D', 'E', 'X', 'R', 'E', 'S', 'F', 'T' };
+    inline constexpr std::uint32_t kVersion = 2;
+
+    enum class ColumnType : std::uint8_t { F64 = 1, I32 = 2 };
+
+    // ShuffleRle transposes the value bytes into planes (so equal exponents and zero bytes line up)
+    // and run-length encodes the result; the writer falls back to None when that does not help.
+    enum class ColumnCodec : std::uint8_t { None = 0, ShuffleRle = 1 };
+
+    struct ColumnInfo {
+        std::string name;
+        ColumnType type;
+        ColumnCodec codec;
+        std::uint64_t count;
+        std::uint64_t offset;
+        std::uint64_t storedBytes;
+    };
+
+    struct ComboInfo {
+        std::string name;
+        double TGETotal;
+        std::vector<std::pair<std::string, double>> distribution;
+        std::vector<ColumnInfo> columns;
+    };
+
+    // Streams results to disk as they are appended; only the footer index is kept in memory.
+    // append() may be called concurrently from simulation tasks.
+    class Writer {
+    public:
+        explicit Writer(const std::string& path, bool compress = false);
+        ~Writer();
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        void append(const std::string& comboName, const Simulation::SimulationResult& result);
+        // Writes the footer and trailer; called by the destructor if not done explicitly.
+        void close();
+        std::uint64_t bytesWritten() const { return offset_; }
+    private:
+        std::FILE* file_;
+        bool compress_;
+        std::uint64_t offset_;
+        std::vector<ComboInfo> index_;
+        std::mutex mutex_;
+
+        ColumnInfo writeColumn(const std::string& name, ColumnType type, const void* data, std::size_t count);
+        void writeBytes(const void* data, std::size_t size);
+    };
+
+    class Reader;
+
+    // A column as stored in the mapped file. Uncompressed columns are viewed in place with f64()/i32();
+    // decodeF64()/decodeI32() work for any codec.
+    class Column {
+    public:
+        const ColumnInfo& info() const { return *info_; }
+        bool isRaw() const { return info_->codec == ColumnCodec::None; }
+        std::span<const double> f64() const;
+        std::span<const std::int32_t> i32() const;
+        std::vector<double> decodeF64() const;
+        std::vector<std::int32_t> decodeI32() const;
+    private:
+        friend class Reader;
+        Column(const ColumnInfo* info, const std::byte* data) : info_(info), data_(data) {}
+        const ColumnInfo* info_;
+        const std::byte* data_;
+        std::vector<std::byte> decode(std::size_t elementSize) const;
+    };
+
+    // Maps a result file read-only; opening only parses the footer.
+    class Reader {
+    public:
+        explicit Reader(const std::string& path);
+        ~Reader();
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        const std::vector<ComboInfo>& combos() const { return combos_; }
+        const ComboInfo* find(const std::string& comboName) const;
+        // Throws std::out_of_range for an unknown combo or column.
+        Column column(const std::string& comboName, const std::string& columnName) const;
+        // Materializes a full SimulationResult (copies every column).
+        Simulation::SimulationResult load(const std::string& comboName) const;
+    private:
+        const std::byte* base_;
+        std::size_t size_;
+        std::vector<ComboInfo> combos_;
+    };
+
+} // namespace ResultStore
+
+#endif // RESULT_STORE_HPP
@@ -0,0 +1,204 @@
+#ifndef RNG_HPP
+#define RNG_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace RNG {
+
+    // Counter-based random streams (Philox4x32-10, Salmon et al. 2011).
+    // A stream is a pure function of (master seed, combo, user id, step, domain) plus a draw index,
+    // so results do not depend on thread count or evaluation order and no generator state needs seeding.
+
+    inline constexpr std::uint64_t kDefaultSeed = 0x0DE5C0DE2024ULL;
+
+    enum class Domain : std::uint32_t {
+        Population = 1,
+        Shuffle,
+        UserInit,
+        PreTGE,
+        TGE,
+        PostTGE,
+        Price,
+        Policy,
+        Behaviour
+    };
+
+    struct StreamKey {
+        std::uint64_t seed = kDefaultSeed;
+        std::uint32_t combo = 0;
+    };
+
+    // Independent child seed for replication/shard `index` of a master seed (SplitMix64 finalizer).
+    inline std::uint64_t deriveSeed(std::uint64_t seed, std::uint64_t index) {
+        std::uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    namespace detail {
+        inline constexpr std::uint32_t kPhiloxM0 = 0xD2511F53u;
+        inline constexpr std::uint32_t kPhiloxM1 = 0xCD9E8D57u;
+        inline constexpr std::uint32_t kPhiloxW0 = 0x9E3779B9u;
+        inline constexpr std::uint32_t kPhiloxW1 = 0xBB67AE85u;
+
+        inline std::array<std::uint32_t, 4> philox4x32(std::array<std::uint32_t, 4> ctr, std::array<std::uint32_t, 2> key) {
+            for (int round = 0; round < 10; ++round) {
+                std::uint64_t p0 = static_cast<std::uint64_t>(kPhiloxM0) * ctr[0];
+                std::uint64_t p1 = static_cast<std::uint64_t>(kPhiloxM1) * ctr[2];
+                ctr = { static_cast<std::uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0],
+                        static_cast<std::uint32_t>(p1),
+                        static_cast<std::uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1],
+                        static_cast<std::uint32_t>(p0) };
+                key[0] += kPhiloxW0;
+                key[1] += kPhiloxW1;
+            }
+            return ctr;
+        }
+    } // namespace detail
+
+    class Stream {
+    public:
+        Stream(const StreamKey& key, std::uint32_t user, std::uint32_t step, Domain domain)
+            : key_{ static_cast<std::uint32_t>(key.seed), static_cast<std::uint32_t>(key.seed >> 32) },
+              ctr_{ 0u, user, step, (static_cast<std::uint32_t>(domain) << 24) | (key.combo & 0xFFFFFFu) } {}
+
+        std::uint32_t nextU32() {
+            if (lane_ == 4) {
+                block_ = detail::philox4x32(ctr_, key_);
+                ++ctr_[0];
+                lane_ = 0;
+            }
+            return block_[lane_++];
+        }
+
+        std::uint64_t nextU64() {
+            std::uint64_t hi = nextU32();
+            return (hi << 32) | nextU32();
+        }
+
+        // Uniform on [0, 1) with 53 bits of resolution.
+        double uniform() { return static_cast<double>(nextU64() >> 11) * 0x1.0p-53; }
+        double uniform(double a, double b) { return a + (b - a) * uniform(); }
+
+        // Box-Muller; the second variate is discarded so every draw costs a fixed number of words.
+        double normal() {
+            double u1 = 1.0 - uniform();
+            double u2 = uniform();
+            return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * std::numbers::pi * u2);
+        }
+        double normal(double mean, double stddev) { return mean + stddev * normal(); }
+        double lognormal(double m, double s) { return std::exp(normal(m, s)); }
+
+        // Inversion for the small means used by the user model; normal approximation above that.
+        int poisson(double mean) {
+            if (mean <= 0.0)
+                return 0;
+            if (mean > 64.0)
+                return static_cast<int>(std::max(0.0, std::round(normal(mean, std::sqrt(mean)))));
+            double u = uniform();
+            double p = std::exp(-mean);
+            double cdf = p;
+            int k = 0;
+            while (u > cdf && k < 1024) {
+                ++k;
+                p *= mean / k;
+                cdf += p;
+            }
+            return k;
+        }
+
+        // Unbiased integer in [0, n) (Lemire's multiply-shift with rejection).
+        std::uint32_t below(std::uint32_t n) {
+            std::uint64_t m = static_cast<std::uint64_t>(nextU32()) * n;
+            std::uint32_t low = static_cast<std::uint32_t>(m);
+            if (low < n) {
+                std::uint32_t threshold = static_cast<std::uint32_t>(-n) % n;
+                while (low < threshold) {
+                    m = static_cast<std::uint64_t>(nextU32()) * n;
+                    low = static_cast<std::uint32_t>(m);
+                }
+            }
+            return static_cast<std::uint32_t>(m >> 32);
+        }
+
+        // Philox blocks generated so far by this stream.
+        std::uint32_t blocksUsed() const { return ctr_[0]; }
+
+    private:
+        std::array<std::uint32_t, 2> key_;
+        std::array<std::uint32_t, 4> ctr_;
+        std::array<std::uint32_t, 4> block_{};
+        int lane_ = 4;
+    };
+
+    // Walker/Vose alias table: O(1) draws from a fixed discrete distribution. Built once in O(n) and
+    // read-only afterwards, so one table can be shared across threads; every draw takes the caller's stream.
+    class AliasTable {
+    public:
+        AliasTable() = default;
+        // Weights need not be normalized; negative weights count as zero. Throws std::invalid_argument
+        // if there is no positive weight.
+        explicit AliasTable(std::span<const double> weights) : prob_(weights.size()), alias_(weights.size()) {
+            double total = 0.0;
+            for (double w : weights)
+                total += std::max(w, 0.0);
+            if (!(total > 0.0))
+                throw std::invalid_argument("AliasTable: no positive weight");
+            const std::size_t n = weights.size();
+            std::vector<double> scaled(n);
+            std::vector<std::uint32_t> small, large;
+            for (std::size_t i = 0; i < n; ++i) {
+                scaled[i] = std::max(weights[i], 0.0) * static_cast<double>(n) / total;
+                (scaled[i] < 1.0 ? small : large).push_back(static_cast<std::uint32_t>(i));
+            }
+            while (!small.empty() && !large.empty()) {
+                std::uint32_t s = small.back();
+                std::uint32_t l = large.back();
+                small.pop_back();
+                large.pop_back();
+                prob_[s] = scaled[s];
+                alias_[s] = l;
+                scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+                (scaled[l] < 1.0 ? small : large).push_back(l);
+            }
+            // Whatever is left is 1 up to rounding
+            for (std::uint32_t i : large) {
+                prob_[i] = 1.0;
+                alias_[i] = i;
+            }
+            for (std::uint32_t i : small) {
+                prob_[i] = 1.0;
+                alias_[i] = i;
+            }
+        }
+
+        std::size_t size() const { return prob_.size(); }
+
+        // One uniform per draw: its integer part (scaled by size()) picks the column, the fraction flips
+        // the column's coin.
+        std::size_t sample(double u) const {
+            const double x = u * static_cast<double>(prob_.size());
+            const std::size_t column = std::min(static_cast<std::size_t>(static_cast<std::int64_t>(x)), prob_.size() - 1);
+            // The coin is close to fair for skewed tables, so select without a branch
+            const std::size_t alias = alias_[column];
+            const std::size_t keep = (x - static_cast<double>(column)) < prob_[column];
+            return alias ^ ((alias ^ column) & (std::size_t{ 0 } - keep));
+        }
+        std::size_t sample(Stream& rng) const { return sample(rng.uniform()); }
+
+    private:
+        std::vector<double> prob_;
+        std::vector<std::uint32_t> alias_;
+    };
+
+} // namespace RNG
+
+#endif // RNG_HPP
@@ -0,0 +1,176 @@
+#include "sharding.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace Sharding {
+
+    namespace {
+        constexpr std::size_t kAlign = 64;
+        constexpr std::size_t alignUp(std::size_t n) { return (n + kAlign - 1) / kAlign * kAlign; }
+
+        enum SlotState : std::uint32_t { Pending = 0, Done, Overflow, Failed };
+
+        // Lives at the start of the mapping; followed by the round's unit list and then one slot per unit.
+        struct Control {
+            std::atomic<std::uint64_t> next;
+            std::uint64_t count;
+        };
+
+        struct SlotHeader {
+            std::atomic<std::uint32_t> state;
+            std::uint32_t reserved;
+            std::uint64_t size;
+        };
+
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+                      "cross-process atomics must be lock-free");
+
+        class SharedRegion {
+        public:
+            SharedRegion(std::size_t numUnits, std::size_t slotBytes)
+                : numUnits_(numUnits), slotBytes_(slotBytes), slotStride_(alignUp(sizeof(SlotHeader) + slotBytes)),
+                  listOffset_(alignUp(sizeof(Control))), slotsOffset_(alignUp(listOffset_ + numUnits * sizeof(std::uint64_t))),
+                  size_(slotsOffset_ + numUnits * slotStride_) {
+                // Anonymous and shared: inherited by every fork, and pages are only committed when a slot is written
+                base_ = static_cast<std::byte*>(mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+                if (base_ == MAP_FAILED)
+                    throw std::runtime_error("Sharding: cannot map " + std::to_string(size_) + " bytes of shared memory");
+                new (base_) Control{};
+                for (std::size_t u = 0; u < numUnits_; ++u)
+                    new (slot(u)) SlotHeader{};
+            }
+            ~SharedRegion() { munmap(base_, size_); }
+            SharedRegion(const SharedRegion&) = delete;
+            SharedRegion& operator=(const SharedRegion&) = delete;
+
+            Control& control() { return *reinterpret_cast<Control*>(base_); }
+            std::uint64_t* unitList() { return reinterpret_cast<std::uint64_t*>(base_ + listOffset_); }
+            SlotHeader* slot(std::size_t unit) { return reinterpret_cast<SlotHeader*>(base_ + slotsOffset_ + unit * slotStride_); }
+            std::byte* payload(std::size_t unit) { return reinterpret_cast<std::byte*>(slot(unit)) + sizeof(SlotHeader); }
+            std::size_t slotBytes() const { return slotBytes_; }
+        private:
+            std::size_t numUnits_;
+            std::size_t slotBytes_;
+            std::size_t slotStride_;
+            std::size_t listOffset_;
+            std::size_t slotsOffset_;
+            std::size_t size_;
+            std::byte* base_;
+        };
+
+        void store(SharedRegion& region, std::size_t unit, SlotState state, const void* data, std::size_t size) {
+            SlotHeader* header = region.slot(unit);
+            std::memcpy(region.payload(unit), data, std::min(size, region.slotBytes()));
+            header->size = size;
+            header->state.store(state, std::memory_order_release);
+        }
+
+        // Body of a forked worker; never returns to the caller's stack.
+        [[noreturn]] void workerMain(SharedRegion& region, const ShardConfig& config, const UnitFn& unit) {
+            int status = 0;
+            try {
+                std::unique_ptr<Scheduler::ThreadPool> pool;
+                if (config.threadsPerWorker > 1)
+                    pool = std::make_unique<Scheduler::ThreadPool>(config.threadsPerWorker);
+                Control& control = region.control();
+                std::uint64_t k;
+                while ((k = control.next.fetch_add(1)) < control.count) {
+                    const std::size_t index = region.unitList()[k];
+                    try {
+                        std::vector<std::byte> bytes = unit(index, pool.get());
+                        store(region, index, bytes.size() > region.slotBytes() ? Overflow : Done, bytes.data(), bytes.size());
+                    } catch (const std::exception& e) {
+                        store(region, index, Failed, e.what(), std::strlen(e.what()));
+                    }
+                }
+            } catch (...) {
+                status = 1;
+            }
+            // Skip atexit handlers and stdio flushing: those belong to the coordinator
+            _exit(status);
+        }
+    }
+
+    std::vector<WorkUnit> planUnits(std::uint32_t numCombos, std::uint32_t numReplications, std::size_t numUsers,
+                                    std::size_t usersPerShard) {
+        if (usersPerShard == 0)
+            throw std::runtime_error("Sharding: usersPerShard must be positive");
+        std::vector<WorkUnit> units;
+        for (std::uint32_t combo = 0; combo < numCombos; ++combo)
+            for (std::uint32_t rep = 0; rep < numReplications; ++rep)
+                for (std::size_t first = 0; first < numUsers; first += usersPerShard)
+                    units.push_back({ combo, rep, first, std::min(usersPerShard, numUsers - first) });
+        return units;
+    }
+
+    std::vector<std::vector<std::byte>> run(std::size_t numUnits, const ShardConfig& config, const UnitFn& unit) {
+        DEX_TRACE_SCOPE("sharding.run");
+        SharedRegion region(numUnits, config.slotBytes);
+        const std::size_t maxWorkers = config.workers ? config.workers : std::max(1u, std::thread::hardware_concurrency());
+        for (int attempt = 0; attempt < config.maxAttempts; ++attempt) {
+            std::uint64_t pending = 0;
+            for (std::size_t u = 0; u < numUnits; ++u) {
+                if (region.slot(u)->state.load(std::memory_order_acquire) == Pending)
+                    region.unitList()[pending++] = u;
+            }
+            if (pending == 0)
+                break;
+            region.control().next.store(0);
+            region.control().count = pending;
+
+            std::vector<pid_t> children;
+            const std::size_t numWorkers = std::min<std::size_t>(maxWorkers, pending);
+            for (std::size_t w = 0; w < numWorkers; ++w) {
+                pid_t pid = fork();
+                if (pid == 0)
+                    workerMain(region, config, unit);
+                if (pid < 0) {
+                    // Whatever was forked still drains the queue; missing workers only cost parallelism
+                    if (children.empty())
+                        throw std::runtime_error("Sharding: fork failed");
+                    break;
+                }
+                children.push_back(pid);
+            }
+            for (pid_t pid : children) {
+                int status = 0;
+                while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+            }
+
+            for (std::size_t u = 0; u < numUnits; ++u) {
+                SlotHeader* header = region.slot(u);
+                SlotState state = static_cast<SlotState>(header->state.load(std::memory_order_acquire));
+                if (state == Overflow)
+                    throw std::runtime_error("Sharding: unit " + std::to_string(u) + " produced " + std::to_string(header->size) +
+                                             " bytes, more than the " + std::to_string(region.slotBytes()) + "-byte slot");
+                if (state == Failed)
+                    throw std::runtime_error("Sharding: unit " + std::to_string(u) + " failed: " +
+                                             std::string(reinterpret_cast<const char*>(region.payload(u)),
+                                                         std::min<std::size_t>(header->size, region.slotBytes())));
+            }
+        }
+
+        std::vector<std::vector<std::byte>> results(numUnits);
+        for (std::size_t u = 0; u < numUnits; ++u) {
+            SlotHeader* header = region.slot(u);
+            if (header->state.load(std::memory_order_acquire) != Done)
+                throw std::runtime_error("Sharding: unit " + std::to_string(u) + " unfinished after " +
+                                         std::to_string(config.maxAttempts) + " rounds of workers");
+            results[u].assign(region.payload(u), region.payload(u) + header->size);
+        }
+        return results;
+    }
+
+} // namespace Sharding
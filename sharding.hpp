@@ -0,0 +1,45 @@
+#ifndef SHARDING_HPP
+#define SHARDING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "thread_pool.hpp"
+
+namespace Sharding {
+
+    struct ShardConfig {
+        std::size_t workers = 0;          // forked worker processes; 0 = one per hardware thread
+        std::size_t threadsPerWorker = 1; // above 1, each worker runs its units on a private thread pool
+        std::size_t slotBytes = 1 << 20;  // result capacity of one work unit in the shared mapping
+        int maxAttempts = 2;              // rounds of forking before units whose worker died are an error
+    };
+
+    // One shard of a grid: users [firstUser, firstUser + numUsers) of replication `replication` of `combo`.
+    struct WorkUnit {
+        std::uint32_t combo = 0;
+        std::uint32_t replication = 0;
+        std::size_t firstUser = 0;
+        std::size_t numUsers = 0;
+    };
+
+    // Units in (combo, replication, user range) order. Shard boundaries depend only on usersPerShard,
+    // never on the worker count, so merging shards in this order gives the same bits for any number of workers.
+    std::vector<WorkUnit> planUnits(std::uint32_t numCombos, std::uint32_t numReplications, std::size_t numUsers,
+                                    std::size_t usersPerShard);
+
+    // Produces the encoded result of unit `index`; pool is the worker's thread pool, or null.
+    using UnitFn = std::function<std::vector<std::byte>(std::size_t index, Scheduler::ThreadPool* pool)>;
+
+    // Runs units [0, numUnits) in forked worker processes. Workers claim units from a shared counter and
+    // copy each result into that unit's slot of an anonymous shared mapping; the coordinator returns them by
+    // unit index, independent of which worker ran what or when. Units left unfinished by a worker that
+    // crashed are run again by a fresh round of workers, up to maxAttempts rounds. Throws std::runtime_error
+    // if a unit throws, overflows its slot, or is still unfinished after the last round.
+    // Fork before creating threads in the calling process: a child only inherits the forking thread.
+    std::vector<std::vector<std::byte>> run(std::size_t numUnits, const ShardConfig& config, const UnitFn& unit);
+
+} // namespace Sharding
+
+#endif // SHARDING_HPP
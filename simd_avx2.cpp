@@ -0,0 +1,175 @@
+#include "simd_kernels.hpp"
+#include <immintrin.h>
+
+namespace SimdMath::kernels {
+
+    namespace {
+
+        inline __m256d pow2(__m256d k) {
+            // k is integral and within the normal exponent range: place k + 1023 in the exponent field
+            __m256d biased = _mm256_add_pd(k, _mm256_set1_pd(0x1p52 + 1023.0));
+            return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(biased), 52));
+        }
+
+        // exp(x) via Cody-Waite reduction to |r| <= ln2/2 and a degree-13 Taylor polynomial (< 2 ulp).
+        inline __m256d exp4(__m256d x) {
+            __m256d isNan = _mm256_cmp_pd(x, x, _CMP_UNORD_Q);
+            __m256d xc = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(-746.0)), _mm256_set1_pd(710.0));
+            __m256d k = _mm256_round_pd(_mm256_mul_pd(xc, _mm256_set1_pd(1.4426950408889634)),
+                                        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(6.93147180369123816490e-01), xc);
+            r = _mm256_fnmadd_pd(k, _mm256_set1_pd(1.90821492927058770002e-10), r);
+            __m256d p = _mm256_set1_pd(1.0 / 6227020800.0);
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 479001600.0));
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 39916800.0));
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 3628800.0));
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 362880.0));
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 40320.0));
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 5040.0));
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 720.0));
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 120.0));
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 24.0));
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 6.0));
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(0.5));
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+            // Scale in two halves so results that overflow or go subnormal round like a single multiply
+            __m256d k1 = _mm256_floor_pd(_mm256_mul_pd(k, _mm256_set1_pd(0.5)));
+            __m256d k2 = _mm256_sub_pd(k, k1);
+            p = _mm256_mul_pd(_mm256_mul_pd(p, pow2(k1)), pow2(k2));
+            return _mm256_blendv_pd(p, x, isNan);
+        }
+
+        // log(x) for positive normal x, following fdlibm's e_log.c (< 1 ulp): x = 2^k * m with
+        // m in [sqrt(2)/2, sqrt(2)), then a minimax polynomial in s = (m - 1) / (m + 1).
+        inline __m256d log4(__m256d x) {
+            const __m256i bits = _mm256_castpd_si256(x);
+            __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                                            _mm256_set1_epi64x(0x3FF0000000000000LL)));
+            // Biased exponent to double without AVX-512DQ: OR it under 2^52 and subtract
+            __m256d e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52),
+                                                                          _mm256_set1_epi64x(0x4330000000000000LL))),
+                                      _mm256_set1_pd(0x1p52));
+            __m256d k = _mm256_sub_pd(e, _mm256_set1_pd(1023.0));
+            __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+            m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+            k = _mm256_add_pd(k, _mm256_and_pd(big, _mm256_set1_pd(1.0)));
+
+            __m256d f = _mm256_sub_pd(m, _mm256_set1_pd(1.0));
+            __m256d s = _mm256_div_pd(f, _mm256_add_pd(_mm256_set1_pd(2.0), f));
+            __m256d z = _mm256_mul_pd(s, s);
+            __m256d w = _mm256_mul_pd(z, z);
+            __m256d t1 = _mm256_mul_pd(w, _mm256_add_pd(_mm256_set1_pd(3.999999999940941908e-01),
+                          _mm256_mul_pd(w, _mm256_add_pd(_mm256_set1_pd(2.222219843214978396e-01),
+                          _mm256_mul_pd(w, _mm256_set1_pd(1.531383769920937332e-01))))));
+            __m256d t2 = _mm256_mul_pd(z, _mm256_add_pd(_mm256_set1_pd(6.666666666666735130e-01),
+                          _mm256_mul_pd(w, _mm256_add_pd(_mm256_set1_pd(2.857142874366239149e-01),
+                          _mm256_mul_pd(w, _mm256_add_pd(_mm256_set1_pd(1.818357216161805012e-01),
+                          _mm256_mul_pd(w, _mm256_set1_pd(1.479819860511658591e-01))))))));
+            __m256d r = _mm256_add_pd(t2, t1);
+            __m256d hfsq = _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(0.5), f), f);
+            __m256d inner = _mm256_add_pd(_mm256_mul_pd(s, _mm256_add_pd(hfsq, r)),
+                                          _mm256_mul_pd(k, _mm256_set1_pd(1.90821492927058770002e-10)));
+            return _mm256_sub_pd(_mm256_mul_pd(k, _mm256_set1_pd(6.93147180369123816490e-01)),
+                                 _mm256_sub_pd(_mm256_sub_pd(hfsq, inner), f));
+        }
+
+    } // namespace
+
+    std::size_t powAvx2(const double* base, const double* exponent, double* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(out + i, exp4(_mm256_mul_pd(_mm256_loadu_pd(exponent + i), log4(_mm256_loadu_pd(base + i)))));
+        return i;
+    }
+
+    std::size_t logAvx2(const double* in, double* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(out + i, log4(_mm256_loadu_pd(in + i)));
+        return i;
+    }
+
+    std::size_t expAvx2(const double* in, double* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(out + i, exp4(_mm256_loadu_pd(in + i)));
+        return i;
+    }
+
+    std::size_t clampedExpm1Avx2(const double* points, double* out, std::size_t n, double cap, double factor, double scaling) {
+        const __m256d vCap = _mm256_set1_pd(cap);
+        const __m256d vFactor = _mm256_set1_pd(factor);
+        const __m256d vScaling = _mm256_set1_pd(scaling);
+        const __m256d one = _mm256_set1_pd(1.0);
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d p = _mm256_min_pd(vCap, _mm256_loadu_pd(points + i));
+            __m256d e = exp4(_mm256_div_pd(p, vScaling));
+            _mm256_storeu_pd(out + i, _mm256_mul_pd(vFactor, _mm256_sub_pd(e, one)));
+        }
+        return i;
+    }
+
+    std::size_t tierStepAvx2(const double* points, double* out, std::size_t n, const TierArrays& tiers) {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d p = _mm256_loadu_pd(points + i);
+            __m256d sel = _mm256_set1_pd(tiers.tail);
+            // Walk tiers from the top so the lowest matching tier wins in each lane
+            for (std::size_t k = tiers.count; k-- > 0;) {
+                __m256d hit = _mm256_cmp_pd(p, _mm256_set1_pd(tiers.thresholds[k]), _CMP_LT_OQ);
+                sel = _mm256_blendv_pd(sel, _mm256_set1_pd(tiers.factor[k]), hit);
+            }
+            _mm256_storeu_pd(out + i, sel);
+        }
+        return i;
+    }
+
+    std::size_t tierLinearAvx2(const double* points, double* out, std::size_t n, const TierArrays& tiers) {
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d p = _mm256_loadu_pd(points + i);
+            __m256d prefix = _mm256_setzero_pd();
+            __m256d prev = _mm256_setzero_pd();
+            __m256d factor = _mm256_setzero_pd();
+            __m256d matched = _mm256_setzero_pd();
+            for (std::size_t k = tiers.count; k-- > 0;) {
+                __m256d hit = _mm256_cmp_pd(p, _mm256_set1_pd(tiers.thresholds[k]), _CMP_LE_OQ);
+                prefix = _mm256_blendv_pd(prefix, _mm256_set1_pd(tiers.prefix[k]), hit);
+                prev = _mm256_blendv_pd(prev, _mm256_set1_pd(tiers.prev[k]), hit);
+                factor = _mm256_blendv_pd(factor, _mm256_set1_pd(tiers.factor[k]), hit);
+                matched = _mm256_or_pd(matched, hit);
+            }
+            __m256d value = _mm256_add_pd(prefix, _mm256_mul_pd(_mm256_sub_pd(p, prev), factor));
+            _mm256_storeu_pd(out + i, _mm256_blendv_pd(_mm256_set1_pd(tiers.tail), value, matched));
+        }
+        return i;
+    }
+
+    std::size_t tierExpAvx2(const double* points, double* out, std::size_t n, const TierArrays& tiers) {
+        const __m256d one = _mm256_set1_pd(1.0);
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d p = _mm256_loadu_pd(points + i);
+            __m256d prefix = _mm256_setzero_pd();
+            __m256d prev = _mm256_setzero_pd();
+            __m256d factor = _mm256_setzero_pd();
+            __m256d scaling = one;
+            __m256d matched = _mm256_setzero_pd();
+            for (std::size_t k = tiers.count; k-- > 0;) {
+                __m256d hit = _mm256_cmp_pd(p, _mm256_set1_pd(tiers.thresholds[k]), _CMP_LE_OQ);
+                prefix = _mm256_blendv_pd(prefix, _mm256_set1_pd(tiers.prefix[k]), hit);
+                prev = _mm256_blendv_pd(prev, _mm256_set1_pd(tiers.prev[k]), hit);
+                factor = _mm256_blendv_pd(factor, _mm256_set1_pd(tiers.factor[k]), hit);
+                scaling = _mm256_blendv_pd(scaling, _mm256_set1_pd(tiers.scaling[k]), hit);
+                matched = _mm256_or_pd(matched, hit);
+            }
+            __m256d e = exp4(_mm256_div_pd(_mm256_sub_pd(p, prev), scaling));
+            __m256d value = _mm256_add_pd(prefix, _mm256_mul_pd(factor, _mm256_sub_pd(e, one)));
+            _mm256_storeu_pd(out + i, _mm256_blendv_pd(_mm256_set1_pd(tiers.tail), value, matched));
+        }
+        return i;
+    }
+
+} // namespace SimdMath::kernels
@@ -0,0 +1,159 @@
+#include "simd_kernels.hpp"
+#include <immintrin.h>
+
+namespace SimdMath::kernels {
+
+    namespace {
+
+        // Same reduction and polynomial as the AVX2 kernel; scalef does the 2^k scaling with correct
+        // overflow and subnormal handling.
+        inline __m512d exp8(__m512d x) {
+            __mmask8 isNan = _mm512_cmp_pd_mask(x, x, _CMP_UNORD_Q);
+            __m512d xc = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(-746.0)), _mm512_set1_pd(710.0));
+            __m512d k = _mm512_roundscale_pd(_mm512_mul_pd(xc, _mm512_set1_pd(1.4426950408889634)),
+                                             _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            __m512d r = _mm512_fnmadd_pd(k, _mm512_set1_pd(6.93147180369123816490e-01), xc);
+            r = _mm512_fnmadd_pd(k, _mm512_set1_pd(1.90821492927058770002e-10), r);
+            __m512d p = _mm512_set1_pd(1.0 / 6227020800.0);
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 479001600.0));
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 39916800.0));
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 3628800.0));
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 362880.0));
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 40320.0));
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 5040.0));
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 720.0));
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 120.0));
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 24.0));
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 6.0));
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(0.5));
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0));
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0));
+            return _mm512_mask_blend_pd(isNan, _mm512_scalef_pd(p, k), x);
+        }
+
+        // Same fdlibm log as the AVX2 kernel; getexp/getmant split x into 2^k * m.
+        inline __m512d log8(__m512d x) {
+            __m512d k = _mm512_getexp_pd(x);
+            __m512d m = _mm512_getmant_pd(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src);
+            __mmask8 big = _mm512_cmp_pd_mask(m, _mm512_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+            m = _mm512_mask_mul_pd(m, big, m, _mm512_set1_pd(0.5));
+            k = _mm512_mask_add_pd(k, big, k, _mm512_set1_pd(1.0));
+
+            __m512d f = _mm512_sub_pd(m, _mm512_set1_pd(1.0));
+            __m512d s = _mm512_div_pd(f, _mm512_add_pd(_mm512_set1_pd(2.0), f));
+            __m512d z = _mm512_mul_pd(s, s);
+            __m512d w = _mm512_mul_pd(z, z);
+            __m512d t1 = _mm512_mul_pd(w, _mm512_add_pd(_mm512_set1_pd(3.999999999940941908e-01),
+                          _mm512_mul_pd(w, _mm512_add_pd(_mm512_set1_pd(2.222219843214978396e-01),
+                          _mm512_mul_pd(w, _mm512_set1_pd(1.531383769920937332e-01))))));
+            __m512d t2 = _mm512_mul_pd(z, _mm512_add_pd(_mm512_set1_pd(6.666666666666735130e-01),
+                          _mm512_mul_pd(w, _mm512_add_pd(_mm512_set1_pd(2.857142874366239149e-01),
+                          _mm512_mul_pd(w, _mm512_add_pd(_mm512_set1_pd(1.818357216161805012e-01),
+                          _mm512_mul_pd(w, _mm512_set1_pd(1.479819860511658591e-01))))))));
+            __m512d r = _mm512_add_pd(t2, t1);
+            __m512d hfsq = _mm512_mul_pd(_mm512_mul_pd(_mm512_set1_pd(0.5), f), f);
+            __m512d inner = _mm512_add_pd(_mm512_mul_pd(s, _mm512_add_pd(hfsq, r)),
+                                          _mm512_mul_pd(k, _mm512_set1_pd(1.90821492927058770002e-10)));
+            return _mm512_sub_pd(_mm512_mul_pd(k, _mm512_set1_pd(6.93147180369123816490e-01)),
+                                 _mm512_sub_pd(_mm512_sub_pd(hfsq, inner), f));
+        }
+
+    } // namespace
+
+    std::size_t powAvx512(const double* base, const double* exponent, double* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm512_storeu_pd(out + i, exp8(_mm512_mul_pd(_mm512_loadu_pd(exponent + i), log8(_mm512_loadu_pd(base + i)))));
+        return i;
+    }
+
+    std::size_t logAvx512(const double* in, double* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm512_storeu_pd(out + i, log8(_mm512_loadu_pd(in + i)));
+        return i;
+    }
+
+    std::size_t expAvx512(const double* in, double* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm512_storeu_pd(out + i, exp8(_mm512_loadu_pd(in + i)));
+        return i;
+    }
+
+    std::size_t clampedExpm1Avx512(const double* points, double* out, std::size_t n, double cap, double factor, double scaling) {
+        const __m512d vCap = _mm512_set1_pd(cap);
+        const __m512d vFactor = _mm512_set1_pd(factor);
+        const __m512d vScaling = _mm512_set1_pd(scaling);
+        const __m512d one = _mm512_set1_pd(1.0);
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m512d p = _mm512_min_pd(vCap, _mm512_loadu_pd(points + i));
+            __m512d e = exp8(_mm512_div_pd(p, vScaling));
+            _mm512_storeu_pd(out + i, _mm512_mul_pd(vFactor, _mm512_sub_pd(e, one)));
+        }
+        return i;
+    }
+
+    std::size_t tierStepAvx512(const double* points, double* out, std::size_t n, const TierArrays& tiers) {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m512d p = _mm512_loadu_pd(points + i);
+            __m512d sel = _mm512_set1_pd(tiers.tail);
+            // Walk tiers from the top so the lowest matching tier wins in each lane
+            for (std::size_t k = tiers.count; k-- > 0;) {
+                __mmask8 hit = _mm512_cmp_pd_mask(p, _mm512_set1_pd(tiers.thresholds[k]), _CMP_LT_OQ);
+                sel = _mm512_mask_blend_pd(hit, sel, _mm512_set1_pd(tiers.factor[k]));
+            }
+            _mm512_storeu_pd(out + i, sel);
+        }
+        return i;
+    }
+
+    std::size_t tierLinearAvx512(const double* points, double* out, std::size_t n, const TierArrays& tiers) {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m512d p = _mm512_loadu_pd(points + i);
+            __m512d prefix = _mm512_setzero_pd();
+            __m512d prev = _mm512_setzero_pd();
+            __m512d factor = _mm512_setzero_pd();
+            __mmask8 matched = 0;
+            for (std::size_t k = tiers.count; k-- > 0;) {
+                __mmask8 hit = _mm512_cmp_pd_mask(p, _mm512_set1_pd(tiers.thresholds[k]), _CMP_LE_OQ);
+                prefix = _mm512_mask_blend_pd(hit, prefix, _mm512_set1_pd(tiers.prefix[k]));
+                prev = _mm512_mask_blend_pd(hit, prev, _mm512_set1_pd(tiers.prev[k]));
+                factor = _mm512_mask_blend_pd(hit, factor, _mm512_set1_pd(tiers.factor[k]));
+                matched |= hit;
+            }
+            __m512d value = _mm512_add_pd(prefix, _mm512_mul_pd(_mm512_sub_pd(p, prev), factor));
+            _mm512_storeu_pd(out + i, _mm512_mask_blend_pd(matched, _mm512_set1_pd(tiers.tail), value));
+        }
+        return i;
+    }
+
+    std::size_t tierExpAvx512(const double* points, double* out, std::size_t n, const TierArrays& tiers) {
+        const __m512d one = _mm512_set1_pd(1.0);
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m512d p = _mm512_loadu_pd(points + i);
+            __m512d prefix = _mm512_setzero_pd();
+            __m512d prev = _mm512_setzero_pd();
+            __m512d factor = _mm512_setzero_pd();
+            __m512d scaling = one;
+            __mmask8 matched = 0;
+            for (std::size_t k = tiers.count; k-- > 0;) {
+                __mmask8 hit = _mm512_cmp_pd_mask(p, _mm512_set1_pd(tiers.thresholds[k]), _CMP_LE_OQ);
+                prefix = _mm512_mask_blend_pd(hit, prefix, _mm512_set1_pd(tiers.prefix[k]));
+                prev = _mm512_mask_blend_pd(hit, prev, _mm512_set1_pd(tiers.prev[k]));
+                factor = _mm512_mask_blend_pd(hit, factor, _mm512_set1_pd(tiers.factor[k]));
+                scaling = _mm512_mask_blend_pd(hit, scaling, _mm512_set1_pd(tiers.scaling[k]));
+                matched |= hit;
+            }
+            __m512d e = exp8(_mm512_div_pd(_mm512_sub_pd(p, prev), scaling));
+            __m512d value = _mm512_add_pd(prefix, _mm512_mul_pd(factor, _mm512_sub_pd(e, one)));
+            _mm512_storeu_pd(out + i, _mm512_mask_blend_pd(matched, _mm512_set1_pd(tiers.tail), value));
+        }
+        return i;
+    }
+
+} // namespace SimdMath::kernels
@@ -0,0 +1,46 @@
+#ifndef SIMD_KERNELS_HPP
+#define SIMD_KERNELS_HPP
+
+#include <cstddef>
+
+// Raw ISA-specific kernels. The AVX translation units are compiled with -mavx2/-mavx512f, so this header
+// and those files must stay free of inline C++ library code: anything instantiated there could be picked
+// by the linker for the portable code paths as well. Callers go through simd_math.hpp instead.
+// Every kernel handles the leading multiple of its vector width and returns how many elements it wrote.
+
+namespace SimdMath::kernels {
+
+    // Flattened tier table; tier k covers points up to thresholds[k] and starts at prev[k].
+    // factor[k] is the tier's rate (its constant amount for step tiers), prefix[k] the accumulated
+    // contribution of all tiers below k, and tail the result when no tier matches.
+    struct TierArrays {
+        const double* thresholds;
+        const double* prev;
+        const double* prefix;
+        const double* factor;
+        const double* scaling;
+        std::size_t count;
+        double tail;
+    };
+
+    std::size_t expAvx2(const double* in, double* out, std::size_t n);
+    // exp(exponent * log(base)); only meaningful for positive normal finite bases, callers redo the others.
+    std::size_t powAvx2(const double* base, const double* exponent, double* out, std::size_t n);
+    // Only meaningful for positive normal finite inputs, callers redo the others.
+    std::size_t logAvx2(const double* in, double* out, std::size_t n);
+    std::size_t clampedExpm1Avx2(const double* points, double* out, std::size_t n, double cap, double factor, double scaling);
+    std::size_t tierStepAvx2(const double* points, double* out, std::size_t n, const TierArrays& tiers);
+    std::size_t tierLinearAvx2(const double* points, double* out, std::size_t n, const TierArrays& tiers);
+    std::size_t tierExpAvx2(const double* points, double* out, std::size_t n, const TierArrays& tiers);
+
+    std::size_t expAvx512(const double* in, double* out, std::size_t n);
+    std::size_t powAvx512(const double* base, const double* exponent, double* out, std::size_t n);
+    std::size_t logAvx512(const double* in, double* out, std::size_t n);
+    std::size_t clampedExpm1Avx512(const double* points, double* out, std::size_t n, double cap, double factor, double scaling);
+    std::size_t tierStepAvx512(const double* points, double* out, std::size_t n, const TierArrays& tiers);
+    std::size_t tierLinearAvx512(const double* points, double* out, std::size_t n, const TierArrays& tiers);
+    std::size_t tierExpAvx512(const double* points, double* out, std::size_t n, const TierArrays& tiers);
+
+} // namespace SimdMath::kernels
+
+#endif // SIMD_KERNELS_HPP
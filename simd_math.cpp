@@ -0,0 +1,156 @@
+#include "simd_math.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+namespace SimdMath {
+
+    namespace {
+
+        Level probeLevel() {
+            Level level = Level::Scalar;
+#if defined(DEX_SIMD_X86)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+                level = Level::AVX2;
+            if (__builtin_cpu_supports("avx512f"))
+                level = Level::AVX512;
+#endif
+            if (const char* env = std::getenv("DEX_SIMD")) {
+                std::string requested = env;
+                if (requested == "scalar")
+                    level = Level::Scalar;
+                else if (requested == "avx2" && level == Level::AVX512)
+                    level = Level::AVX2;
+            }
+            return level;
+        }
+
+        std::atomic<int>& levelSlot() {
+            static std::atomic<int> slot(static_cast<int>(detectedLevel()));
+            return slot;
+        }
+
+    } // namespace
+
+    Level detectedLevel() {
+        static const Level level = probeLevel();
+        return level;
+    }
+
+    Level activeLevel() {
+        return static_cast<Level>(levelSlot().load(std::memory_order_relaxed));
+    }
+
+    void setLevel(Level level) {
+        if (static_cast<int>(level) > static_cast<int>(detectedLevel()))
+            level = detectedLevel();
+        levelSlot().store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    const char* levelName(Level level) {
+        switch (level) {
+            case Level::AVX2: return "avx2";
+            case Level::AVX512: return "avx512";
+            default: return "scalar";
+        }
+    }
+
+    void exp(std::span<const double> in, std::span<double> out) {
+        std::size_t done = 0;
+#if defined(DEX_SIMD_X86)
+        switch (activeLevel()) {
+            case Level::AVX512: done = kernels::expAvx512(in.data(), out.data(), in.size()); break;
+            case Level::AVX2: done = kernels::expAvx2(in.data(), out.data(), in.size()); break;
+            default: break;
+        }
+#endif
+        for (std::size_t i = done; i < in.size(); ++i)
+            out[i] = std::exp(in[i]);
+    }
+
+    void pow(std::span<const double> base, std::span<const double> exponent, std::span<double> out) {
+        std::size_t done = 0;
+#if defined(DEX_SIMD_X86)
+        switch (activeLevel()) {
+            case Level::AVX512: done = kernels::powAvx512(base.data(), exponent.data(), out.data(), base.size()); break;
+            case Level::AVX2: done = kernels::powAvx2(base.data(), exponent.data(), out.data(), base.size()); break;
+            default: break;
+        }
+#endif
+        for (std::size_t i = 0; i < done; ++i) {
+            if (!(base[i] >= std::numeric_limits<double>::min() && base[i] <= std::numeric_limits<double>::max()))
+                out[i] = std::pow(base[i], exponent[i]);
+        }
+        for (std::size_t i = done; i < base.size(); ++i)
+            out[i] = std::pow(base[i], exponent[i]);
+    }
+
+    void log(std::span<const double> in, std::span<double> out) {
+        std::size_t done = 0;
+#if defined(DEX_SIMD_X86)
+        switch (activeLevel()) {
+            case Level::AVX512: done = kernels::logAvx512(in.data(), out.data(), in.size()); break;
+            case Level::AVX2: done = kernels::logAvx2(in.data(), out.data(), in.size()); break;
+            default: break;
+        }
+#endif
+        for (std::size_t i = 0; i < done; ++i) {
+            if (!(in[i] >= std::numeric_limits<double>::min() && in[i] <= std::numeric_limits<double>::max()))
+                out[i] = std::log(in[i]);
+        }
+        for (std::size_t i = done; i < in.size(); ++i)
+            out[i] = std::log(in[i]);
+    }
+
+    std::size_t clampedExpm1(std::span<const double> points, std::span<double> out, double cap, double factor, double scaling) {
+#if defined(DEX_SIMD_X86)
+        switch (activeLevel()) {
+            case Level::AVX512: return kernels::clampedExpm1Avx512(points.data(), out.data(), points.size(), cap, factor, scaling);
+            case Level::AVX2: return kernels::clampedExpm1Avx2(points.data(), out.data(), points.size(), cap, factor, scaling);
+            default: break;
+        }
+#endif
+        (void)points; (void)out; (void)cap; (void)factor; (void)scaling;
+        return 0;
+    }
+
+    std::size_t tierStep(std::span<const double> points, std::span<double> out, const TierArrays& tiers) {
+#if defined(DEX_SIMD_X86)
+        switch (activeLevel()) {
+            case Level::AVX512: return kernels::tierStepAvx512(points.data(), out.data(), points.size(), tiers);
+            case Level::AVX2: return kernels::tierStepAvx2(points.data(), out.data(), points.size(), tiers);
+            default: break;
+        }
+#endif
+        (void)points; (void)out; (void)tiers;
+        return 0;
+    }
+
+    std::size_t tierLinear(std::span<const double> points, std::span<double> out, const TierArrays& tiers) {
+#if defined(DEX_SIMD_X86)
+        switch (activeLevel()) {
+            case Level::AVX512: return kernels::tierLinearAvx512(points.data(), out.data(), points.size(), tiers);
+            case Level::AVX2: return kernels::tierLinearAvx2(points.data(), out.data(), points.size(), tiers);
+            default: break;
+        }
+#endif
+        (void)points; (void)out; (void)tiers;
+        return 0;
+    }
+
+    std::size_t tierExp(std::span<const double> points, std::span<double> out, const TierArrays& tiers) {
+#if defined(DEX_SIMD_X86)
+        switch (activeLevel()) {
+            case Level::AVX512: return kernels::tierExpAvx512(points.data(), out.data(), points.size(), tiers);
+            case Level::AVX2: return kernels::tierExpAvx2(points.data(), out.data(), points.size(), tiers);
+            default: break;
+        }
+#endif
+        (void)points; (void)out; (void)tiers;
+        return 0;
+    }
+
+} // namespace SimdMath
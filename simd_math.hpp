@@ -0,0 +1,40 @@
+#ifndef SIMD_MATH_HPP
+#define SIMD_MATH_HPP
+
+#include <cstddef>
+#include <span>
+#include "simd_kernels.hpp"
+
+namespace SimdMath {
+
+    enum class Level { Scalar, AVX2, AVX512 };
+
+    // Best level supported by both the build and the CPU; DEX_SIMD=scalar|avx2|avx512 lowers it.
+    Level detectedLevel();
+    Level activeLevel();
+    // Clamped to detectedLevel(); used by benchmarks and equivalence checks against the scalar path.
+    void setLevel(Level level);
+    const char* levelName(Level level);
+
+    using kernels::TierArrays;
+
+    // out[i] = exp(in[i]) for every element, vectorized where available.
+    void exp(std::span<const double> in, std::span<double> out);
+    // out[i] = pow(base[i], exponent[i]) for every element. Vector lanes compute exp(exponent * log(base)), so the
+    // relative error is a few ulp times |exponent * log(base)|; bases that are not positive normal numbers use std::pow.
+    void pow(std::span<const double> base, std::span<const double> exponent, std::span<double> out);
+    // out[i] = log(in[i]) for every element (< 1 ulp in the vector lanes); inputs that are not positive normal
+    // numbers use std::log. Like pow, out must not alias in.
+    void log(std::span<const double> in, std::span<double> out);
+
+    // The kernels below only fill the leading elements the active vector path can handle and return
+    // that count (0 at Level::Scalar); callers finish the remainder with their own scalar code, which
+    // keeps the scalar fallback bit-identical to the per-user implementation.
+    std::size_t clampedExpm1(std::span<const double> points, std::span<double> out, double cap, double factor, double scaling);
+    std::size_t tierStep(std::span<const double> points, std::span<double> out, const TierArrays& tiers);
+    std::size_t tierLinear(std::span<const double> points, std::span<double> out, const TierArrays& tiers);
+    std::size_t tierExp(std::span<const double> points, std::span<double> out, const TierArrays& tiers);
+
+} // namespace SimdMath
+
+#endif // SIMD_MATH_HPP
@@ -1,143 +1,345 @@
 #include "simulation.hpp"
-#include <random>
+#include "trace.hpp"
+#include "simd_math.hpp"
+#include "codec.hpp"
 #include <numeric>
 #include <cmath>
 #include <algorithm>
 #include <tuple>
 #include <iostream>
+#include <array>
+#include <stdexcept>
 
 namespace Simulation {
 
     MonteCarloSimulation::MonteCarloSimulation(int numUsers, double totalSupply, int preTGESteps, int simulationHorizon,
                                                std::shared_ptr<Airdrop::AirdropPolicy> airdropPolicy,
                                                std::shared_ptr<PreTGE::PreTGERewardsPolicy> preTGEPolicy,
-                                               double airdropAllocationFraction)
+                                               double airdropAllocationFraction,
+                                               const RNG::StreamKey& rngKey)
         : numUsers_(numUsers), totalSupply_(totalSupply), preTGESteps_(preTGESteps),
-          simulationHorizon_(simulationHorizon), airdropAllocationFraction_(airdropAllocationFraction),
+          simulationHorizon_(simulationHorizon), airdropAllocationFraction_(airdropAllocationFraction), rngKey_(rngKey),
           airdropPolicy_(airdropPolicy), preTGEPolicy_(preTGEPolicy) {
-        userPool_ = std::make_shared<UserPoolNS::UserPool>(numUsers_, airdropPolicy_);
+        userPool_ = std::make_shared<UserPoolNS::UserPool>(numUsers_, airdropPolicy_, rngKey_);
         postTGEManager_ = std::make_unique<PostTGE::PostTGERewardsManager>(totalSupply_);
     }
 
+    void MonteCarloSimulation::setVestingSchedules(const std::vector<PostTGE::ScheduleSpec>& specs) {
+        postTGEManager_ = std::make_unique<PostTGE::PostTGERewardsManager>(totalSupply_, specs);
+    }
+
+    MonteCarloSimulation::MonteCarloSimulation(std::shared_ptr<const PopulationNS::Population> population,
+                                               double totalSupply, int preTGESteps, int simulationHorizon,
+                                               std::shared_ptr<Airdrop::AirdropPolicy> airdropPolicy,
+                                               std::shared_ptr<PreTGE::PreTGERewardsPolicy> preTGEPolicy,
+                                               double airdropAllocationFraction,
+                                               const RNG::StreamKey& rngKey)
+        : numUsers_(static_cast<int>(population->size())), totalSupply_(totalSupply), preTGESteps_(preTGESteps),
+          simulationHorizon_(simulationHorizon), airdropAllocationFraction_(airdropAllocationFraction), rngKey_(rngKey),
+          airdropPolicy_(airdropPolicy), preTGEPolicy_(preTGEPolicy) {
+        userPool_ = std::make_shared<UserPoolNS::UserPool>(std::move(population), airdropPolicy_, rngKey_);
+        postTGEManager_ = std::make_unique<PostTGE::PostTGERewardsManager>(totalSupply_);
+    }
+
+    void MonteCarloSimulation::setCheckpointHook(int interval, CheckpointFn hook) {
+        checkpointInterval_ = interval;
+        checkpointHook_ = interval > 0 ? std::move(hook) : nullptr;
+    }
+
+    std::vector<std::byte> MonteCarloSimulation::saveState() const {
+        DEX_TRACE_SCOPE_ARG("checkpoint.save", "combo", rngKey_.combo);
+        std::vector<std::byte> state;
+        userPool_->saveState(state);
+        return state;
+    }
+
+    void MonteCarloSimulation::restoreState(std::span<const std::byte> state) {
+        userPool_->restoreState(state);
+        if (userPool_->stepCount() > static_cast<std::uint32_t>(preTGESteps_))
+            throw std::runtime_error("MonteCarloSimulation: checkpoint is past the PreTGE phase");
+    }
+
     void MonteCarloSimulation::simulatePreTGE() {
-        for (int i = 0; i < preTGESteps_; ++i) {
-            userPool_->stepAll("PreTGE");
+        {
+            DEX_TRACE_SCOPE_ARG("preTGE.steps", "combo", rngKey_.combo);
+            // Resumes after the last step a restored state completed
+            for (int i = static_cast<int>(userPool_->stepCount()); i < preTGESteps_; ++i) {
+                userPool_->stepAll<Users::Phase::PreTGE>();
+                if (checkpointHook_ && (i + 1) % checkpointInterval_ == 0 && i + 1 < preTGESteps_)
+                    checkpointHook_(saveState());
+            }
         }
         if (preTGEPolicy_) {
-            for (auto& user : userPool_->getUsers()) {
-                std::unordered_map<std::string, double> stats;
-                stats["trading_volume"] = (user->getAirdropPoints() + 1) * 100; // dummy activity stat
-                double points = preTGEPolicy_->calculatePoints(stats, user->getUserId());
-                // For simplicity, assume the extra points are added to the user’s airdropPoints.
-                // (In production code, you’d encapsulate this in a setter.)
-            }
+            DEX_TRACE_SCOPE_ARG("preTGE.policy", "combo", rngKey_.combo);
+            auto userIds = userPool_->userIds();
+            preTGEPoints_.assign(userPool_->size(), 0.0);
+            userPool_->publishActivity();
+            Activity::ActivityView activity = userPool_->activity().view();
+            // Scored after the last PreTGE step, so random policies draw from that step of the combo's key
+            const std::uint32_t step = userPool_->stepCount();
+            userPool_->forEachRange([&](std::size_t begin, std::size_t end) {
+                std::size_t count = end - begin;
+                preTGEPolicy_->calculatePoints(activity.slice(begin, count), userIds.subspan(begin, count),
+                                               std::span<double>(preTGEPoints_).subspan(begin, count), rngKey_, step);
+            });
+            // For simplicity the extra points are kept alongside the user's airdropPoints rather than added to them.
             // Optionally normalize points here.
         }
     }
 
+    std::shared_ptr<const std::vector<std::uint8_t>> MonteCarloSimulation::runSybilFilter() {
+        if (!sybilFilter_)
+            return nullptr;
+        DEX_TRACE_SCOPE_ARG("sybil.filter", "combo", rngKey_.combo);
+        Sybil::Fingerprints fingerprints = Sybil::recordBehaviour(*userPool_);
+        Sybil::Clusters clusters = Sybil::cluster(fingerprints, *sybilFilter_, userPool_->threadPool());
+        sybilCapture_ = Sybil::capture(*userPool_, clusters);
+        return Sybil::flagsById(*userPool_, clusters);
+    }
+
     void MonteCarloSimulation::simulateTGE() {
-        userPool_->stepAll("TGE");
+        DEX_TRACE_SCOPE_ARG("tge", "combo", rngKey_.combo);
+        userPool_->stepAll<Users::Phase::TGE>();
     }
 
-    std::tuple<std::vector<int>, std::vector<double>, std::unordered_map<std::string, std::vector<double>>>
-    MonteCarloSimulation::simulatePostTGE() {
-        std::vector<int> months;
-        std::vector<double> totalUnlockedHistory;
+    MonteCarloSimulation::PostTGEHistory MonteCarloSimulation::simulatePostTGE() {
+        DEX_TRACE_SCOPE_ARG("postTGE.unlocks", "combo", rngKey_.combo);
+        // One pass over the compiled schedules fills the whole horizon x groups matrix
+        const PostTGE::VestingEngine& engine = postTGEManager_->getEngine();
+        const std::size_t count = static_cast<std::size_t>(simulationHorizon_) + 1;
+        const std::size_t groups = engine.numGroups();
+        std::vector<double> matrix(count * groups);
+        std::vector<double> totalUnlockedHistory(count);
+        engine.fillHorizon(0.0, 1.0, count, matrix, totalUnlockedHistory);
+
+        std::vector<int> months(count);
+        for (std::size_t t = 0; t < count; ++t)
+            months[t] = static_cast<int>(t);
         std::unordered_map<std::string, std::vector<double>> unlockedHistory;
-        for (int month = 0; month <= simulationHorizon_; ++month) {
-            months.push_back(month);
-            auto allocations = postTGEManager_->getUnlockedAllocations(month);
-            double totalUnlocked = 0;
-            for (const auto& [group, tokens] : allocations) {
-                totalUnlocked += tokens;
-                unlockedHistory[group].push_back(tokens);
-            }
-            totalUnlockedHistory.push_back(totalUnlocked);
+        for (std::size_t g = 0; g < groups; ++g) {
+            std::vector<double>& history = unlockedHistory[engine.groupName(g)];
+            history.resize(count);
+            for (std::size_t t = 0; t < count; ++t)
+                history[t] = matrix[t * groups + g];
         }
         return { months, totalUnlockedHistory, unlockedHistory };
     }
 
     SimulationResult MonteCarloSimulation::run() {
+        DEX_TRACE_SCOPE_ARG("simulation.run", "combo", rngKey_.combo);
         simulatePreTGE();
+        if (auto flags = runSybilFilter())
+            userPool_->setAirdropPolicy(std::make_shared<Sybil::FilteredAirdropPolicy>(airdropPolicy_, flags, sybilFilter_->tokenMultiplier));
         simulateTGE();
-        double rawTGETotal = 0;
-        for (auto& user : userPool_->getUsers()) {
-            rawTGETotal += user->getTokens();
+        auto tokens = userPool_->tokens();
+        SimulationResult result = buildResult(std::vector<double>(tokens.begin(), tokens.end()), userPool_->tokensByCohort(),
+                                              simulatePostTGE());
+        DEX_TRACE_SAMPLE_COUNTERS();
+        return result;
+    }
+
+    std::vector<SimulationResult> MonteCarloSimulation::runFanOut(const std::vector<std::shared_ptr<Airdrop::AirdropPolicy>>& policies) {
+        DEX_TRACE_SCOPE_ARG("simulation.runFanOut", "combo", rngKey_.combo);
+        simulatePreTGE();
+        std::vector<std::shared_ptr<Airdrop::AirdropPolicy>> evaluated = policies;
+        if (auto flags = runSybilFilter()) {
+            for (auto& policy : evaluated)
+                policy = std::make_shared<Sybil::FilteredAirdropPolicy>(policy, flags, sybilFilter_->tokenMultiplier);
+        }
+        std::vector<std::vector<double>> tokenColumns(policies.size(), std::vector<double>(userPool_->size()));
+        DEX_TRACE_ADD(AllocatedBytes, policies.size() * userPool_->size() * sizeof(double));
+        std::vector<std::span<double>> columns(tokenColumns.begin(), tokenColumns.end());
+        std::vector<std::array<double, Users::kNumCohorts>> cohortTokens;
+        {
+            DEX_TRACE_SCOPE_ARG("tge.fanOut", "combo", rngKey_.combo);
+            cohortTokens = userPool_->evaluatePolicies(evaluated, columns);
         }
+        // The vesting schedules do not depend on the airdrop policy either
+        auto postTGE = simulatePostTGE();
+        std::vector<SimulationResult> results;
+        results.reserve(policies.size());
+        for (std::size_t p = 0; p < policies.size(); ++p)
+            results.push_back(buildResult(std::move(tokenColumns[p]), cohortTokens[p], postTGE));
+        DEX_TRACE_SAMPLE_COUNTERS();
+        return results;
+    }
+
+    SimulationResult MonteCarloSimulation::buildResult(std::vector<double> tokens,
+                                                       const std::array<double, Users::kNumCohorts>& cohortTokens,
+                                                       const PostTGEHistory& postTGE) const {
+        DEX_TRACE_SCOPE_ARG("result", "combo", rngKey_.combo);
         double scaledTGETotal = airdropAllocationFraction_ * totalSupply_;
-        if (rawTGETotal > 0) {
-            // Scale tokens for each user (in production code, add a setter in User)
+        std::unordered_map<std::string, double> distribution = cohortDistribution(cohortTokens);
+        const auto& [months, totalUnlockedHistory, unlockedHistory] = postTGE;
+        SimulationResult result;
+        result.TGETotal = scaledTGETotal;
+        result.months = months;
+        result.totalUnlockedHistory = totalUnlockedHistory;
+        result.unlockedHistory = unlockedHistory;
+        result.distribution = distribution;
+        result.TGETokens = std::move(tokens);
+        {
+            DEX_TRACE_SCOPE_ARG("pricing", "combo", rngKey_.combo);
+            result.prices = computeTokenPrice(result.TGETotal, totalUnlockedHistory, *userPool_);
         }
-        std::unordered_map<std::string, double> distribution = { {"small",0}, {"medium",0}, {"large",0}, {"sybil",0} };
-        for (auto& user : userPool_->getUsers()) {
-            if (dynamic_cast<Users::SybilUser*>(user.get()))
-                distribution["sybil"] += user->getTokens();
-            else if (auto ru = dynamic_cast<Users::RegularUser*>(user.get()))
-                distribution[ru->getUserSize()] += user->getTokens();
+        return result;
+    }
+
+    namespace {
+        void encodeSeries(const std::unordered_map<std::string, std::vector<double>>& series, std::vector<std::byte>& out) {
+            // Sorted by name so equal results encode to equal bytes
+            std::vector<const std::string*> names;
+            for (const auto& entry : series)
+                names.push_back(&entry.first);
+            std::sort(names.begin(), names.end(), [](const std::string* a, const std::string* b) { return *a < *b; });
+            Codec::put(out, static_cast<std::uint64_t>(names.size()));
+            for (const std::string* name : names) {
+                Codec::putString(out, *name);
+                Codec::putSpan(out, std::span<const double>(series.at(*name)));
+            }
+        }
+    }
+
+    void encodeResult(const SimulationResult& result, std::vector<std::byte>& out) {
+        Codec::put(out, result.TGETotal);
+        Codec::putSpan(out, std::span<const int>(result.months));
+        Codec::putSpan(out, std::span<const double>(result.totalUnlockedHistory));
+        encodeSeries(result.unlockedHistory, out);
+        std::unordered_map<std::string, std::vector<double>> distribution;
+        for (const auto& [name, share] : result.distribution)
+            distribution[name] = { share };
+        encodeSeries(distribution, out);
+        Codec::putSpan(out, std::span<const double>(result.TGETokens));
+        Codec::putSpan(out, std::span<const double>(result.prices));
+    }
+
+    SimulationResult decodeResult(std::span<const std::byte>& in) {
+        auto decodeSeries = [&in]() {
+            std::unordered_map<std::string, std::vector<double>> series;
+            auto count = Codec::take<std::uint64_t>(in);
+            for (std::uint64_t i = 0; i < count; ++i) {
+                std::string name = Codec::takeString(in);
+                series[name] = Codec::takeVector<double>(in);
+            }
+            return series;
+        };
+        SimulationResult result;
+        result.TGETotal = Codec::take<double>(in);
+        result.months = Codec::takeVector<int>(in);
+        result.totalUnlockedHistory = Codec::takeVector<double>(in);
+        result.unlockedHistory = decodeSeries();
+        for (auto& [name, share] : decodeSeries()) {
+            if (share.size() != 1)
+                throw std::runtime_error("Simulation: malformed result encoding");
+            result.distribution[name] = share[0];
         }
+        result.TGETokens = Codec::takeVector<double>(in);
+        result.prices = Codec::takeVector<double>(in);
+        return result;
+    }
+
+    std::unordered_map<std::string, double> cohortDistribution(const std::array<double, Users::kNumCohorts>& cohortTokens) {
+        std::unordered_map<std::string, double> distribution;
         double totalTokens = 0;
-        for (auto& [key, val] : distribution)
-            totalTokens += val;
+        for (std::size_t c = 0; c < Users::kNumCohorts; ++c) {
+            distribution[Users::kCohortParams[c].name] = cohortTokens[c];
+            totalTokens += cohortTokens[c];
+        }
         if (totalTokens > 0) {
             for (auto& [key, val] : distribution)
                 val = (val / totalTokens) * 100.0;
         }
-        auto [months, totalUnlockedHistory, unlockedHistory] = simulatePostTGE();
-        SimulationResult result;
-        result.TGETotal = scaledTGETotal;
-        result.months = months;
-        result.totalUnlockedHistory = totalUnlockedHistory;
-        result.unlockedHistory = unlockedHistory;
-        for (auto& user : userPool_->getUsers())
-            result.TGETokens.push_back(user->getTokens());
-        result.prices = computeTokenPrice(result.TGETotal, totalUnlockedHistory, userPool_->getUsers());
-        return result;
+        return distribution;
     }
 
     std::vector<double> computeTokenPrice(double TGETotal,
                                             const std::vector<double>& totalUnlockedHistory,
-                                            const std::vector<std::shared_ptr<Users::User>>& users,
+                                            const UserPoolNS::UserPool& users,
                                             double basePrice,
                                             double elasticity,
                                             double buybackRate,
                                             double alpha,
                                             const std::unordered_map<std::string, double>* distribution) {
-        double avgSellWeight = 0.0;
-        if (distribution) {
-            avgSellWeight = ((*distribution).at("small") * 1.0 +
-                             (*distribution).at("medium") * 0.8 +
-                             (*distribution).at("large") * 0.3 +
-                             (*distribution).at("sybil") * 1.0) / 100.0;
-        } else {
-            double sumWeights = 0;
-            for (const auto& user : users) {
-                if (dynamic_cast<Users::SybilUser*>(user.get()))
-                    sumWeights += 1.0;
-                else if (auto ru = dynamic_cast<Users::RegularUser*>(user.get())) {
-                    std::string size = ru->getUserSize();
-                    sumWeights += (size == "small") ? 1.0 : (size == "medium") ? 0.8 : (size == "large") ? 0.3 : 1.0;
-                } else {
-                    sumWeights += 1.0;
-                }
-            }
-            avgSellWeight = sumWeights / users.size();
-        }
+        double avgSellWeight = distribution ? averageSellWeight(*distribution) : users.averageSellWeight();
+        PriceParams params{ basePrice, elasticity, buybackRate, alpha };
         std::vector<double> prices;
         double initialAdditional = totalUnlockedHistory.empty() ? 0 : totalUnlockedHistory[0];
-        for (double unlocked : totalUnlockedHistory) {
-            double circulatingSupply = TGETotal + (unlocked - initialAdditional) * avgSellWeight;
-            double effectiveSupply = TGETotal + (unlocked - initialAdditional) * (avgSellWeight * (1 - buybackRate));
-            effectiveSupply = std::max(effectiveSupply, 1.0);
-            double combinedSupply = alpha * circulatingSupply + (1 - alpha) * effectiveSupply;
-            double price = basePrice * std::pow(TGETotal / combinedSupply, elasticity);
-            prices.push_back(price);
-        }
+        for (double unlocked : totalUnlockedHistory)
+            prices.push_back(supplyModelPrice(TGETotal, unlocked - initialAdditional, avgSellWeight, params));
         return prices;
     }
 
+    double averageSellWeight(const std::unordered_map<std::string, double>& distribution) {
+        double weighted = 0.0;
+        for (std::size_t c = 0; c < Users::kNumCohorts; ++c)
+            weighted += distribution.at(Users::kCohortParams[c].name) * Users::kCohortParams[c].sellWeight;
+        return weighted / 100.0;
+    }
+
+    PriceSweep sweepTokenPrice(double TGETotal, const std::vector<double>& totalUnlockedHistory, double avgSellWeight,
+                               std::span<const PriceParams> grid, Scheduler::ThreadPool* threadPool) {
+        DEX_TRACE_SCOPE("price.sweep");
+        PriceSweep sweep;
+        sweep.gridSize = grid.size();
+        sweep.months = totalUnlockedHistory.size();
+        sweep.prices.resize(sweep.gridSize * sweep.months);
+        // Unlock deltas are shared by every grid point
+        std::vector<double> sinceStart(sweep.months);
+        for (std::size_t t = 0; t < sweep.months; ++t)
+            sinceStart[t] = totalUnlockedHistory[t] - totalUnlockedHistory[0];
+
+        // Rows with a non-unit elasticity are batched so the pow runs through the SIMD kernel;
+        // unit-elasticity rows skip it and stay bit-identical to computeTokenPrice.
+        constexpr std::size_t kRowsPerBlock = 64;
+        auto body = [&](std::size_t begin, std::size_t end) {
+            std::vector<double> ratios, exponents, powed;
+            std::vector<std::size_t> pending;
+            auto flush = [&] {
+                powed.resize(ratios.size());
+                SimdMath::pow(ratios, exponents, powed);
+                for (std::size_t r = 0; r < pending.size(); ++r) {
+                    const std::size_t g = pending[r];
+                    double* row = sweep.prices.data() + g * sweep.months;
+                    const double* p = powed.data() + r * sweep.months;
+                    for (std::size_t t = 0; t < sweep.months; ++t)
+                        row[t] = grid[g].basePrice * p[t];
+                }
+                ratios.clear();
+                exponents.clear();
+                pending.clear();
+            };
+            for (std::size_t g = begin; g < end; ++g) {
+                const PriceParams params = grid[g];
+                if (params.elasticity == 1.0) {
+                    double* row = sweep.prices.data() + g * sweep.months;
+                    for (std::size_t t = 0; t < sweep.months; ++t)
+                        row[t] = supplyModelPrice(TGETotal, sinceStart[t], avgSellWeight, params);
+                    continue;
+                }
+                PriceParams unit = params;
+                unit.basePrice = 1.0;
+                unit.elasticity = 1.0;
+                for (std::size_t t = 0; t < sweep.months; ++t)
+                    ratios.push_back(supplyModelPrice(TGETotal, sinceStart[t], avgSellWeight, unit));
+                exponents.insert(exponents.end(), sweep.months, params.elasticity);
+                pending.push_back(g);
+                if (pending.size() == kRowsPerBlock)
+                    flush();
+            }
+            if (!pending.empty())
+                flush();
+        };
+        constexpr std::size_t kPointsPerTask = 1024;
+        if (threadPool)
+            threadPool->parallelFor(grid.size(), kPointsPerTask, body);
+        else
+            body(0, grid.size());
+        return sweep;
+    }
+
     std::vector<double> simulatePriceEvolutionDynamic(double TGETotal,
                                                         const std::vector<double>& totalUnlockedHistory,
-                                                        const std::vector<std::shared_ptr<Users::User>>& users,
+                                                        const UserPoolNS::UserPool& users,
                                                         double basePrice,
                                                         double elasticity,
                                                         double buybackRate,
@@ -147,19 +349,17 @@ namespace Simulation {
                                                         double jumpIntensity,
                                                         double jumpMean,
                                                         double jumpStd,
-                                                        const std::unordered_map<std::string, double>* distribution) {
+                                                        const std::unordered_map<std::string, double>* distribution,
+                                                        const RNG::StreamKey& rngKey) {
         auto supplyPrice = computeTokenPrice(TGETotal, totalUnlockedHistory, users, basePrice, elasticity, buybackRate, alpha, distribution);
         size_t n = totalUnlockedHistory.size();
         std::vector<double> P_jump(n, 1.0);
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::normal_distribution<double> normalDist(0.0, 1.0);
-        std::normal_distribution<double> jumpDist(jumpMean, jumpStd);
-        std::uniform_real_distribution<double> uniformDist(0.0, 1.0);
         double dt = 1.0;
         for (size_t t = 1; t < n; ++t) {
-            double diffusion = std::exp((mu - 0.5 * sigma * sigma) * dt + sigma * std::sqrt(dt) * normalDist(gen));
-            double jump = (uniformDist(gen) < jumpIntensity * dt) ? 1.0 + jumpDist(gen) : 1.0;
+            // One stream per month keeps each step's draws independent of how many were taken before it
+            RNG::Stream rng(rngKey, 0, static_cast<std::uint32_t>(t), RNG::Domain::Price);
+            double diffusion = std::exp((mu - 0.5 * sigma * sigma) * dt + sigma * std::sqrt(dt) * rng.normal());
+            double jump = (rng.uniform() < jumpIntensity * dt) ? 1.0 + rng.normal(jumpMean, jumpStd) : 1.0;
             P_jump[t] = P_jump[t - 1] * diffusion * jump;
         }
         std::vector<double> prices;
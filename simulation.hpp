@@ -6,10 +6,20 @@
 #include <string>
 #include <memory>
 #include <tuple>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include <functional>
+#include <optional>
+#include <cstddef>
 #include "user_pool.hpp"
 #include "postTGE_rewards.hpp"
 #include "preTGE_rewards.hpp"
 #include "users.hpp"
+#include "rng.hpp"
+#include "population.hpp"
+#include "sybil_filter.hpp"
 
 namespace Simulation {
 
@@ -23,35 +33,117 @@ namespace Simulation {
         std::vector<double> prices;
     };
 
+    // Binary image of a result for checkpoints; decodeResult consumes one from the front of `in`.
+    void encodeResult(const SimulationResult& result, std::vector<std::byte>& out);
+    SimulationResult decodeResult(std::span<const std::byte>& in);
+
     class MonteCarloSimulation {
     public:
         MonteCarloSimulation(int numUsers, double totalSupply, int preTGESteps, int simulationHorizon,
                              std::shared_ptr<Airdrop::AirdropPolicy> airdropPolicy,
                              std::shared_ptr<PreTGE::PreTGERewardsPolicy> preTGEPolicy = nullptr,
-                             double airdropAllocationFraction = 0.15);
+                             double airdropAllocationFraction = 0.15,
+                             const RNG::StreamKey& rngKey = {});
+        // Runs on a shared, read-only population; rngKey drives the per-step draws only.
+        MonteCarloSimulation(std::shared_ptr<const PopulationNS::Population> population,
+                             double totalSupply, int preTGESteps, int simulationHorizon,
+                             std::shared_ptr<Airdrop::AirdropPolicy> airdropPolicy,
+                             std::shared_ptr<PreTGE::PreTGERewardsPolicy> preTGEPolicy = nullptr,
+                             double airdropAllocationFraction = 0.15,
+                             const RNG::StreamKey& rngKey = {});
         void simulatePreTGE();
         void simulateTGE();
-        std::tuple<std::vector<int>, std::vector<double>, std::unordered_map<std::string, std::vector<double>>>
-            simulatePostTGE();
+        using PostTGEHistory = std::tuple<std::vector<int>, std::vector<double>, std::unordered_map<std::string, std::vector<double>>>;
+        PostTGEHistory simulatePostTGE();
         SimulationResult run();
+        // Runs PreTGE once and evaluates every airdrop policy on the same points, one result per policy
+        // (in order). Each result matches run() with that policy and the same key; the constructor's
+        // airdrop policy is not used.
+        std::vector<SimulationResult> runFanOut(const std::vector<std::shared_ptr<Airdrop::AirdropPolicy>>& policies);
         std::shared_ptr<UserPoolNS::UserPool> getUserPool() const { return userPool_; }
+        // Run the per-user phase kernels as subtasks on a shared pool (not owned).
+        void setThreadPool(Scheduler::ThreadPool* threadPool) { userPool_->setThreadPool(threadPool); }
+        // Points from the PreTGE rewards policy, one per pool position (empty without a policy).
+        const std::vector<double>& getPreTGEPoints() const { return preTGEPoints_; }
+        const RNG::StreamKey& getRngKey() const { return rngKey_; }
+        // Replaces the default allocation table (e.g. with PostTGE::loadSchedules output).
+        void setVestingSchedules(const std::vector<PostTGE::ScheduleSpec>& specs);
+        // Clusters the PreTGE behaviour before every TGE evaluation and scales flagged wallets' tokens.
+        void setSybilFilter(const Sybil::FilterConfig& config) { sybilFilter_ = config; }
+        // What the filter flagged in the last run (empty without a filter).
+        const std::optional<Sybil::CaptureReport>& getSybilCapture() const { return sybilCapture_; }
+
+        // Checkpointing: every `interval` PreTGE steps, simulatePreTGE hands saveState() to the hook.
+        // After restoreState, run()/runFanOut() continue from the saved step and produce the same bits
+        // as an uninterrupted run.
+        using CheckpointFn = std::function<void(std::vector<std::byte> state)>;
+        void setCheckpointHook(int interval, CheckpointFn hook);
+        std::vector<std::byte> saveState() const;
+        void restoreState(std::span<const std::byte> state);
     private:
         int numUsers_;
         double totalSupply_;
         int preTGESteps_;
         int simulationHorizon_;
         double airdropAllocationFraction_;
+        RNG::StreamKey rngKey_;
         std::shared_ptr<Airdrop::AirdropPolicy> airdropPolicy_;
         std::shared_ptr<PreTGE::PreTGERewardsPolicy> preTGEPolicy_;
         std::shared_ptr<UserPoolNS::UserPool> userPool_;
         std::unique_ptr<PostTGE::PostTGERewardsManager> postTGEManager_;
+        std::vector<double> preTGEPoints_;
+        int checkpointInterval_ = 0;
+        CheckpointFn checkpointHook_;
+        std::optional<Sybil::FilterConfig> sybilFilter_;
+        std::optional<Sybil::CaptureReport> sybilCapture_;
+        // Per-user-id flags from the sybil filter, or null when none is set.
+        std::shared_ptr<const std::vector<std::uint8_t>> runSybilFilter();
+        SimulationResult buildResult(std::vector<double> tokens, const std::array<double, Users::kNumCohorts>& cohortTokens,
+                                     const PostTGEHistory& postTGE) const;
         alignas(64) char padding[64];
     };
 
     // Pricing functions
+    struct PriceParams {
+        double basePrice = 10.0;
+        double elasticity = 1.0;
+        double buybackRate = 0.2;
+        double alpha = 0.5;
+    };
+
+    // Supply-model price for one month given the tokens unlocked since month 0; shared by
+    // computeTokenPrice and sweepTokenPrice so both produce the same bits.
+    inline double supplyModelPrice(double TGETotal, double unlockedSinceStart, double avgSellWeight, const PriceParams& p) {
+        double circulatingSupply = TGETotal + unlockedSinceStart * avgSellWeight;
+        double effectiveSupply = TGETotal + unlockedSinceStart * (avgSellWeight * (1 - p.buybackRate));
+        effectiveSupply = std::max(effectiveSupply, 1.0);
+        double combinedSupply = p.alpha * circulatingSupply + (1 - p.alpha) * effectiveSupply;
+        double ratio = TGETotal / combinedSupply;
+        return p.basePrice * (p.elasticity == 1.0 ? ratio : std::pow(ratio, p.elasticity));
+    }
+
+    // Percentage of the allocation per cohort name, as stored in SimulationResult::distribution.
+    std::unordered_map<std::string, double> cohortDistribution(const std::array<double, Users::kNumCohorts>& cohortTokens);
+
+    // Sell weight implied by a cohort distribution (percent per cohort name, as in SimulationResult).
+    double averageSellWeight(const std::unordered_map<std::string, double>& distribution);
+
+    struct PriceSweep {
+        std::size_t gridSize = 0;
+        std::size_t months = 0;
+        std::vector<double> prices; // row-major [grid point][month]
+        double at(std::size_t point, std::size_t month) const { return prices[point * months + month]; }
+    };
+
+    // Prices for every grid point over one unlock history. The sell weight is computed once by the
+    // caller (UserPool::averageSellWeight or averageSellWeight(distribution)). Rows with unit elasticity
+    // match computeTokenPrice exactly; other rows use SimdMath::pow and agree to a few ulp.
+    PriceSweep sweepTokenPrice(double TGETotal, const std::vector<double>& totalUnlockedHistory, double avgSellWeight,
+                               std::span<const PriceParams> grid, Scheduler::ThreadPool* threadPool = nullptr);
+
     std::vector<double> computeTokenPrice(double TGETotal,
                                             const std::vector<double>& totalUnlockedHistory,
-                                            const std::vector<std::shared_ptr<Users::User>>& users,
+                                            const UserPoolNS::UserPool& users,
                                             double basePrice = 10.0,
                                             double elasticity = 1.0,
                                             double buybackRate = 0.2,
@@ -60,7 +152,7 @@ namespace Simulation {
 
     std::vector<double> simulatePriceEvolutionDynamic(double TGETotal,
                                                         const std::vector<double>& totalUnlockedHistory,
-                                                        const std::vector<std::shared_ptr<Users::User>>& users,
+                                                        const UserPoolNS::UserPool& users,
                                                         double basePrice = 10.0,
                                                         double elasticity = 1.0,
                                                         double buybackRate = 0.2,
@@ -70,7 +162,8 @@ namespace Simulation {
                                                         double jumpIntensity = 0.1,
                                                         double jumpMean = -0.05,
                                                         double jumpStd = 0.1,
-                                                        const std::unordered_map<std::string, double>* distribution = nullptr);
+                                                        const std::unordered_map<std::string, double>* distribution = nullptr,
+                                                        const RNG::StreamKey& rngKey = {});
 
 } // namespace Simulation
 
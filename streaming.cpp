@@ -0,0 +1,155 @@
+#include "streaming.hpp"
+#include "codec.hpp"
+#include "population.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+
+namespace Streaming {
+
+    namespace {
+        // Sketch buckets hold integer counts, so merging per-range sketches in any order gives the same sketch
+        void addToSketch(const UserPoolNS::UserPool& pool, std::span<const double> values, Replication::QuantileSketch& sketch) {
+            std::mutex mutex;
+            pool.forEachRange([&](std::size_t begin, std::size_t end) {
+                Replication::QuantileSketch local(sketch.relativeAccuracy());
+                for (std::size_t i = begin; i < end; ++i)
+                    local.add(values[i]);
+                std::lock_guard<std::mutex> lock(mutex);
+                sketch.merge(local);
+            });
+        }
+    }
+
+    StreamingSimulation::StreamingSimulation(std::size_t numUsers, double totalSupply, int preTGESteps, int simulationHorizon,
+                                             std::shared_ptr<PreTGE::PreTGERewardsPolicy> preTGEPolicy,
+                                             double airdropAllocationFraction,
+                                             const RNG::StreamKey& rngKey,
+                                             const StreamingConfig& config)
+        : numUsers_(numUsers), totalSupply_(totalSupply), preTGESteps_(preTGESteps), simulationHorizon_(simulationHorizon),
+          preTGEPolicy_(std::move(preTGEPolicy)), airdropAllocationFraction_(airdropAllocationFraction), rngKey_(rngKey),
+          config_(config), vestingSchedules_(PostTGE::defaultSchedules()), threadPool_(nullptr) {
+        if (config_.batchSize == 0)
+            throw std::runtime_error("StreamingSimulation: batch size must be positive");
+    }
+
+    StreamingReport StreamingSimulation::run(const std::vector<std::shared_ptr<Airdrop::AirdropPolicy>>& policies) {
+        StreamingReport report = run(policies, 0, numUsers_);
+        finish(report);
+        return report;
+    }
+
+    StreamingReport StreamingSimulation::run(const std::vector<std::shared_ptr<Airdrop::AirdropPolicy>>& policies,
+                                             std::size_t first, std::size_t count) {
+        DEX_TRACE_SCOPE_ARG("streaming.run", "combo", rngKey_.combo);
+        if (first + count > numUsers_)
+            throw std::runtime_error("StreamingSimulation: user range out of bounds");
+        StreamingReport report;
+        report.numUsers = count;
+        report.preTGEPoints = Replication::QuantileSketch(config_.sketchAccuracy);
+        report.policies.resize(policies.size());
+        for (PolicySummary& summary : report.policies)
+            summary.tokens = Replication::QuantileSketch(config_.sketchAccuracy);
+
+        // Token columns are reused by every batch
+        std::vector<std::vector<double>> tokenColumns(policies.size());
+        const std::size_t end = first + count;
+        for (std::size_t begin = first; begin < end; begin += config_.batchSize) {
+            DEX_TRACE_SCOPE_ARG("streaming.batch", "combo", rngKey_.combo);
+            const std::size_t batch = std::min(config_.batchSize, end - begin);
+            Simulation::MonteCarloSimulation sim(PopulationNS::Population::generateRange(numUsers_, rngKey_, begin, batch),
+                                                 totalSupply_, preTGESteps_, simulationHorizon_, nullptr, preTGEPolicy_,
+                                                 airdropAllocationFraction_, rngKey_);
+            sim.setThreadPool(threadPool_);
+            sim.simulatePreTGE();
+            const UserPoolNS::UserPool& pool = *sim.getUserPool();
+            report.cohorts = report.cohorts + pool.cohortTotals();
+            if (preTGEPolicy_)
+                addToSketch(pool, sim.getPreTGEPoints(), report.preTGEPoints);
+
+            std::vector<std::span<double>> columns;
+            for (auto& column : tokenColumns) {
+                column.resize(batch);
+                columns.emplace_back(column);
+            }
+            auto cohortTokens = pool.evaluatePolicies(policies, columns);
+            for (std::size_t p = 0; p < policies.size(); ++p) {
+                for (std::size_t c = 0; c < Users::kNumCohorts; ++c)
+                    report.policies[p].cohortTokens[c] += cohortTokens[p][c];
+                addToSketch(pool, tokenColumns[p], report.policies[p].tokens);
+            }
+            ++report.batches;
+        }
+        return report;
+    }
+
+    void StreamingSimulation::finish(StreamingReport& report) const {
+        // The unlock schedule does not depend on the users, so an empty population is enough to compute it
+        Simulation::MonteCarloSimulation sim(PopulationNS::Population::generateRange(numUsers_, rngKey_, 0, 0),
+                                             totalSupply_, preTGESteps_, simulationHorizon_, nullptr, nullptr,
+                                             airdropAllocationFraction_, rngKey_);
+        sim.setVestingSchedules(vestingSchedules_);
+        const auto [months, totalUnlockedHistory, unlockedHistory] = sim.simulatePostTGE();
+        const double avgSellWeight = UserPoolNS::averageSellWeight(report.cohorts);
+        const double initialAdditional = totalUnlockedHistory.empty() ? 0 : totalUnlockedHistory[0];
+        for (PolicySummary& summary : report.policies) {
+            Simulation::SimulationResult& result = summary.result;
+            result = {};
+            result.TGETotal = airdropAllocationFraction_ * totalSupply_;
+            result.months = months;
+            result.totalUnlockedHistory = totalUnlockedHistory;
+            result.unlockedHistory = unlockedHistory;
+            result.distribution = Simulation::cohortDistribution(summary.cohortTokens);
+            for (double unlocked : totalUnlockedHistory)
+                result.prices.push_back(Simulation::supplyModelPrice(result.TGETotal, unlocked - initialAdditional, avgSellWeight, {}));
+        }
+    }
+
+    void merge(StreamingReport& into, const StreamingReport& from) {
+        if (into.policies.size() != from.policies.size())
+            throw std::runtime_error("Streaming: cannot merge reports for different policies");
+        into.numUsers += from.numUsers;
+        into.batches += from.batches;
+        into.cohorts = into.cohorts + from.cohorts;
+        into.preTGEPoints.merge(from.preTGEPoints);
+        for (std::size_t p = 0; p < into.policies.size(); ++p) {
+            for (std::size_t c = 0; c < Users::kNumCohorts; ++c)
+                into.policies[p].cohortTokens[c] += from.policies[p].cohortTokens[c];
+            into.policies[p].tokens.merge(from.policies[p].tokens);
+        }
+    }
+
+    std::vector<std::byte> encode(const StreamingReport& report) {
+        std::vector<std::byte> out;
+        Codec::put(out, static_cast<std::uint64_t>(report.numUsers));
+        Codec::put(out, static_cast<std::uint64_t>(report.batches));
+        Codec::put(out, report.cohorts);
+        report.preTGEPoints.encode(out);
+        Codec::put(out, static_cast<std::uint64_t>(report.policies.size()));
+        for (const PolicySummary& summary : report.policies) {
+            Codec::put(out, summary.cohortTokens);
+            summary.tokens.encode(out);
+        }
+        return out;
+    }
+
+    StreamingReport decode(std::span<const std::byte> bytes) {
+        StreamingReport report;
+        report.numUsers = Codec::take<std::uint64_t>(bytes);
+        report.batches = Codec::take<std::uint64_t>(bytes);
+        report.cohorts = Codec::take<UserPoolNS::CohortTotals>(bytes);
+        report.preTGEPoints = Replication::QuantileSketch::decode(bytes);
+        auto numPolicies = Codec::take<std::uint64_t>(bytes);
+        if (numPolicies > bytes.size())
+            throw std::runtime_error("Streaming: malformed report encoding");
+        report.policies.resize(numPolicies);
+        for (PolicySummary& summary : report.policies) {
+            summary.cohortTokens = Codec::take<std::array<double, Users::kNumCohorts>>(bytes);
+            summary.tokens = Replication::QuantileSketch::decode(bytes);
+        }
+        return report;
+    }
+
+} // namespace Streaming
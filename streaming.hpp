@@ -0,0 +1,90 @@
+#ifndef STREAMING_HPP
+#define STREAMING_HPP
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+#include "airdrop_policy.hpp"
+#include "preTGE_rewards.hpp"
+#include "postTGE_rewards.hpp"
+#include "replication.hpp"
+#include "rng.hpp"
+#include "simulation.hpp"
+#include "thread_pool.hpp"
+#include "user_pool.hpp"
+#include "users.hpp"
+
+namespace Streaming {
+
+    struct StreamingConfig {
+        // Users generated, simulated and discarded together; memory is proportional to this, not to numUsers.
+        std::size_t batchSize = 1 << 18;
+        double sketchAccuracy = 0.01;
+    };
+
+    struct PolicySummary {
+        // Same fields as MonteCarloSimulation::run() except TGETokens, which is left empty.
+        Simulation::SimulationResult result;
+        std::array<double, Users::kNumCohorts> cohortTokens{};
+        // Distribution of per-user allocations.
+        Replication::QuantileSketch tokens;
+    };
+
+    // Aggregates of a run or of a user range of one; partial reports combine with merge() and get their
+    // results from StreamingSimulation::finish().
+    struct StreamingReport {
+        std::size_t numUsers = 0;
+        std::size_t batches = 0;
+        // Cohort sizes and airdrop points at TGE.
+        UserPoolNS::CohortTotals cohorts;
+        // Points from the PreTGE rewards policy (empty without one).
+        Replication::QuantileSketch preTGEPoints;
+        std::vector<PolicySummary> policies;
+    };
+
+    // Adds from's aggregates to into (same policies, same sketch accuracy). Results are not merged.
+    void merge(StreamingReport& into, const StreamingReport& from);
+    // Binary image of a report's aggregates, for passing partial reports between processes.
+    std::vector<std::byte> encode(const StreamingReport& report);
+    StreamingReport decode(std::span<const std::byte> bytes);
+
+    // Users never interact, so a population can be pushed through PreTGE, reward scoring and TGE one batch
+    // at a time and then dropped; only mergeable aggregates and sketches survive. Every user's state is a
+    // function of its id and step, so the aggregates equal a materialized run up to summation order. Batches
+    // are folded in order and split across the thread pool internally, so reports are thread-count invariant.
+    class StreamingSimulation {
+    public:
+        StreamingSimulation(std::size_t numUsers, double totalSupply, int preTGESteps, int simulationHorizon,
+                            std::shared_ptr<PreTGE::PreTGERewardsPolicy> preTGEPolicy = nullptr,
+                            double airdropAllocationFraction = 0.15,
+                            const RNG::StreamKey& rngKey = {},
+                            const StreamingConfig& config = {});
+        void setThreadPool(Scheduler::ThreadPool* threadPool) { threadPool_ = threadPool; }
+        void setVestingSchedules(const std::vector<PostTGE::ScheduleSpec>& specs) { vestingSchedules_ = specs; }
+        // One summary per airdrop policy, in order.
+        StreamingReport run(const std::vector<std::shared_ptr<Airdrop::AirdropPolicy>>& policies);
+        // Aggregates for users [first, first + count) only, with results left empty; merging the partial
+        // reports of a split of [0, numUsers) in order and calling finish() completes the run.
+        StreamingReport run(const std::vector<std::shared_ptr<Airdrop::AirdropPolicy>>& policies,
+                            std::size_t first, std::size_t count);
+        // Builds each policy's SimulationResult (distribution, unlocks, prices) from the aggregates.
+        void finish(StreamingReport& report) const;
+    private:
+        std::size_t numUsers_;
+        double totalSupply_;
+        int preTGESteps_;
+        int simulationHorizon_;
+        std::shared_ptr<PreTGE::PreTGERewardsPolicy> preTGEPolicy_;
+        double airdropAllocationFraction_;
+        RNG::StreamKey rngKey_;
+        StreamingConfig config_;
+        std::vector<PostTGE::ScheduleSpec> vestingSchedules_;
+        Scheduler::ThreadPool* threadPool_;
+        alignas(64) char padding[64];
+    };
+
+} // namespace Streaming
+
+#endif // STREAMING_HPP
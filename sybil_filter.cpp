@@ -0,0 +1,279 @@
+#include "sybil_filter.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <numeric>
+#include <utility>
+
+namespace Sybil {
+
+    namespace {
+        constexpr std::size_t kStepsPerWord = 64 / kActionsPerStep;
+
+        // SplitMix64 finalizer
+        constexpr std::uint64_t mix64(std::uint64_t z) {
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        // Union-find whose roots are always the smallest position in their set
+        class DisjointSets {
+        public:
+            explicit DisjointSets(std::size_t n) : parent_(n) { std::iota(parent_.begin(), parent_.end(), 0u); }
+            std::uint32_t find(std::uint32_t x) {
+                while (parent_[x] != x) {
+                    parent_[x] = parent_[parent_[x]];
+                    x = parent_[x];
+                }
+                return x;
+            }
+            void unite(std::uint32_t a, std::uint32_t b) {
+                a = find(a);
+                b = find(b);
+                if (a != b)
+                    parent_[std::max(a, b)] = std::min(a, b);
+            }
+        private:
+            std::vector<std::uint32_t> parent_;
+        };
+    }
+
+    Fingerprints::Fingerprints(std::size_t numUsers, std::size_t numSteps)
+        : numUsers_(numUsers), numSteps_(numSteps), words_((numSteps + kStepsPerWord - 1) / kStepsPerWord),
+          bits_(numUsers * words_, 0) {}
+
+    Fingerprints recordBehaviour(const UserPoolNS::UserPool& pool) {
+        DEX_TRACE_SCOPE("sybil.fingerprint");
+        Fingerprints fingerprints(pool.size(), pool.stepCount());
+        auto rates = pool.interactionRate();
+        pool.forEachRange([&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                if (rates[i] <= 0)
+                    continue;
+                auto row = fingerprints.row(i);
+                for (std::uint32_t step = 0; step < fingerprints.numSteps(); ++step) {
+                    const std::uint32_t mask = pool.stepActions(i, step);
+                    row[step / kStepsPerWord] |= static_cast<std::uint64_t>(mask) << (kActionsPerStep * (step % kStepsPerWord));
+                }
+            }
+        });
+        return fingerprints;
+    }
+
+    Clusters cluster(const Fingerprints& fingerprints, const FilterConfig& config, Scheduler::ThreadPool* threadPool) {
+        DEX_TRACE_SCOPE("sybil.cluster");
+        const std::size_t n = fingerprints.size();
+        const std::size_t bands = std::max<std::size_t>(1, config.bands);
+        const std::size_t rows = std::max<std::size_t>(1, config.rowsPerBand);
+        const std::size_t numHashes = bands * rows;
+
+        // One-permutation MinHash: each element lands in one of numHashes bins, whose minima serve as the
+        // signature. An empty bin copies the filled bin its own fixed probe sequence reaches first (optimal
+        // densification), so two wallets still agree on it with probability equal to their Jaccard
+        // similarity. Element hashes and probe sequences do not depend on the wallet and are tabulated once;
+        // a wallet too sparse for all kProbes probes falls back to the next filled bin in order.
+        const std::size_t numElements = fingerprints.wordsPerUser() * 64;
+        std::vector<std::uint32_t> elementBin(numElements);
+        std::vector<std::uint32_t> elementHash(numElements);
+        for (std::size_t e = 0; e < numElements; ++e) {
+            const std::uint64_t g = mix64(e + config.hashSeed);
+            elementBin[e] = static_cast<std::uint32_t>(((g >> 32) * numHashes) >> 32);
+            elementHash[e] = static_cast<std::uint32_t>(g);
+        }
+        constexpr std::size_t kProbes = 32;
+        std::vector<std::uint32_t> probes(numHashes * kProbes);
+        for (std::size_t k = 0; k < numHashes; ++k) {
+            std::uint64_t probe = k;
+            for (std::size_t t = 0; t < kProbes; ++t) {
+                probe = mix64(probe + config.hashSeed + 0x9E3779B97F4A7C15ULL);
+                probes[k * kProbes + t] = static_cast<std::uint32_t>(((probe >> 32) * numHashes) >> 32);
+            }
+        }
+
+        // Band keys, band-major so each band task reads one contiguous column
+        std::vector<std::uint64_t> bandKeys(n * bands);
+        std::vector<std::uint32_t> setSize(n);
+        auto signBody = [&](std::size_t begin, std::size_t end) {
+            std::vector<std::uint32_t> minima(numHashes);
+            std::vector<std::uint8_t> filled(numHashes);
+            for (std::size_t i = begin; i < end; ++i) {
+                auto row = fingerprints.row(i);
+                std::fill(minima.begin(), minima.end(), ~0u);
+                std::fill(filled.begin(), filled.end(), 0);
+                std::uint32_t elements = 0;
+                for (std::size_t w = 0; w < row.size(); ++w) {
+                    for (std::uint64_t bits = row[w]; bits != 0; bits &= bits - 1) {
+                        const std::size_t element = w * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+                        const std::uint32_t bin = elementBin[element];
+                        minima[bin] = std::min(minima[bin], elementHash[element]);
+                        filled[bin] = 1;
+                        ++elements;
+                    }
+                }
+                setSize[i] = elements;
+                if (elements == 0)
+                    continue;
+                for (std::size_t k = 0; k < numHashes; ++k) {
+                    if (filled[k])
+                        continue;
+                    const std::uint32_t* sequence = probes.data() + k * kProbes;
+                    std::size_t t = 0;
+                    while (t < kProbes && !filled[sequence[t]])
+                        ++t;
+                    std::size_t from = t < kProbes ? sequence[t] : k;
+                    while (!filled[from])
+                        from = (from + 1) % numHashes;
+                    minima[k] = minima[from];
+                }
+                for (std::size_t b = 0; b < bands; ++b) {
+                    const std::uint32_t* band = minima.data() + b * rows;
+                    std::uint64_t bandKey = mix64(config.hashSeed ^ b);
+                    for (std::size_t r = 0; r < rows; r += 2) {
+                        const std::uint64_t high = r + 1 < rows ? band[r + 1] : 0;
+                        bandKey = mix64(bandKey ^ (high << 32 | band[r]));
+                    }
+                    bandKeys[b * n + i] = bandKey;
+                }
+            }
+        };
+        if (threadPool)
+            threadPool->parallelFor(n, UserPoolNS::UserPool::kChunkSize, signBody);
+        else
+            signBody(0, n);
+
+        // Candidate pairs, per band in parallel: wallets are grouped by band key in one pass over an
+        // open-addressing table, and each one is paired with the first and the latest earlier wallet of its
+        // group, so even a group holding a whole farm stays linear
+        using Pair = std::pair<std::uint32_t, std::uint32_t>;
+        constexpr std::uint32_t kEmpty = ~0u;
+        std::vector<std::vector<Pair>> pairsByBand(bands);
+        struct Slot {
+            std::uint64_t key;
+            std::uint32_t first;
+            std::uint32_t last;
+        };
+        const std::size_t numPresent = static_cast<std::size_t>(std::count_if(setSize.begin(), setSize.end(),
+                                                                               [](std::uint32_t size) { return size > 0; }));
+        auto bandBody = [&](std::size_t begin, std::size_t end) {
+            const std::size_t capacity = std::bit_ceil(std::max<std::size_t>(2 * numPresent, 16));
+            std::vector<Slot> slots(capacity);
+            for (std::size_t b = begin; b < end; ++b) {
+                DEX_TRACE_SCOPE("sybil.band");
+                const std::uint64_t* keys = bandKeys.data() + b * n;
+                std::fill(slots.begin(), slots.end(), Slot{ 0, kEmpty, kEmpty });
+                for (std::size_t i = 0; i < n; ++i) {
+                    if (setSize[i] == 0)
+                        continue;
+                    std::size_t index = static_cast<std::size_t>(keys[i]) & (capacity - 1);
+                    while (slots[index].first != kEmpty && slots[index].key != keys[i])
+                        index = (index + 1) & (capacity - 1);
+                    Slot& slot = slots[index];
+                    const auto user = static_cast<std::uint32_t>(i);
+                    if (slot.first == kEmpty) {
+                        slot = { keys[i], user, user };
+                        continue;
+                    }
+                    pairsByBand[b].emplace_back(slot.first, user);
+                    if (slot.last != slot.first)
+                        pairsByBand[b].emplace_back(slot.last, user);
+                    slot.last = user;
+                }
+            }
+        };
+        if (threadPool)
+            threadPool->parallelFor(bands, 1, bandBody);
+        else
+            bandBody(0, bands);
+
+        // A pair that collides in several bands is verified once
+        std::vector<Pair> pairs;
+        for (auto& bandPairs : pairsByBand) {
+            pairs.insert(pairs.end(), bandPairs.begin(), bandPairs.end());
+            std::vector<Pair>().swap(bandPairs);
+        }
+        std::sort(pairs.begin(), pairs.end());
+        pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+        std::vector<std::uint8_t> linked(pairs.size());
+        auto verifyBody = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t p = begin; p < end; ++p) {
+                auto [a, c] = pairs[p];
+                auto x = fingerprints.row(a);
+                auto y = fingerprints.row(c);
+                int common = 0;
+                for (std::size_t w = 0; w < x.size(); ++w)
+                    common += std::popcount(x[w] & y[w]);
+                linked[p] = static_cast<double>(common) >= config.minSimilarity * (setSize[a] + setSize[c] - common);
+            }
+        };
+        if (threadPool)
+            threadPool->parallelFor(pairs.size(), UserPoolNS::UserPool::kChunkSize, verifyBody);
+        else
+            verifyBody(0, pairs.size());
+
+        Clusters clusters;
+        clusters.candidatePairs = pairs.size();
+        DisjointSets sets(n);
+        for (std::size_t p = 0; p < pairs.size(); ++p) {
+            if (linked[p]) {
+                sets.unite(pairs[p].first, pairs[p].second);
+                ++clusters.linkedPairs;
+            }
+        }
+        clusters.clusterOf.resize(n);
+        std::vector<std::uint32_t> groupSize(n, 0);
+        for (std::size_t i = 0; i < n; ++i) {
+            clusters.clusterOf[i] = sets.find(static_cast<std::uint32_t>(i));
+            ++groupSize[clusters.clusterOf[i]];
+        }
+        const std::size_t minSize = std::max<std::size_t>(2, config.minClusterSize);
+        clusters.flagged.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            clusters.flagged[i] = groupSize[clusters.clusterOf[i]] >= minSize;
+            clusters.numFlagged += clusters.flagged[i];
+            clusters.numClusters += clusters.clusterOf[i] == i && groupSize[i] >= minSize;
+        }
+        return clusters;
+    }
+
+    CaptureReport capture(const UserPoolNS::UserPool& pool, const Clusters& clusters) {
+        CaptureReport report;
+        auto cohorts = pool.cohort();
+        auto rates = pool.interactionRate();
+        for (std::size_t i = 0; i < pool.size(); ++i) {
+            const bool sybil = cohorts[i] == Users::Cohort::Sybil;
+            report.sybils += sybil;
+            report.activeSybils += sybil && rates[i] > 0;
+            if (clusters.flagged[i])
+                ++(sybil ? report.flaggedSybils : report.flaggedRegular);
+        }
+        report.clusters = clusters.numClusters;
+        return report;
+    }
+
+    std::shared_ptr<const std::vector<std::uint8_t>> flagsById(const UserPoolNS::UserPool& pool, const Clusters& clusters) {
+        auto ids = pool.userIds();
+        const int maxId = ids.empty() ? -1 : *std::max_element(ids.begin(), ids.end());
+        auto flags = std::make_shared<std::vector<std::uint8_t>>(static_cast<std::size_t>(maxId + 1), 0);
+        for (std::size_t i = 0; i < ids.size(); ++i)
+            (*flags)[static_cast<std::size_t>(ids[i])] = clusters.flagged[i];
+        return flags;
+    }
+
+    double FilteredAirdropPolicy::calculateTokens(double airdropPoints, int user) const {
+        double tokens = inner_->calculateTokens(airdropPoints, user);
+        return isFlagged(user) ? multiplier_ * tokens : tokens;
+    }
+
+    void FilteredAirdropPolicy::calculateTokens(std::span<const double> airdropPoints, std::span<const int> users,
+                                                std::span<double> tokens) const {
+        inner_->calculateTokens(airdropPoints, users, tokens);
+        for (std::size_t i = 0; i < users.size(); ++i) {
+            if (isFlagged(users[i]))
+                tokens[i] *= multiplier_;
+        }
+    }
+
+} // namespace Sybil
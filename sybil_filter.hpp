@@ -0,0 +1,104 @@
+#ifndef SYBIL_FILTER_HPP
+#define SYBIL_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+#include "airdrop_policy.hpp"
+#include "thread_pool.hpp"
+#include "user_pool.hpp"
+
+namespace Sybil {
+
+    using UserPoolNS::kActionsPerStep;
+
+    struct FilterConfig {
+        // LSH banding over bands * rowsPerBand MinHash values; pairs above roughly
+        // (1 / bands)^(1 / rowsPerBand) Jaccard similarity become candidates. Long bands keep the many
+        // unrelated pairs of active wallets (similarity ~0.1 on the small action space) out of the buckets.
+        std::size_t bands = 20;
+        std::size_t rowsPerBand = 6;
+        // Candidates are linked only if the exact Jaccard similarity of their fingerprints reaches this
+        double minSimilarity = 0.5;
+        // Connected groups of at least this many wallets are flagged
+        std::size_t minClusterSize = 5;
+        // Applied to a flagged wallet's tokens at TGE (0 removes them from the airdrop)
+        double tokenMultiplier = 0.0;
+        std::uint64_t hashSeed = 0x5EB11C0FFEEULL;
+    };
+
+    // Bit-packed behaviour signatures: one bit per (step, action), steps packed two per 64-bit word,
+    // one row per pool position.
+    class Fingerprints {
+    public:
+        Fingerprints(std::size_t numUsers, std::size_t numSteps);
+        std::size_t size() const { return numUsers_; }
+        std::size_t numSteps() const { return numSteps_; }
+        std::size_t wordsPerUser() const { return words_; }
+        std::span<const std::uint64_t> row(std::size_t i) const { return { bits_.data() + i * words_, words_ }; }
+        std::span<std::uint64_t> row(std::size_t i) { return { bits_.data() + i * words_, words_ }; }
+    private:
+        std::size_t numUsers_;
+        std::size_t numSteps_;
+        std::size_t words_;
+        std::vector<std::uint64_t> bits_;
+    };
+
+    // Behaviour of every pool user over the PreTGE steps taken so far: the UserPool::stepActions the
+    // activity features were folded from, replayed step by step.
+    Fingerprints recordBehaviour(const UserPoolNS::UserPool& pool);
+
+    struct Clusters {
+        // Smallest pool position in each user's connected group (its own position if it has no match)
+        std::vector<std::uint32_t> clusterOf;
+        std::vector<std::uint8_t> flagged;
+        std::size_t numClusters = 0; // flagged groups
+        std::size_t numFlagged = 0;
+        std::size_t candidatePairs = 0;
+        std::size_t linkedPairs = 0;
+    };
+
+    // MinHash/LSH clustering: only wallets sharing a band bucket are compared (exact Jaccard on the
+    // fingerprints), so the cost grows with the number of wallets rather than the number of pairs. Bands
+    // are bucketed as tasks on `threadPool`; candidates are verified and merged in a fixed order, so the
+    // result does not depend on the thread count.
+    Clusters cluster(const Fingerprints& fingerprints, const FilterConfig& config, Scheduler::ThreadPool* threadPool = nullptr);
+
+    // How many of the pool's sybils (and how many regular wallets) a clustering flagged.
+    struct CaptureReport {
+        std::size_t sybils = 0;
+        std::size_t activeSybils = 0; // sybils that took any action, the ones a behaviour filter can see
+        std::size_t flaggedSybils = 0;
+        std::size_t flaggedRegular = 0;
+        std::size_t clusters = 0;
+        double recall() const { return sybils == 0 ? 0.0 : static_cast<double>(flaggedSybils) / static_cast<double>(sybils); }
+    };
+    CaptureReport capture(const UserPoolNS::UserPool& pool, const Clusters& clusters);
+
+    // Per-user-id flags of a clustering, for FilteredAirdropPolicy.
+    std::shared_ptr<const std::vector<std::uint8_t>> flagsById(const UserPoolNS::UserPool& pool, const Clusters& clusters);
+
+    // Scales the inner policy's tokens by `multiplier` for flagged user ids; everyone else gets exactly
+    // the inner policy's value.
+    class FilteredAirdropPolicy : public Airdrop::AirdropPolicy {
+    public:
+        FilteredAirdropPolicy(std::shared_ptr<Airdrop::AirdropPolicy> inner, std::shared_ptr<const std::vector<std::uint8_t>> flagged,
+                              double multiplier)
+            : inner_(std::move(inner)), flagged_(std::move(flagged)), multiplier_(multiplier) {}
+        double calculateTokens(double airdropPoints, int user) const override;
+        void calculateTokens(std::span<const double> airdropPoints, std::span<const int> users, std::span<double> tokens) const override;
+    private:
+        std::shared_ptr<Airdrop::AirdropPolicy> inner_;
+        std::shared_ptr<const std::vector<std::uint8_t>> flagged_;
+        double multiplier_;
+        bool isFlagged(int user) const {
+            return static_cast<std::size_t>(user) < flagged_->size() && (*flagged_)[static_cast<std::size_t>(user)];
+        }
+        alignas(64) char padding[64];
+    };
+
+} // namespace Sybil
+
+#endif // SYBIL_FILTER_HPP
@@ -0,0 +1,129 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+namespace Scheduler {
+
+    namespace {
+        thread_local const ThreadPool* tlsPool = nullptr;
+        thread_local std::size_t tlsIndex = 0;
+    }
+
+    ThreadPool::ThreadPool(std::size_t numThreads)
+        : pending_(0), nextQueue_(0), stop_(false) {
+        if (numThreads == 0)
+            numThreads = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t i = 0; i < numThreads; ++i)
+            queues_.push_back(std::make_unique<WorkQueue>());
+        threads_.reserve(numThreads);
+        for (std::size_t i = 0; i < numThreads; ++i)
+            threads_.emplace_back([this, i]() { workerLoop(i); });
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        threads_.clear(); // jthread joins
+    }
+
+    void ThreadPool::push(Task task) {
+        std::size_t target = (tlsPool == this) ? tlsIndex : nextQueue_.fetch_add(1) % queues_.size();
+        {
+            std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+            queues_[target]->tasks.push_back(std::move(task));
+        }
+        pending_.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+        }
+        wake_.notify_one();
+    }
+
+    bool ThreadPool::tryRunOne(std::size_t self) {
+        Task task;
+        {
+            WorkQueue& own = *queues_[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+            }
+        }
+        for (std::size_t k = 1; !task && k < queues_.size(); ++k) {
+            WorkQueue& victim = *queues_[(self + k) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+            }
+        }
+        if (!task)
+            return false;
+        pending_.fetch_sub(1);
+        task();
+        return true;
+    }
+
+    void ThreadPool::workerLoop(std::size_t index) {
+        tlsPool = this;
+        tlsIndex = index;
+        while (true) {
+            if (tryRunOne(index))
+                continue;
+            std::unique_lock<std::mutex> lock(sleepMutex_);
+            if (stop_ && pending_.load() == 0)
+                break;
+            wake_.wait(lock, [this]() { return stop_ || pending_.load() > 0; });
+        }
+    }
+
+    void ThreadPool::parallelFor(std::size_t n, std::size_t grain, const std::function<void(std::size_t, std::size_t)>& body) {
+        if (n == 0)
+            return;
+        grain = std::max<std::size_t>(grain, 1);
+        const std::size_t numChunks = (n + grain - 1) / grain;
+        if (numChunks == 1 || size() == 1) {
+            for (std::size_t begin = 0; begin < n; begin += grain)
+                body(begin, std::min(n, begin + grain));
+            return;
+        }
+
+        struct Shared {
+            std::atomic<std::size_t> nextChunk{ 0 };
+            std::atomic<std::size_t> doneChunks{ 0 };
+            std::mutex errorMutex;
+            std::exception_ptr error;
+        };
+        auto shared = std::make_shared<Shared>();
+        auto runChunks = [shared, &body, n, grain, numChunks]() {
+            std::size_t chunk;
+            while ((chunk = shared->nextChunk.fetch_add(1)) < numChunks) {
+                std::size_t begin = chunk * grain;
+                try {
+                    body(begin, std::min(n, begin + grain));
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(shared->errorMutex);
+                    if (!shared->error)
+                        shared->error = std::current_exception();
+                }
+                shared->doneChunks.fetch_add(1);
+            }
+        };
+
+        // Helpers that start after every chunk is claimed return immediately, so `body` is never
+        // touched once this call has returned.
+        std::size_t helpers = std::min(numChunks, size()) - 1;
+        for (std::size_t i = 0; i < helpers; ++i)
+            push(runChunks);
+        runChunks();
+        while (shared->doneChunks.load() < numChunks)
+            std::this_thread::yield();
+        if (shared->error)
+            std::rethrow_exception(shared->error);
+    }
+
+} // namespace Scheduler
@@ -0,0 +1,102 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <type_traits>
+#include <vector>
+#include "jthread.h"
+
+namespace Scheduler {
+
+    // Work-stealing thread pool. Each worker owns a deque: it pops its own tasks LIFO and steals
+    // from the front of the others' when idle. Tasks submitted from outside are spread round-robin.
+    class ThreadPool {
+    public:
+        // numThreads == 0 uses std::thread::hardware_concurrency().
+        explicit ThreadPool(std::size_t numThreads = 0);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        std::size_t size() const { return queues_.size(); }
+
+        template<typename F>
+        auto submit(F&& f) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+            using R = std::invoke_result_t<std::decay_t<F>>;
+            auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+            std::future<R> result = task->get_future();
+            push([task]() { (*task)(); });
+            return result;
+        }
+
+        // Runs body(begin, end) over [0, n) in fixed chunks of `grain`. Chunk boundaries depend only on
+        // n and grain, never on the thread count. The caller claims chunks alongside the workers and only
+        // returns once every chunk has finished; it never picks up unrelated tasks while waiting, so a
+        // combo task that fans out cannot end up running another combo on its stack.
+        void parallelFor(std::size_t n, std::size_t grain, const std::function<void(std::size_t, std::size_t)>& body);
+
+    private:
+        using Task = std::function<void()>;
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<WorkQueue>> queues_;
+        std::vector<clang_jthread::jthread> threads_;
+        std::atomic<std::size_t> pending_;
+        std::atomic<std::size_t> nextQueue_;
+        std::atomic<bool> stop_;
+        std::mutex sleepMutex_;
+        std::condition_variable wake_;
+
+        void push(Task task);
+        bool tryRunOne(std::size_t self);
+        void workerLoop(std::size_t index);
+        alignas(64) char padding[64];
+    };
+
+    // Combines partials as a balanced binary tree in index order, in place; the result is partials[0].
+    template<typename T, typename Combine>
+    T combineTree(std::span<T> partials, Combine&& combine) {
+        for (std::size_t width = 1; width < partials.size(); width *= 2) {
+            for (std::size_t i = 0; i + width < partials.size(); i += 2 * width)
+                partials[i] = combine(partials[i], partials[i + width]);
+        }
+        return partials[0];
+    }
+
+    // Deterministic reduction over [0, n): chunkFn(begin, end) reduces one fixed-size chunk, and the
+    // per-chunk partials are then combined as a balanced binary tree in chunk order. Neither the chunk
+    // boundaries nor the combine order depend on the thread count, so floating-point results are
+    // bit-identical with or without a pool and for any number of workers.
+    template<typename T, typename ChunkFn, typename Combine>
+    T parallelReduce(ThreadPool* pool, std::size_t n, std::size_t grain, T identity, ChunkFn&& chunkFn, Combine&& combine) {
+        if (n == 0)
+            return identity;
+        grain = grain == 0 ? 1 : grain;
+        const std::size_t numChunks = (n + grain - 1) / grain;
+        std::vector<T> partials(numChunks, identity);
+        auto body = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t chunkBegin = begin; chunkBegin < end; chunkBegin += grain)
+                partials[chunkBegin / grain] = chunkFn(chunkBegin, std::min(end, chunkBegin + grain));
+        };
+        if (pool)
+            pool->parallelFor(n, grain, body);
+        else
+            body(0, n);
+        return combineTree(std::span<T>(partials), combine);
+    }
+
+} // namespace Scheduler
+
+#endif // THREAD_POOL_HPP
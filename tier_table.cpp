@@ -0,0 +1,77 @@
+#include "tier_table.hpp"
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace Tiers {
+
+    namespace {
+        using FindAll = void (*)(const double*, std::size_t, std::span<const double>, std::span<std::uint32_t>);
+
+        template<Bound B, std::size_t N>
+        void countAll(const double* bounds, std::size_t /*size*/, std::span<const double> values, std::span<std::uint32_t> tiers) {
+            for (std::size_t i = 0; i < values.size(); ++i)
+                tiers[i] = static_cast<std::uint32_t>(detail::count<B, N>(bounds, values[i]));
+        }
+
+        // Every search over one table takes the same number of halving steps, so kLanes of them run in
+        // lockstep: their dependent loads overlap instead of each search waiting on its own chain.
+        constexpr std::size_t kLanes = 8;
+
+        template<Bound B>
+        void searchAll(const double* bounds, std::size_t size, std::span<const double> values, std::span<std::uint32_t> tiers) {
+            std::size_t i = 0;
+            for (; i + kLanes <= values.size(); i += kLanes) {
+                std::array<std::size_t, kLanes> base{};
+                for (std::size_t n = size; n > 1; n -= n / 2) {
+                    const std::size_t half = n / 2;
+                    for (std::size_t j = 0; j < kLanes; ++j)
+                        base[j] = detail::past<B>(values[i + j], bounds[base[j] + half]) ? base[j] + half : base[j];
+                }
+                for (std::size_t j = 0; j < kLanes; ++j)
+                    tiers[i + j] = static_cast<std::uint32_t>(base[j] + detail::past<B>(values[i + j], bounds[base[j]]));
+            }
+            for (; i < values.size(); ++i)
+                tiers[i] = static_cast<std::uint32_t>(detail::search<B>(bounds, size, values[i]));
+        }
+
+        template<Bound B, std::size_t... N>
+        constexpr std::array<FindAll, sizeof...(N)> countTable(std::index_sequence<N...>) {
+            return { &countAll<B, N>... };
+        }
+
+        template<Bound B>
+        FindAll findAllFor(std::size_t size) {
+            static constexpr auto kCount = countTable<B>(std::make_index_sequence<TierTable::kMaxUnrolled + 1>{});
+            return size <= TierTable::kMaxUnrolled ? kCount[size] : &searchAll<B>;
+        }
+    }
+
+    TierTable::TierTable(std::span<const double> thresholds, Bound bound) : bounds_(thresholds.size()), bound_(bound) {
+        // Running maximum: the first tier a value matches is the first whose running maximum it matches.
+        // For Below and AtMost a NaN threshold never matches, so it leaves the maximum alone (leading ones
+        // stay NaN, which nothing matches either); for Unreached it matches everything, so from the first
+        // NaN on the maximum stays NaN.
+        double running = std::numeric_limits<double>::quiet_NaN();
+        bool absorbed = false;
+        for (std::size_t k = 0; k < thresholds.size(); ++k) {
+            if (bound_ == Bound::Unreached && std::isnan(thresholds[k]))
+                absorbed = true;
+            if (!absorbed && (std::isnan(running) || thresholds[k] > running))
+                running = thresholds[k];
+            bounds_[k] = absorbed ? std::numeric_limits<double>::quiet_NaN() : running;
+        }
+    }
+
+    void TierTable::find(std::span<const double> values, std::span<std::uint32_t> tiers) const {
+        FindAll findAll = findAllFor<Bound::Unreached>(size());
+        switch (bound_) {
+            case Bound::Below: findAll = findAllFor<Bound::Below>(size()); break;
+            case Bound::AtMost: findAll = findAllFor<Bound::AtMost>(size()); break;
+            case Bound::Unreached: break;
+        }
+        findAll(bounds_.data(), size(), values, tiers);
+    }
+
+} // namespace Tiers
@@ -0,0 +1,113 @@
+#ifndef TIER_TABLE_HPP
+#define TIER_TABLE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Tiers {
+
+    // When a tier matches a value: value < threshold, value <= threshold, or !(value >= threshold) (the
+    // first threshold the value does not reach; unlike Below, NaN stops at the first tier).
+    enum class Bound : std::uint8_t { Below, AtMost, Unreached };
+
+    namespace detail {
+        // True once the value is past a tier, i.e. the tier does not match
+        template<Bound B>
+        inline bool past(double value, double bound) {
+            if constexpr (B == Bound::Below)
+                return !(value < bound);
+            else if constexpr (B == Bound::AtMost)
+                return !(value <= bound);
+            else
+                return value >= bound;
+        }
+
+        // Bounds are non-decreasing, so the tiers a value is past form a prefix and counting them gives the
+        // matching tier. Unrolled when N is a compile-time size.
+        template<Bound B, std::size_t N>
+        inline std::size_t count(const double* bounds, double value) {
+            std::size_t n = 0;
+            for (std::size_t k = 0; k < N; ++k)
+                n += past<B>(value, bounds[k]);
+            return n;
+        }
+
+        template<Bound B>
+        inline std::size_t count(const double* bounds, std::size_t size, double value) {
+            std::size_t n = 0;
+            for (std::size_t k = 0; k < size; ++k)
+                n += past<B>(value, bounds[k]);
+            return n;
+        }
+
+        // Binary search for the same prefix length; the halving step is a conditional move, not a branch.
+        template<Bound B>
+        inline std::size_t search(const double* bounds, std::size_t size, double value) {
+            if (size == 0)
+                return 0;
+            const double* base = bounds;
+            while (size > 1) {
+                std::size_t half = size / 2;
+                base = past<B>(value, base[half]) ? base + half : base;
+                size -= half;
+            }
+            return static_cast<std::size_t>(base - bounds) + past<B>(value, *base);
+        }
+    }
+
+    // Compiled tier thresholds shared by the tiered airdrop and PreTGE policies. find() returns the index
+    // of the tier a front-to-back scan of the thresholds would stop at (size() if none matches), in
+    // O(log tiers) without data-dependent branches. The thresholds are kept as their running maximum,
+    // which gives the scan's answer for any threshold order (NaN thresholds included); callers keep
+    // per-tier payloads (amounts, precomputed prefix contributions) in arrays indexed by the result.
+    class TierTable {
+    public:
+        // Tables up to this size are matched by counting comparisons, with one unrolled loop per size
+        static constexpr std::size_t kMaxUnrolled = 8;
+        // Tier indices found per block by forEachTier
+        static constexpr std::size_t kBlock = 256;
+
+        TierTable() = default;
+        TierTable(std::span<const double> thresholds, Bound bound);
+
+        std::size_t size() const { return bounds_.size(); }
+        Bound bound() const { return bound_; }
+
+        std::size_t find(double value) const {
+            switch (bound_) {
+                case Bound::Below: return find<Bound::Below>(value);
+                case Bound::AtMost: return find<Bound::AtMost>(value);
+                case Bound::Unreached: break;
+            }
+            return find<Bound::Unreached>(value);
+        }
+        // tiers[i] = find(values[i]); picks the specialization for this table once per call.
+        void find(std::span<const double> values, std::span<std::uint32_t> tiers) const;
+
+        // Calls body(i, tier) for every value, finding the tiers a block at a time.
+        template<typename Body>
+        void forEachTier(std::span<const double> values, Body&& body) const {
+            std::array<std::uint32_t, kBlock> tiers;
+            for (std::size_t begin = 0; begin < values.size(); begin += kBlock) {
+                std::size_t count = std::min(kBlock, values.size() - begin);
+                find(values.subspan(begin, count), std::span<std::uint32_t>(tiers).first(count));
+                for (std::size_t j = 0; j < count; ++j)
+                    body(begin + j, tiers[j]);
+            }
+        }
+    private:
+        std::vector<double> bounds_;
+        Bound bound_ = Bound::Below;
+        template<Bound B> std::size_t find(double value) const {
+            return size() <= kMaxUnrolled ? detail::count<B>(bounds_.data(), size(), value)
+                                          : detail::search<B>(bounds_.data(), size(), value);
+        }
+    };
+
+} // namespace Tiers
+
+#endif // TIER_TABLE_HPP
@@ -0,0 +1,159 @@
+#include "trace.hpp"
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace Trace {
+
+    namespace {
+        struct Event {
+            const char* name;
+            const char* argName;
+            std::int64_t arg;
+            std::uint64_t startNs;
+            std::uint64_t durNs;
+        };
+
+        struct CounterSample {
+            std::uint64_t timeNs;
+            std::array<std::uint64_t, kNumCounters> totals;
+        };
+
+        // Written only by its owning thread; counters are atomics so sampleCounters() can read them.
+        struct ThreadBuffer {
+            std::uint32_t tid;
+            std::vector<Event> events;
+            std::array<std::atomic<std::uint64_t>, kNumCounters> counters{};
+        };
+
+        struct Registry {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+            std::vector<CounterSample> samples;
+        };
+
+        Registry& registry() {
+            static Registry instance;
+            return instance;
+        }
+
+        std::atomic<bool> gEnabled{ false };
+        const auto gEpoch = std::chrono::steady_clock::now();
+
+        ThreadBuffer& localBuffer() {
+            thread_local ThreadBuffer* buffer = nullptr;
+            if (!buffer) {
+                auto& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                reg.buffers.push_back(std::make_unique<ThreadBuffer>());
+                buffer = reg.buffers.back().get();
+                buffer->tid = static_cast<std::uint32_t>(reg.buffers.size());
+                buffer->events.reserve(4096);
+            }
+            return *buffer;
+        }
+
+        void writeEscaped(std::ostream& out, const char* s) {
+            out << '"';
+            for (; *s; ++s) {
+                if (*s == '"' || *s == '\\')
+                    out << '\\';
+                out << *s;
+            }
+            out << '"';
+        }
+    }
+
+    void setEnabled(bool enabled) {
+        gEnabled.store(enabled && kCompiledIn, std::memory_order_relaxed);
+    }
+
+    bool enabled() {
+        return gEnabled.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t nowNs() {
+        // +1 keeps a timestamp of 0 free to mean "not recording" in Scope
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - gEpoch).count()) + 1;
+    }
+
+    void record(const char* name, std::uint64_t startNs, std::uint64_t endNs, const char* argName, std::int64_t arg) {
+        localBuffer().events.push_back({ name, argName, arg, startNs, endNs - startNs });
+    }
+
+    void add(Counter counter, std::uint64_t n) {
+        auto& slot = localBuffer().counters[static_cast<std::size_t>(counter)];
+        // Single writer: a plain load/store avoids a locked read-modify-write
+        slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::uint64_t counterTotal(Counter counter) {
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        std::uint64_t total = 0;
+        for (const auto& buffer : reg.buffers)
+            total += buffer->counters[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+        return total;
+    }
+
+    void sampleCounters() {
+        CounterSample sample{ nowNs(), {} };
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const auto& buffer : reg.buffers)
+            for (std::size_t c = 0; c < kNumCounters; ++c)
+                sample.totals[c] += buffer->counters[c].load(std::memory_order_relaxed);
+        reg.samples.push_back(sample);
+    }
+
+    void clear() {
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (auto& buffer : reg.buffers) {
+            buffer->events.clear();
+            for (auto& counter : buffer->counters)
+                counter.store(0, std::memory_order_relaxed);
+        }
+        reg.samples.clear();
+    }
+
+    void writeChromeTrace(const std::string& path) {
+        std::ofstream out(path);
+        if (!out)
+            throw std::runtime_error("Trace: cannot open " + path);
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        // Trace-event timestamps are microseconds
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        out << "{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"process_name\",\"args\":{\"name\":\"dex-simulation\"}}";
+        for (const auto& buffer : reg.buffers) {
+            out << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"name\":\"thread_name\",\"args\":{\"name\":\"thread " << buffer->tid << "\"}}";
+            for (const auto& e : buffer->events) {
+                out << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid << ",\"name\":";
+                writeEscaped(out, e.name);
+                out << ",\"ts\":" << e.startNs / 1e3 << ",\"dur\":" << e.durNs / 1e3;
+                if (e.argName) {
+                    out << ",\"args\":{";
+                    writeEscaped(out, e.argName);
+                    out << ":" << e.arg << "}";
+                }
+                out << "}";
+            }
+        }
+        // One track per counter; they have unrelated units
+        for (const auto& sample : reg.samples)
+            for (std::size_t c = 0; c < kNumCounters; ++c)
+                out << ",\n{\"ph\":\"C\",\"pid\":1,\"tid\":0,\"name\":\"" << kCounterNames[c] << "\",\"ts\":"
+                    << sample.timeNs / 1e3 << ",\"args\":{\"value\":" << sample.totals[c] << "}}";
+        out << "\n]}\n";
+    }
+
+} // namespace Trace
@@ -0,0 +1,83 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Trace {
+
+    // Low-overhead instrumentation. The DEX_TRACE_* macros expand to nothing unless the build defines
+    // DEX_ENABLE_TRACING (CMake option of the same name); when compiled in, recording is still off until
+    // setEnabled(true). Each thread appends to its own buffer, so recording never takes a lock.
+    // Names must be string literals (only the pointer is stored).
+
+    enum class Counter : std::uint8_t {
+        UsersProcessed,
+        RngBlocks,      // Philox blocks drawn by the pool phase kernels (4 x 32-bit words each)
+        AllocatedBytes, // large simulation buffers (columns, result vectors)
+        Count
+    };
+
+    inline constexpr std::size_t kNumCounters = static_cast<std::size_t>(Counter::Count);
+    inline constexpr const char* kCounterNames[kNumCounters] = { "users_processed", "rng_blocks", "allocated_bytes" };
+
+#ifdef DEX_ENABLE_TRACING
+    inline constexpr bool kCompiledIn = true;
+#else
+    inline constexpr bool kCompiledIn = false;
+#endif
+
+    void setEnabled(bool enabled);
+    bool enabled();
+    std::uint64_t nowNs();
+
+    // Records a complete event on the calling thread; argName may be null.
+    void record(const char* name, std::uint64_t startNs, std::uint64_t endNs, const char* argName, std::int64_t arg);
+    void add(Counter counter, std::uint64_t n);
+    // Emits the current process-wide counter totals as a counter event.
+    void sampleCounters();
+    std::uint64_t counterTotal(Counter counter);
+
+    // Chrome / Perfetto trace-event JSON for everything recorded so far. Call once the traced work has finished.
+    void writeChromeTrace(const std::string& path);
+    void clear();
+
+    class Scope {
+    public:
+        explicit Scope(const char* name, const char* argName = nullptr, std::int64_t arg = 0)
+            : name_(name), argName_(argName), arg_(arg), startNs_(enabled() ? nowNs() : 0) {}
+        ~Scope() {
+            if (startNs_)
+                record(name_, startNs_, nowNs(), argName_, arg_);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        const char* name_;
+        const char* argName_;
+        std::int64_t arg_;
+        std::uint64_t startNs_;
+    };
+
+} // namespace Trace
+
+#ifdef DEX_ENABLE_TRACING
+#define DEX_TRACE_CONCAT_(a, b) a##b
+#define DEX_TRACE_CONCAT(a, b) DEX_TRACE_CONCAT_(a, b)
+#define DEX_TRACE_SCOPE(name) ::Trace::Scope DEX_TRACE_CONCAT(dexTraceScope_, __LINE__)(name)
+#define DEX_TRACE_SCOPE_ARG(name, argName, arg) \
+    ::Trace::Scope DEX_TRACE_CONCAT(dexTraceScope_, __LINE__)(name, argName, static_cast<std::int64_t>(arg))
+#define DEX_TRACE_ADD(counter, n) \
+    do { if (::Trace::enabled()) ::Trace::add(::Trace::Counter::counter, static_cast<std::uint64_t>(n)); } while (0)
+#define DEX_TRACE_SAMPLE_COUNTERS() \
+    do { if (::Trace::enabled()) ::Trace::sampleCounters(); } while (0)
+#else
+#define DEX_TRACE_SCOPE(name) ((void)0)
+#define DEX_TRACE_SCOPE_ARG(name, argName, arg) ((void)0)
+#define DEX_TRACE_ADD(counter, n) ((void)0)
+#define DEX_TRACE_SAMPLE_COUNTERS() ((void)0)
+#endif
+
+#endif // TRACE_HPP
@@ -1,65 +1,395 @@
 #include "user_pool.hpp"
 #include "users.hpp"
-#include <random>
+#include "trace.hpp"
+#include "codec.hpp"
 #include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
 
 namespace UserPoolNS {
 
-    UserPool::UserPool(int numUsers, std::shared_ptr<Airdrop::AirdropPolicy> policy)
-        : numUsers_(numUsers), airdropPolicy_(policy) {
+    UserPool::UserPool(int numUsers, std::shared_ptr<Airdrop::AirdropPolicy> policy, const RNG::StreamKey& rngKey)
+        : numUsers_(numUsers), airdropPolicy_(policy), rngKey_(rngKey), stepCount_(0), threadPool_(nullptr) {
         generateUsers();
     }
 
+    UserPool::UserPool(std::shared_ptr<const PopulationNS::Population> population,
+                       std::shared_ptr<Airdrop::AirdropPolicy> policy, const RNG::StreamKey& rngKey)
+        : numUsers_(static_cast<int>(population->size())), airdropPolicy_(policy), rngKey_(rngKey), stepCount_(0),
+          threadPool_(nullptr) {
+        attach(std::move(population));
+    }
+
     void UserPool::generateUsers() {
-        double sybilPercentage = 0.3;
-        int numSybil = static_cast<int>(numUsers_ * sybilPercentage);
-        int numRegular = numUsers_ - numSybil;
-
-        double smallPercentage = 0.6;
-        double mediumPercentage = 0.3;
-        double largePercentage = 0.1;
-
-        int numSmall = static_cast<int>(numRegular * smallPercentage);
-        int numMedium = static_cast<int>(numRegular * mediumPercentage);
-        int numLarge = numRegular - numSmall - numMedium;
-
-        int userId = 0;
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        // Create wealth distributions using lognormal distributions
-        std::lognormal_distribution<double> distSmall(6, 1.5);
-        for (int i = 0; i < numSmall; ++i) {
-            double wealth = distSmall(gen);
-            users_.push_back(std::make_shared<Users::RegularUser>(wealth, userId++, "small", airdropPolicy_));
-        }
-        std::lognormal_distribution<double> distMedium(7, 1.2);
-        for (int i = 0; i < numMedium; ++i) {
-            double wealth = distMedium(gen);
-            users_.push_back(std::make_shared<Users::RegularUser>(wealth, userId++, "medium", airdropPolicy_));
+        attach(PopulationNS::Population::generate(numUsers_, rngKey_));
+    }
+
+    void UserPool::attach(std::shared_ptr<const PopulationNS::Population> population) {
+        population_ = std::move(population);
+        userIds_ = population_->userIds();
+        wealth_ = population_->wealth();
+        interactionRate_ = population_->interactionRate();
+        cohort_ = population_->cohort();
+        chunkTotals_.assign((size() + kChunkSize - 1) / kChunkSize, CohortTotals{});
+        forEachRange([this](std::size_t begin, std::size_t end) {
+            for (std::size_t chunkBegin = begin; chunkBegin < end; chunkBegin += kChunkSize) {
+                auto& users = chunkTotals_[chunkBegin / kChunkSize].users;
+                for (std::size_t i = chunkBegin; i < std::min(end, chunkBegin + kChunkSize); ++i)
+                    ++users[static_cast<std::size_t>(cohort_[i])];
+            }
+        });
+        resetState();
+    }
+
+    void UserPool::resetState() {
+        DEX_TRACE_ADD(AllocatedBytes, size() * (2 * sizeof(double) + sizeof(std::uint8_t) + sizeof(Activity::Accumulator)));
+        activity_ = Activity::ActivityColumns(size());
+        accumulators_.assign(size(), Activity::Accumulator{});
+        airdropPoints_.assign(size(), 0.0);
+        tokens_.assign(size(), 0.0);
+        active_.assign(size(), 1);
+        stepCount_ = 0;
+        for (CohortTotals& chunk : chunkTotals_)
+            chunk = { chunk.users, chunk.users, {}, {} };
+        foldTotals();
+    }
+
+    void UserPool::saveState(std::vector<std::byte>& out) const {
+        Codec::put(out, static_cast<std::uint64_t>(size()));
+        Codec::put(out, rngKey_.seed);
+        Codec::put(out, rngKey_.combo);
+        Codec::put(out, stepCount_);
+        Codec::putSpan(out, std::span<const double>(airdropPoints_));
+        Codec::putSpan(out, std::span<const double>(tokens_));
+        Codec::putSpan(out, std::span<const std::uint8_t>(active_));
+        Codec::putSpan(out, std::span<const CohortTotals>(chunkTotals_));
+        Activity::ActivityView activity = activity_.view();
+        for (std::size_t f = 0; f < Activity::kNumFeatures; ++f) {
+            auto feature = static_cast<Activity::Feature>(f);
+            Codec::put(out, static_cast<std::uint8_t>(activity.has(feature)));
+            if (activity.has(feature))
+                Codec::putSpan(out, activity.get(feature));
         }
-        std::lognormal_distribution<double> distLarge(8, 1.0);
-        for (int i = 0; i < numLarge; ++i) {
-            double wealth = distLarge(gen);
-            users_.push_back(std::make_shared<Users::RegularUser>(wealth, userId++, "large", airdropPolicy_));
+        Codec::putSpan(out, std::span<const Activity::Accumulator>(accumulators_));
+    }
+
+    void UserPool::restoreState(std::span<const std::byte>& in) {
+        auto numUsers = Codec::take<std::uint64_t>(in);
+        auto seed = Codec::take<std::uint64_t>(in);
+        auto combo = Codec::take<std::uint32_t>(in);
+        if (numUsers != size() || seed != rngKey_.seed || combo != rngKey_.combo)
+            throw std::runtime_error("UserPool: state image belongs to a different pool");
+        auto stepCount = Codec::take<std::uint32_t>(in);
+        auto points = Codec::takeVector<double>(in);
+        auto tokens = Codec::takeVector<double>(in);
+        auto active = Codec::takeVector<std::uint8_t>(in);
+        auto chunkTotals = Codec::takeVector<CohortTotals>(in);
+        if (points.size() != size() || tokens.size() != size() || active.size() != size() ||
+            chunkTotals.size() != chunkTotals_.size())
+            throw std::runtime_error("UserPool: state image has the wrong column lengths");
+        Activity::ActivityColumns activity(size());
+        for (std::size_t f = 0; f < Activity::kNumFeatures; ++f) {
+            if (Codec::take<std::uint8_t>(in) == 0)
+                continue;
+            auto values = Codec::takeVector<double>(in);
+            if (values.size() != size())
+                throw std::runtime_error("UserPool: state image has the wrong column lengths");
+            std::copy(values.begin(), values.end(), activity.column(static_cast<Activity::Feature>(f)).begin());
         }
-        std::lognormal_distribution<double> distSybil(5, 1.0);
-        for (int i = 0; i < numSybil; ++i) {
-            double wealth = distSybil(gen);
-            users_.push_back(std::make_shared<Users::SybilUser>(wealth, userId++, airdropPolicy_));
+        auto accumulators = Codec::takeVector<Activity::Accumulator>(in);
+        if (accumulators.size() != size())
+            throw std::runtime_error("UserPool: state image has the wrong column lengths");
+        stepCount_ = stepCount;
+        airdropPoints_ = std::move(points);
+        tokens_ = std::move(tokens);
+        active_ = std::move(active);
+        chunkTotals_ = std::move(chunkTotals);
+        activity_ = std::move(activity);
+        accumulators_ = std::move(accumulators);
+        foldTotals();
+    }
+
+    CohortTotals operator+(const CohortTotals& a, const CohortTotals& b) {
+        CohortTotals sum;
+        for (std::size_t c = 0; c < Users::kNumCohorts; ++c) {
+            sum.users[c] = a.users[c] + b.users[c];
+            sum.active[c] = a.active[c] + b.active[c];
+            sum.points[c] = a.points[c] + b.points[c];
+            sum.tokens[c] = a.tokens[c] + b.tokens[c];
         }
-        shuffleUsers();
+        return sum;
     }
 
-    void UserPool::shuffleUsers() {
-        std::random_device rd;
-        std::mt19937 g(rd());
-        std::shuffle(users_.begin(), users_.end(), g);
+    void UserPool::foldTotals() {
+        if (chunkTotals_.empty()) {
+            totals_ = {};
+            return;
+        }
+        std::vector<CohortTotals> partials = chunkTotals_;
+        totals_ = Scheduler::combineTree(std::span<CohortTotals>(partials),
+                                         [](const CohortTotals& a, const CohortTotals& b) { return a + b; });
     }
 
     void UserPool::stepAll(const std::string& phase) {
-        for (auto& user : users_) {
-            user->step(phase);
+        if (auto p = Users::phaseFromName(phase)) {
+            switch (*p) {
+                case Users::Phase::PreTGE: stepAll<Users::Phase::PreTGE>(); break;
+                case Users::Phase::TGE: stepAll<Users::Phase::TGE>(); break;
+                case Users::Phase::PostTGE: stepAll<Users::Phase::PostTGE>(); break;
+            }
+        }
+    }
+
+    template<Users::Phase P>
+    void UserPool::stepAll() {
+        std::uint32_t step = stepCount_++;
+        forEachRange([&](std::size_t begin, std::size_t end) { stepRange<P>(step, begin, end); });
+        foldTotals();
+    }
+
+    template void UserPool::stepAll<Users::Phase::PreTGE>();
+    template void UserPool::stepAll<Users::Phase::TGE>();
+    template void UserPool::stepAll<Users::Phase::PostTGE>();
+
+    namespace {
+        // Cohort-indexed lookup tables so the kernels select per-user parameters without branching
+        template<typename Field>
+        constexpr std::array<double, Users::kNumCohorts> cohortTable(Field field) {
+            std::array<double, Users::kNumCohorts> table{};
+            for (std::size_t c = 0; c < Users::kNumCohorts; ++c)
+                table[c] = Users::kCohortParams[c].*field;
+            return table;
+        }
+        constexpr auto kDeltaLo = cohortTable(&Users::CohortParams::preTGEDeltaLo);
+        constexpr auto kDeltaHi = cohortTable(&Users::CohortParams::preTGEDeltaHi);
+        constexpr auto kActiveProb = cohortTable(&Users::CohortParams::postTGEActiveProb);
+
+        // PreTGE trading model. Whether and where a user trades comes from stepActions; points accrue every
+        // step regardless, and a trading step's volume is its points at kVolumePerPoint. The word after the points
+        // draw is split into the 16-bit trade and win draws; the actions continue the same stream, so most
+        // users need a single Philox block per step.
+        constexpr double kVolumePerPoint = 100.0;
+        // 16-bit thresholds of the trade probability 1 - exp(-rate), by rate capped at kActionsPerStep
+        const std::array<std::uint32_t, kActionsPerStep + 1> kTradeThreshold = [] {
+            std::array<std::uint32_t, kActionsPerStep + 1> table{};
+            for (std::size_t rate = 0; rate < table.size(); ++rate)
+                table[rate] = static_cast<std::uint32_t>((1.0 - std::exp(-static_cast<double>(rate))) * 65536.0);
+            return table;
+        }();
+        // Farm scripts draw from user slots no wallet id reaches
+        constexpr std::uint32_t kFarmStreams = 0x80000000u;
+        constexpr auto kWinThreshold = [] {
+            std::array<std::uint32_t, Users::kNumCohorts> table{};
+            for (std::size_t c = 0; c < Users::kNumCohorts; ++c)
+                table[c] = static_cast<std::uint32_t>(Users::kCohortParams[c].preTGEWinProb * 65536.0);
+            return table;
+        }();
+        const double kTrailingDecay = std::exp(-1.0 / Activity::kTrailingWindow);
+
+        // Five-bit action indices, six to a word, until `count` distinct ones are drawn
+        std::uint32_t distinctActions(RNG::Stream& rng, std::size_t count) {
+            std::uint32_t mask = 0;
+            std::uint32_t word = 0;
+            int left = 0;
+            for (std::size_t distinct = 0; distinct < count;) {
+                if (left == 0) {
+                    word = rng.nextU32();
+                    left = 6;
+                }
+                const std::uint32_t bit = 1u << (word & 31u);
+                distinct += (mask & bit) == 0;
+                mask |= bit;
+                word >>= 5;
+                --left;
+            }
+            return mask;
+        }
+
+        std::array<double, Users::kNumCohorts> addSums(const std::array<double, Users::kNumCohorts>& a,
+                                                       const std::array<double, Users::kNumCohorts>& b) {
+            std::array<double, Users::kNumCohorts> sums;
+            for (std::size_t c = 0; c < Users::kNumCohorts; ++c)
+                sums[c] = a[c] + b[c];
+            return sums;
+        }
+    }
+
+    std::uint32_t UserPool::stepActions(std::size_t i, std::uint32_t step) const {
+        if (interactionRate_[i] <= 0)
+            return 0;
+        RNG::Stream rng(rngKey_, static_cast<std::uint32_t>(userIds_[i]), step, RNG::Domain::PreTGE);
+        rng.nextU64(); // the points draw
+        const std::uint32_t tradeWord = rng.nextU32();
+        return drawActions(i, step, tradeWord, rng);
+    }
+
+    std::uint32_t UserPool::drawActions(std::size_t i, std::uint32_t step, std::uint32_t tradeWord, RNG::Stream& rng) const {
+        const std::size_t actions = std::min<std::size_t>(std::max(interactionRate_[i], 0), kActionsPerStep);
+        if (actions == 0)
+            return 0;
+        const auto id = static_cast<std::uint32_t>(userIds_[i]);
+        if (cohort_[i] != Users::Cohort::Sybil)
+            return (tradeWord >> 16) < kTradeThreshold[actions] ? distinctActions(rng, actions) : 0u;
+        // The whole farm trades off one script draw, then replays the script's first `actions` distinct actions;
+        // each word of the user's own stream may swap one for its low five bits
+        const std::uint32_t farmSize = static_cast<std::uint32_t>(std::max<std::size_t>(1, behaviour_.farmSize));
+        RNG::Stream script(rngKey_, kFarmStreams | (id / farmSize), step, RNG::Domain::Behaviour);
+        if ((script.nextU32() >> 16) >= kTradeThreshold[actions])
+            return 0;
+        const auto swapBelow = static_cast<std::uint32_t>(std::clamp(behaviour_.scriptNoise, 0.0, 1.0) * 0x1.0p27);
+        std::uint32_t scripted = 0;
+        std::uint32_t mask = 0;
+        for (std::size_t distinct = 0; distinct < actions;) {
+            std::uint32_t action = script.below(kActionsPerStep);
+            if (scripted & (1u << action))
+                continue;
+            scripted |= 1u << action;
+            ++distinct;
+            const std::uint32_t word = rng.nextU32();
+            if ((word >> 5) < swapBelow)
+                action = word & 31u;
+            mask |= 1u << action;
+        }
+        return mask;
+    }
+
+    template<Users::Phase P>
+    void UserPool::stepRange(std::uint32_t step, std::size_t begin, std::size_t end) {
+        DEX_TRACE_SCOPE_ARG(P == Users::Phase::PreTGE ? "pool.preTGE" : P == Users::Phase::TGE ? "pool.tge" : "pool.postTGE",
+                            "combo", rngKey_.combo);
+        DEX_TRACE_ADD(UsersProcessed, end - begin);
+        // forEachRange hands out whole chunks, so each kernel owns the chunkTotals_ entries it refreshes
+        std::uint64_t rngBlocks = 0;
+        if constexpr (P == Users::Phase::TGE) {
+            std::size_t count = end - begin;
+            airdropPolicy_->calculateTokens(std::span<const double>(airdropPoints_).subspan(begin, count),
+                                            userIds_.subspan(begin, count),
+                                            std::span<double>(tokens_).subspan(begin, count));
+        }
+        for (std::size_t chunkBegin = begin; chunkBegin < end; chunkBegin += kChunkSize) {
+            const std::size_t chunkEnd = std::min(end, chunkBegin + kChunkSize);
+            CohortTotals& totals = chunkTotals_[chunkBegin / kChunkSize];
+            if constexpr (P == Users::Phase::PreTGE) {
+                totals.points = {};
+                Activity::Accumulator* accumulators = accumulators_.data();
+                const double decay = kTrailingDecay;
+                for (std::size_t i = chunkBegin; i < chunkEnd; ++i) {
+                    std::size_t c = static_cast<std::size_t>(cohort_[i]);
+                    RNG::Stream rng(rngKey_, static_cast<std::uint32_t>(userIds_[i]), step, RNG::Domain::PreTGE);
+                    const double delta = interactionRate_[i] * rng.uniform(kDeltaLo[c], kDeltaHi[c]);
+                    const std::uint32_t draw = rng.nextU32();
+                    const bool won = (draw & 0xFFFFu) < kWinThreshold[c];
+                    const std::uint32_t actions = drawActions(i, step, draw, rng);
+                    const bool traded = actions != 0;
+                    airdropPoints_[i] += delta;
+                    totals.points[c] += airdropPoints_[i];
+                    accumulators[i].record(traded, delta * kVolumePerPoint, won, actions, decay);
+                    if constexpr (Trace::kCompiledIn)
+                        rngBlocks += rng.blocksUsed();
+                }
+            } else if constexpr (P == Users::Phase::TGE) {
+                totals.tokens = {};
+                for (std::size_t i = chunkBegin; i < chunkEnd; ++i)
+                    totals.tokens[static_cast<std::size_t>(cohort_[i])] += tokens_[i];
+            } else {
+                totals.active = {};
+                for (std::size_t i = chunkBegin; i < chunkEnd; ++i) {
+                    std::size_t c = static_cast<std::size_t>(cohort_[i]);
+                    RNG::Stream rng(rngKey_, static_cast<std::uint32_t>(userIds_[i]), step, RNG::Domain::PostTGE);
+                    active_[i] = rng.uniform() < kActiveProb[c];
+                    totals.active[c] += active_[i];
+                    if constexpr (Trace::kCompiledIn)
+                        rngBlocks += rng.blocksUsed();
+                }
+            }
+        }
+        DEX_TRACE_ADD(RngBlocks, rngBlocks);
+    }
+
+    void UserPool::publishActivity() {
+        DEX_TRACE_SCOPE_ARG("pool.publishActivity", "combo", rngKey_.combo);
+        // Allocate up front so the ranges below only write
+        for (Activity::Feature feature : Activity::kAccumulatedFeatures)
+            activity_.column(feature);
+        forEachRange([this](std::size_t begin, std::size_t end) { activity_.publish(accumulators_, begin, end); });
+    }
+
+    std::vector<std::array<double, Users::kNumCohorts>> UserPool::evaluatePolicies(
+        std::span<const std::shared_ptr<Airdrop::AirdropPolicy>> policies,
+        std::span<const std::span<double>> tokenColumns) const {
+        using Sums = std::array<double, Users::kNumCohorts>;
+        const std::size_t numChunks = (size() + kChunkSize - 1) / kChunkSize;
+        std::vector<std::vector<Sums>> partials(policies.size(), std::vector<Sums>(numChunks));
+        // Policies are the inner loop so each chunk of points is read from cache by all of them
+        forEachRange([&](std::size_t begin, std::size_t end) {
+            DEX_TRACE_SCOPE_ARG("pool.tgeFanOut", "combo", rngKey_.combo);
+            DEX_TRACE_ADD(UsersProcessed, end - begin);
+            std::size_t count = end - begin;
+            auto points = std::span<const double>(airdropPoints_).subspan(begin, count);
+            auto ids = userIds_.subspan(begin, count);
+            for (std::size_t p = 0; p < policies.size(); ++p) {
+                policies[p]->calculateTokens(points, ids, tokenColumns[p].subspan(begin, count));
+                for (std::size_t chunkBegin = begin; chunkBegin < end; chunkBegin += kChunkSize) {
+                    Sums& sums = partials[p][chunkBegin / kChunkSize];
+                    for (std::size_t i = chunkBegin; i < std::min(end, chunkBegin + kChunkSize); ++i)
+                        sums[static_cast<std::size_t>(cohort_[i])] += tokenColumns[p][i];
+                }
+            }
+        });
+        std::vector<Sums> result(policies.size(), Sums{});
+        for (std::size_t p = 0; p < policies.size(); ++p) {
+            if (numChunks > 0)
+                result[p] = Scheduler::combineTree(std::span<Sums>(partials[p]), addSums);
+        }
+        return result;
+    }
+
+    double UserPool::totalTokens() const {
+        double total = 0.0;
+        for (double tokens : totals_.tokens)
+            total += tokens;
+        return total;
+    }
+
+    std::size_t UserPool::activeUsers() const {
+        std::size_t active = 0;
+        for (std::size_t count : totals_.active)
+            active += count;
+        return active;
+    }
+
+    double UserPool::totalTokens(std::span<const double> tokens) const {
+        return Scheduler::parallelReduce(threadPool_, size(), kChunkSize, 0.0,
+            [tokens](std::size_t begin, std::size_t end) {
+                double sum = 0.0;
+                for (std::size_t i = begin; i < end; ++i)
+                    sum += tokens[i];
+                return sum;
+            },
+            [](double a, double b) { return a + b; });
+    }
+
+    std::array<double, Users::kNumCohorts> UserPool::tokensByCohort(std::span<const double> tokens) const {
+        using Sums = std::array<double, Users::kNumCohorts>;
+        return Scheduler::parallelReduce(threadPool_, size(), kChunkSize, Sums{},
+            [this, tokens](std::size_t begin, std::size_t end) {
+                Sums sums{};
+                for (std::size_t i = begin; i < end; ++i)
+                    sums[static_cast<std::size_t>(cohort_[i])] += tokens[i];
+                return sums;
+            },
+            addSums);
+    }
+
+    double averageSellWeight(const CohortTotals& totals) {
+        std::size_t users = 0;
+        double sumWeights = 0.0;
+        for (std::size_t c = 0; c < Users::kNumCohorts; ++c) {
+            users += totals.users[c];
+            sumWeights += static_cast<double>(totals.users[c]) * Users::kCohortParams[c].sellWeight;
         }
+        return users == 0 ? 0.0 : sumWeights / static_cast<double>(users);
     }
 
 } // namespace UserPoolNS
@@ -2,22 +2,176 @@
 #define USER_POOL_HPP
 
 #include <vector>
+#include <array>
 #include <memory>
+#include <span>
+#include <string>
+#include <cstdint>
 #include "users.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+#include "activity.hpp"
+#include "population.hpp"
 
 namespace UserPoolNS {
 
+    // Per-cohort aggregates of the pool state, indexed by Users::Cohort.
+    struct CohortTotals {
+        std::array<std::size_t, Users::kNumCohorts> users{};
+        std::array<std::size_t, Users::kNumCohorts> active{};
+        std::array<double, Users::kNumCohorts> points{};
+        std::array<double, Users::kNumCohorts> tokens{};
+    };
+    CohortTotals operator+(const CohortTotals& a, const CohortTotals& b);
+    // Mean per-user sell weight implied by the cohort membership counts.
+    double averageSellWeight(const CohortTotals& totals);
+
+    // Distinct actions (markets, contracts) a wallet can touch in one PreTGE step.
+    inline constexpr std::size_t kActionsPerStep = Activity::Accumulator::kNumMarkets;
+
+    // How PreTGE actions are drawn. Regular wallets trade in a step with probability 1 - exp(-interactionRate)
+    // and then pick interactionRate distinct actions on their own; sybil wallets are run in farms of farmSize
+    // consecutive ids that trade in the farm's steps and replay its per-step script, each action swapped for a
+    // random one with probability scriptNoise.
+    struct BehaviourModel {
+        std::size_t farmSize = 64;
+        double scriptNoise = 0.1;
+    };
+
+    // Columnar (structure-of-arrays) user pool: one contiguous array per attribute, indexed by pool position.
+    // Phase kernels sweep whole columns; UserView gives the old per-user accessors without owning any state.
     class UserPool {
     public:
-        UserPool(int numUsers, std::shared_ptr<Airdrop::AirdropPolicy> policy = std::make_shared<Airdrop::AirdropPolicy>());
+        class UserView {
+        public:
+            UserView(const UserPool* pool, std::size_t index) : pool_(pool), index_(index) {}
+            double getWealth() const { return pool_->wealth_[index_]; }
+            double getAirdropPoints() const { return pool_->airdropPoints_[index_]; }
+            double getTokens() const { return pool_->tokens_[index_]; }
+            bool isActive() const { return pool_->active_[index_] != 0; }
+            int getUserId() const { return pool_->userIds_[index_]; }
+            int getInteractionRate() const { return pool_->interactionRate_[index_]; }
+            Users::Cohort getCohort() const { return pool_->cohort_[index_]; }
+            bool isSybil() const { return getCohort() == Users::Cohort::Sybil; }
+            std::string getUserSize() const { return Users::cohortParams(getCohort()).name; }
+        private:
+            const UserPool* pool_;
+            std::size_t index_;
+        };
+
+        // Users per kernel subtask and per reduction partial: large enough to amortize scheduling,
+        // small enough that a chunk's columns stay in L2 while a kernel runs over it.
+        static constexpr std::size_t kChunkSize = 8192;
+
+        UserPool(int numUsers, std::shared_ptr<Airdrop::AirdropPolicy> policy = std::make_shared<Airdrop::AirdropPolicy>(),
+                 const RNG::StreamKey& rngKey = {});
+        // Shares an existing population read-only; only the mutable state columns are allocated here.
+        UserPool(std::shared_ptr<const PopulationNS::Population> population,
+                 std::shared_ptr<Airdrop::AirdropPolicy> policy = std::make_shared<Airdrop::AirdropPolicy>(),
+                 const RNG::StreamKey& rngKey = {});
+        // Replaces the population with a freshly generated private one and resets all state.
         void generateUsers();
+        // Zeroes points, tokens, activity and accumulators and marks every user active.
+        void resetState();
+        // Binary image of the mutable state: points, tokens, activity and its accumulators, cohort index and
+        // the step counter, which is the position of every user's RNG streams. The population itself is not included;
+        // restoreState throws std::runtime_error if the image belongs to a pool of another size or key.
+        void saveState(std::vector<std::byte>& out) const;
+        void restoreState(std::span<const std::byte>& in);
+        std::uint32_t stepCount() const { return stepCount_; }
+        // Each phase compiles to its own specialized kernel loop; explicitly instantiated in user_pool.cpp.
+        template<Users::Phase P> void stepAll();
+        // String form kept for compatibility; resolves the phase once per call, not per user.
         void stepAll(const std::string& phase);
-        std::vector<std::shared_ptr<Users::User>> getUsers() const { return users_; }
+        // Optional: split phase kernels into user-range subtasks on this pool (not owned).
+        void setThreadPool(Scheduler::ThreadPool* threadPool) { threadPool_ = threadPool; }
+        Scheduler::ThreadPool* threadPool() const { return threadPool_; }
+        // Used by the TGE kernel; fan-out evaluation takes its policies as arguments instead.
+        void setAirdropPolicy(std::shared_ptr<Airdrop::AirdropPolicy> policy) { airdropPolicy_ = std::move(policy); }
+        void setBehaviourModel(const BehaviourModel& model) { behaviour_ = model; }
+        const BehaviourModel& behaviourModel() const { return behaviour_; }
+        // Bitset of the actions user i takes in PreTGE step `step`, 0 if it does not trade then. A pure function
+        // of the key, the user id and the step: the activity features and the sybil filter's fingerprints
+        // both read it, so they describe the same trades.
+        std::uint32_t stepActions(std::size_t i, std::uint32_t step) const;
+
+        std::size_t size() const { return userIds_.size(); }
+        const RNG::StreamKey& rngKey() const { return rngKey_; }
+        const std::shared_ptr<const PopulationNS::Population>& population() const { return population_; }
+        UserView user(std::size_t index) const { return UserView(this, index); }
+
+        std::span<const int> userIds() const { return userIds_; }
+        std::span<const double> wealth() const { return wealth_; }
+        std::span<const double> airdropPoints() const { return airdropPoints_; }
+        std::span<const double> tokens() const { return tokens_; }
+        std::span<const std::uint8_t> active() const { return active_; }
+        std::span<const int> interactionRate() const { return interactionRate_; }
+        std::span<const Users::Cohort> cohort() const { return cohort_; }
+
+        // Per-user activity features (one column per Activity::Feature) consumed by PreTGE reward policies.
+        Activity::ActivityColumns& activity() { return activity_; }
+        const Activity::ActivityColumns& activity() const { return activity_; }
+        // Running PreTGE activity summaries, folded in by every PreTGE step.
+        std::span<const Activity::Accumulator> accumulators() const { return accumulators_; }
+        // Derives the accumulated activity features from the accumulators, O(1) per user.
+        void publishActivity();
+
+        // Runs kernel(begin, end) over all users, split into kChunkSize subtasks when a thread pool is set.
+        template<typename Kernel>
+        void forEachRange(Kernel&& kernel) const {
+            if (threadPool_)
+                threadPool_->parallelFor(size(), kChunkSize, kernel);
+            else
+                kernel(std::size_t{ 0 }, size());
+        }
+
+        // Fan-out TGE: evaluates every policy against the current airdropPoints in one sweep, writing
+        // policy p's allocation to tokenColumns[p] (each sized size()) and returning its per-cohort token
+        // sums, accumulated in the same sweep. The pool's own tokens are untouched.
+        std::vector<std::array<double, Users::kNumCohorts>> evaluatePolicies(
+            std::span<const std::shared_ptr<Airdrop::AirdropPolicy>> policies,
+            std::span<const std::span<double>> tokenColumns) const;
+
+        // Cohort index: the phase kernels refresh per-chunk totals for the chunks they touch and stepAll
+        // folds them with Scheduler::combineTree, so the queries below are O(cohorts) and identical for
+        // any thread count.
+        const CohortTotals& cohortTotals() const { return totals_; }
+        double totalTokens() const;
+        std::array<double, Users::kNumCohorts> tokensByCohort() const { return totals_.tokens; }
+        std::size_t activeUsers() const;
+        double averageSellWeight() const { return UserPoolNS::averageSellWeight(totals_); }
+        // Full scans for a column the index does not track (e.g. a fan-out token column).
+        double totalTokens(std::span<const double> tokens) const;
+        std::array<double, Users::kNumCohorts> tokensByCohort(std::span<const double> tokens) const;
     private:
         int numUsers_;
         std::shared_ptr<Airdrop::AirdropPolicy> airdropPolicy_;
-        std::vector<std::shared_ptr<Users::User>> users_;
-        void shuffleUsers();
+        RNG::StreamKey rngKey_;
+        std::uint32_t stepCount_;
+        Scheduler::ThreadPool* threadPool_;
+        BehaviourModel behaviour_;
+
+        // Immutable population columns (views into population_)
+        std::shared_ptr<const PopulationNS::Population> population_;
+        std::span<const int> userIds_;
+        std::span<const double> wealth_;
+        std::span<const int> interactionRate_;
+        std::span<const Users::Cohort> cohort_;
+        // Mutable state columns
+        std::vector<double> airdropPoints_;
+        std::vector<double> tokens_;
+        std::vector<std::uint8_t> active_;
+        Activity::ActivityColumns activity_;
+        std::vector<Activity::Accumulator> accumulators_;
+        // Cohort index: one entry per kChunkSize users, plus their fold
+        std::vector<CohortTotals> chunkTotals_;
+        CohortTotals totals_;
+
+        void attach(std::shared_ptr<const PopulationNS::Population> population);
+        template<Users::Phase P> void stepRange(std::uint32_t step, std::size_t begin, std::size_t end);
+        // stepActions from the user's PreTGE stream, positioned after the trade word that follows its points draw
+        std::uint32_t drawActions(std::size_t i, std::uint32_t step, std::uint32_t tradeWord, RNG::Stream& rng) const;
+        void foldTotals();
         alignas(64) char padding[64];
     };
 
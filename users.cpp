@@ -1,66 +1,94 @@
 #include "users.hpp"
-#include <random>
 
 namespace Users {
 
-    User::User(double wealth, int userId, AirdropPolicyPtr policy)
-        : wealth_(wealth), userId_(userId), airdropPoints_(0.0), tokens_(0.0), active_(true), airdropPolicy_(policy) {}
+    std::optional<Phase> phaseFromName(const std::string& name) {
+        if (name == "PreTGE") return Phase::PreTGE;
+        if (name == "TGE") return Phase::TGE;
+        if (name == "PostTGE") return Phase::PostTGE;
+        return std::nullopt;
+    }
+
+    const char* phaseName(Phase phase) {
+        switch (phase) {
+            case Phase::PreTGE: return "PreTGE";
+            case Phase::TGE: return "TGE";
+            default: return "PostTGE";
+        }
+    }
+
+    std::optional<Cohort> cohortFromName(const std::string& name) {
+        for (std::size_t c = 0; c < kNumCohorts; ++c) {
+            if (name == kCohortParams[c].name)
+                return static_cast<Cohort>(c);
+        }
+        return std::nullopt;
+    }
+
+    User::User(double wealth, int userId, AirdropPolicyPtr policy, const RNG::StreamKey& rngKey)
+        : userId_(userId), wealth_(wealth), airdropPoints_(0.0), tokens_(0.0), active_(true), airdropPolicy_(policy),
+          rngKey_(rngKey), stepCount_(0) {}
 
-    RegularUser::RegularUser(double wealth, int userId, const std::string& userSize, AirdropPolicyPtr policy)
-        : User(wealth, userId, policy), userSize_(userSize) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        if (userSize == "small") {
-            std::poisson_distribution<int> d(1);
-            interactionRate_ = d(gen);
-        } else if (userSize == "medium") {
-            std::poisson_distribution<int> d(3);
-            interactionRate_ = d(gen);
-        } else if (userSize == "large") {
-            std::poisson_distribution<int> d(5);
-            interactionRate_ = d(gen);
+    RegularUser::RegularUser(double wealth, int userId, const std::string& userSize, AirdropPolicyPtr policy,
+                             const RNG::StreamKey& rngKey)
+        : User(wealth, userId, policy, rngKey), userSize_(userSize) {
+        // Resolve the size string once; unknown sizes keep the old defaults (rate 1, 50% retention)
+        RNG::Stream rng(rngKey_, static_cast<std::uint32_t>(userId_), 0, RNG::Domain::UserInit);
+        auto cohort = cohortFromName(userSize);
+        if (cohort && *cohort != Cohort::Sybil) {
+            const CohortParams& params = cohortParams(*cohort);
+            interactionRate_ = rng.poisson(params.interactionMean);
+            preTGEDeltaLo_ = params.preTGEDeltaLo;
+            preTGEDeltaHi_ = params.preTGEDeltaHi;
+            postTGEActiveProb_ = params.postTGEActiveProb;
         } else {
             interactionRate_ = 1;
+            preTGEDeltaLo_ = 0.5;
+            preTGEDeltaHi_ = 1.5;
+            postTGEActiveProb_ = 0.5;
         }
     }
 
-    void RegularUser::step(const std::string& phase) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<double> dist(0.5, 1.5);
-        if (phase == "PreTGE") {
-            double delta = interactionRate_ * dist(gen);
-            airdropPoints_ += delta;
-        } else if (phase == "TGE") {
-            tokens_ = airdropPolicy_->calculateTokens(airdropPoints_, userId_);
-        } else if (phase == "PostTGE") {
-            double prob = (userSize_ == "small") ? 0.4 :
-                          (userSize_ == "medium") ? 0.8 :
-                          (userSize_ == "large") ? 0.9 : 0.5;
-            std::uniform_real_distribution<double> probDist(0.0, 1.0);
-            active_ = (probDist(gen) < prob);
+    void RegularUser::step(Phase phase) {
+        std::uint32_t stepIndex = stepCount_++;
+        switch (phase) {
+            case Phase::PreTGE: {
+                RNG::Stream rng = streamFor(stepIndex, RNG::Domain::PreTGE);
+                airdropPoints_ += interactionRate_ * rng.uniform(preTGEDeltaLo_, preTGEDeltaHi_);
+                break;
+            }
+            case Phase::TGE:
+                tokens_ = airdropPolicy_->calculateTokens(airdropPoints_, userId_);
+                break;
+            case Phase::PostTGE: {
+                RNG::Stream rng = streamFor(stepIndex, RNG::Domain::PostTGE);
+                active_ = (rng.uniform() < postTGEActiveProb_);
+                break;
+            }
         }
     }
 
-    SybilUser::SybilUser(double wealth, int userId, AirdropPolicyPtr policy)
-        : User(wealth, userId, policy) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::poisson_distribution<int> d(0.5);
-        interactionRate_ = d(gen);
+    SybilUser::SybilUser(double wealth, int userId, AirdropPolicyPtr policy, const RNG::StreamKey& rngKey)
+        : User(wealth, userId, policy, rngKey) {
+        RNG::Stream rng(rngKey_, static_cast<std::uint32_t>(userId_), 0, RNG::Domain::UserInit);
+        interactionRate_ = rng.poisson(cohortParams(Cohort::Sybil).interactionMean);
     }
 
-    void SybilUser::step(const std::string& phase) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<double> dist(0.5, 1.0);
-        if (phase == "PreTGE") {
-            double delta = interactionRate_ * dist(gen);
-            airdropPoints_ += delta;
-        } else if (phase == "TGE") {
-            tokens_ = airdropPolicy_->calculateTokens(airdropPoints_, userId_);
-        } else if (phase == "PostTGE") {
-            active_ = false;
+    void SybilUser::step(Phase phase) {
+        std::uint32_t stepIndex = stepCount_++;
+        switch (phase) {
+            case Phase::PreTGE: {
+                const CohortParams& params = cohortParams(Cohort::Sybil);
+                RNG::Stream rng = streamFor(stepIndex, RNG::Domain::PreTGE);
+                airdropPoints_ += interactionRate_ * rng.uniform(params.preTGEDeltaLo, params.preTGEDeltaHi);
+                break;
+            }
+            case Phase::TGE:
+                tokens_ = airdropPolicy_->calculateTokens(airdropPoints_, userId_);
+                break;
+            case Phase::PostTGE:
+                active_ = false;
+                break;
         }
     }
 
@@ -1,19 +1,60 @@
 #ifndef USERS_HPP
 #define USERS_HPP
 
+#include <array>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include "airdrop_policy.hpp"
+#include "rng.hpp"
 
 namespace Users {
 
     using AirdropPolicyPtr = std::shared_ptr<Airdrop::AirdropPolicy>;
 
+    enum class Phase : std::uint8_t { PreTGE, TGE, PostTGE };
+
+    // Maps the legacy phase strings ("PreTGE", "TGE", "PostTGE"); anything else is ignored by callers.
+    std::optional<Phase> phaseFromName(const std::string& name);
+    const char* phaseName(Phase phase);
+
+    enum class Cohort : std::uint8_t { Small, Medium, Large, Sybil };
+    inline constexpr std::size_t kNumCohorts = 4;
+
+    // Per-cohort behaviour shared by the object model below and the columnar kernels in UserPool
+    struct CohortParams {
+        const char* name;
+        double wealthMu;
+        double wealthSigma;
+        double interactionMean;
+        double preTGEDeltaLo;
+        double preTGEDeltaHi;
+        double preTGEWinProb; // chance that a PreTGE step's trades end in profit
+        double postTGEActiveProb;
+        double sellWeight;
+    };
+
+    inline constexpr std::array<CohortParams, kNumCohorts> kCohortParams = {{
+        { "small",  6.0, 1.5, 1.0, 0.5, 1.5, 0.46, 0.4, 1.0 },
+        { "medium", 7.0, 1.2, 3.0, 0.5, 1.5, 0.50, 0.8, 0.8 },
+        { "large",  8.0, 1.0, 5.0, 0.5, 1.5, 0.54, 0.9, 0.3 },
+        { "sybil",  5.0, 1.0, 0.5, 0.5, 1.0, 0.50, 0.0, 1.0 }
+    }};
+
+    inline const CohortParams& cohortParams(Cohort cohort) { return kCohortParams[static_cast<std::size_t>(cohort)]; }
+    std::optional<Cohort> cohortFromName(const std::string& name);
+
     class User {
     public:
-        User(double wealth, int userId, AirdropPolicyPtr policy);
+        User(double wealth, int userId, AirdropPolicyPtr policy, const RNG::StreamKey& rngKey = {});
         virtual ~User() = default;
-        virtual void step(const std::string& phase) = 0;
+        virtual void step(Phase phase) = 0;
+        // String form kept for compatibility; resolves the phase once and forwards.
+        void step(const std::string& phase) {
+            if (auto p = phaseFromName(phase))
+                step(*p);
+        }
         double getAirdropPoints() const { return airdropPoints_; }
         double getTokens() const { return tokens_; }
         bool isActive() const { return active_; }
@@ -25,23 +66,34 @@ namespace Users {
         double tokens_;
         bool active_;
         AirdropPolicyPtr airdropPolicy_;
+        RNG::StreamKey rngKey_;
+        std::uint32_t stepCount_;
+        RNG::Stream streamFor(std::uint32_t step, RNG::Domain domain) const {
+            return RNG::Stream(rngKey_, static_cast<std::uint32_t>(userId_), step, domain);
+        }
         alignas(64) char padding[64];
     };
 
     class RegularUser : public User {
     public:
-        RegularUser(double wealth, int userId, const std::string& userSize, AirdropPolicyPtr policy);
-        void step(const std::string& phase) override;
+        RegularUser(double wealth, int userId, const std::string& userSize, AirdropPolicyPtr policy,
+                    const RNG::StreamKey& rngKey = {});
+        using User::step;
+        void step(Phase phase) override;
         std::string getUserSize() const { return userSize_; }
     private:
         std::string userSize_;
         int interactionRate_;
+        double preTGEDeltaLo_;
+        double preTGEDeltaHi_;
+        double postTGEActiveProb_;
     };
 
     class SybilUser : public User {
     public:
-        SybilUser(double wealth, int userId, AirdropPolicyPtr policy);
-        void step(const std::string& phase) override;
+        SybilUser(double wealth, int userId, AirdropPolicyPtr policy, const RNG::StreamKey& rngKey = {});
+        using User::step;
+        void step(Phase phase) override;
     private:
         int interactionRate_;
     };
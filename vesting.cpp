@@ -0,0 +1,158 @@
+#include "vesting.hpp"
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace PostTGE {
+
+    std::vector<ScheduleSpec> defaultSchedules() {
+        return {
+            { "Team", 0.20, 0.20, 12, 0.20, 36 },
+            { "TGE Airdrop", 0.15, 1.0, 0, 0.0, 0 },
+            { "Future Investors", 0.17, 0.0, 0, 0.0, 48 },
+            { "Strategic Reserve/Treasury", 0.20, 0.0, 0, 0.0, 48 },
+            { "Investors", 0.08, 0.20, 0, 0.20, 36, 1 },
+            { "Rewards", 0.05, 1.0, 0, 0.0, 0 },
+            { "Promotion", 0.03, 0.20, 0, 0.20, 24, 1 },
+            { "Advisors", 0.02, 0.20, 12, 0.20, 36 },
+        };
+    }
+
+    std::vector<ScheduleSpec> loadSchedules(const std::string& path) {
+        std::ifstream in(path);
+        if (!in)
+            throw std::runtime_error("Vesting: cannot open " + path);
+        std::vector<ScheduleSpec> specs;
+        // unlockedHistory is keyed by group name, and the groups share one total supply
+        std::unordered_map<std::string, int> firstLine;
+        double allocated = 0.0;
+        std::string line;
+        for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+            auto fail = [&](const std::string& what) {
+                return std::runtime_error("Vesting: " + path + ":" + std::to_string(lineNo) + ": " + what);
+            };
+            line = line.substr(0, line.find('#'));
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+            auto colon = line.find(':');
+            if (colon == std::string::npos)
+                throw fail("expected '<name>: values'");
+            ScheduleSpec spec{};
+            std::string name = line.substr(0, colon);
+            auto first = name.find_first_not_of(" \t");
+            if (first == std::string::npos)
+                throw fail("empty group name");
+            spec.name = name.substr(first, name.find_last_not_of(" \t") - first + 1);
+            if (auto [it, added] = firstLine.emplace(spec.name, lineNo); !added)
+                throw fail("duplicate group '" + spec.name + "' (first on line " + std::to_string(it->second) + ")");
+
+            std::vector<double> values;
+            std::stringstream fields(line.substr(colon + 1));
+            std::string field;
+            while (std::getline(fields, field, ',')) {
+                std::size_t used = 0;
+                try {
+                    values.push_back(std::stod(field, &used));
+                } catch (const std::exception&) {
+                    throw fail("bad number '" + field + "'");
+                }
+                if (field.find_first_not_of(" \t\r", used) != std::string::npos)
+                    throw fail("bad number '" + field + "'");
+            }
+            if (values.size() != 5 && values.size() != 6)
+                throw fail("expected 5 or 6 values");
+            auto fraction = [&](double value, const char* what) {
+                if (!(value >= 0.0 && value <= 1.0))
+                    throw fail(std::string(what) + " must be a fraction in [0, 1]");
+                return value;
+            };
+            auto months = [&](double value, const char* what) {
+                if (!(value >= 0.0 && value <= std::numeric_limits<int>::max()) || value != std::floor(value))
+                    throw fail(std::string(what) + " must be a whole number of months >= 0");
+                return static_cast<int>(value);
+            };
+            spec.allocationFraction = fraction(values[0], "allocation");
+            spec.unlockAtTGE = fraction(values[1], "unlockAtTGE");
+            spec.lockupDuration = months(values[2], "lockup");
+            spec.initialCliffUnlock = fraction(values[3], "cliffUnlock");
+            spec.unlockDuration = months(values[4], "duration");
+            spec.initialCliffDelay = values.size() == 6 ? months(values[5], "cliffDelay") : 0;
+            if (spec.unlockAtTGE + spec.initialCliffUnlock > 1.0)
+                throw fail("unlockAtTGE + cliffUnlock exceeds 1");
+            allocated += spec.allocationFraction;
+            if (allocated > 1.0 + 1e-9)
+                throw fail("allocations sum to more than 1");
+            specs.push_back(std::move(spec));
+        }
+        return specs;
+    }
+
+    VestingEngine::VestingEngine(double totalSupply, const std::vector<ScheduleSpec>& specs)
+        : start_(specs.size() * kMaxSegments), base_(specs.size() * kMaxSegments),
+          scale_(specs.size() * kMaxSegments, 0.0), duration_(specs.size() * kMaxSegments, 1.0) {
+        for (std::size_t g = 0; g < specs.size(); ++g) {
+            const ScheduleSpec& spec = specs[g];
+            names_.push_back(spec.name);
+            allocation_.push_back(totalSupply * spec.allocationFraction);
+
+            // Segments: nothing before TGE, the TGE unlock until the vesting start, the linear vest, fully vested.
+            // Matches VestingSchedule: the vest starts after the lockup if there is one, else after the cliff delay.
+            const std::size_t row = g * kMaxSegments;
+            const double vestStart = spec.lockupDuration > 0 ? spec.lockupDuration : spec.initialCliffDelay;
+            start_[row + 0] = std::numeric_limits<double>::lowest();
+            base_[row + 0] = 0.0;
+            start_[row + 1] = 0.0;
+            base_[row + 1] = spec.unlockAtTGE;
+            start_[row + 2] = vestStart;
+            base_[row + 2] = spec.unlockAtTGE + spec.initialCliffUnlock;
+            start_[row + 3] = vestStart + spec.unlockDuration;
+            base_[row + 3] = 1.0;
+            if (spec.unlockDuration > 0) {
+                scale_[row + 2] = 1.0 - spec.unlockAtTGE - spec.initialCliffUnlock;
+                duration_[row + 2] = spec.unlockDuration;
+            }
+            // With no vesting period segment 2 starts where segment 3 does and is never selected.
+        }
+    }
+
+    std::optional<std::size_t> VestingEngine::groupId(const std::string& name) const {
+        for (std::size_t g = 0; g < names_.size(); ++g)
+            if (names_[g] == name)
+                return g;
+        return std::nullopt;
+    }
+
+    double VestingEngine::totalUnlocked(double months) const {
+        double total = 0.0;
+        for (std::size_t g = 0; g < numGroups(); ++g)
+            total += unlocked(g, months);
+        return total;
+    }
+
+    void VestingEngine::fill(std::span<const double> times, std::span<double> out) const {
+        const std::size_t groups = numGroups();
+        for (std::size_t i = 0; i < times.size(); ++i)
+            for (std::size_t g = 0; g < groups; ++g)
+                out[i * groups + g] = unlocked(g, times[i]);
+    }
+
+    void VestingEngine::fillHorizon(double start, double step, std::size_t count, std::span<double> out,
+                                    std::span<double> totals) const {
+        const std::size_t groups = numGroups();
+        for (std::size_t i = 0; i < count; ++i) {
+            const double t = start + step * static_cast<double>(i);
+            double total = 0.0;
+            for (std::size_t g = 0; g < groups; ++g) {
+                double value = unlocked(g, t);
+                out[i * groups + g] = value;
+                total += value;
+            }
+            if (!totals.empty())
+                totals[i] = total;
+        }
+    }
+
+} // namespace PostTGE
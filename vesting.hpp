@@ -0,0 +1,84 @@
+#ifndef VESTING_HPP
+#define VESTING_HPP
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace PostTGE {
+
+    // One allocation group, in the units of VestingSchedule (durations in months).
+    struct ScheduleSpec {
+        std::string name;
+        double allocationFraction; // share of total supply
+        double unlockAtTGE;
+        int lockupDuration;
+        double initialCliffUnlock;
+        int unlockDuration;
+        int initialCliffDelay = 0;
+    };
+
+    // The allocation table that PostTGERewardsManager has always used.
+    std::vector<ScheduleSpec> defaultSchedules();
+
+    // Reads one group per line: "<name>: allocation, unlockAtTGE, lockup, cliffUnlock, duration[, cliffDelay]".
+    // Blank lines and '#' comments are skipped. Fractions must lie in [0, 1], durations be whole months >= 0,
+    // names be unique and allocations sum to at most 1; anything else (including an empty name) throws
+    // std::runtime_error naming the line.
+    std::vector<ScheduleSpec> loadSchedules(const std::string& path);
+
+    inline constexpr double kDaysPerMonth = 365.25 / 12.0;
+
+    // Schedules compiled into a dense groups x segments table of piecewise-linear pieces. Time is in
+    // months since TGE and may be fractional (days = months * kDaysPerMonth), so any resolution costs
+    // the same: a lookup scans a fixed number of segments without branching. At whole months the
+    // values are bit-identical to VestingSchedule::getUnlockedTokens.
+    class VestingEngine {
+    public:
+        static constexpr std::size_t kMaxSegments = 4;
+
+        VestingEngine(double totalSupply, const std::vector<ScheduleSpec>& specs = defaultSchedules());
+
+        std::size_t numGroups() const { return names_.size(); }
+        const std::string& groupName(std::size_t group) const { return names_[group]; }
+        std::optional<std::size_t> groupId(const std::string& name) const;
+        double allocation(std::size_t group) const { return allocation_[group]; }
+
+        // Cumulative tokens unlocked for a group by time t.
+        double unlocked(std::size_t group, double months) const {
+            return allocation_[group] * fraction(group, months);
+        }
+        // Tokens released in (t0, t1].
+        double unlockedBetween(std::size_t group, double t0, double t1) const {
+            return unlocked(group, t1) - unlocked(group, t0);
+        }
+        double totalUnlocked(double months) const;
+
+        // out[i * numGroups() + g] = unlocked(g, times[i]).
+        void fill(std::span<const double> times, std::span<double> out) const;
+        // Same for times start, start + step, ... (count of them); totals[i] (if given) gets the row sum.
+        void fillHorizon(double start, double step, std::size_t count, std::span<double> out,
+                         std::span<double> totals = {}) const;
+    private:
+        std::vector<std::string> names_;
+        std::vector<double> allocation_;
+        // Row-major [group][segment]: value = base + scale * ((t - start) / duration) for the last start <= t
+        std::vector<double> start_;
+        std::vector<double> base_;
+        std::vector<double> scale_;
+        std::vector<double> duration_;
+
+        double fraction(std::size_t group, double t) const {
+            const std::size_t row = group * kMaxSegments;
+            std::size_t k = 0;
+            for (std::size_t s = 1; s < kMaxSegments; ++s)
+                k += t >= start_[row + s];
+            return base_[row + k] + scale_[row + k] * ((t - start_[row + k]) / duration_[row + k]);
+        }
+    };
+
+} // namespace PostTGE
+
+#endif // VESTING_HPP